@@ -86,6 +86,8 @@ static pthread_mutex_t AudioRbMutex;	///< audio condition mutex
 static pthread_mutex_t AudioStartMutex;	///< audio condition mutex
 static pthread_cond_t AudioStartCond;	///< condition variable
 static char AudioThreadStop;		///< stop audio thread
+static int AudioThreadCpus;		///< cpu mask of the play thread
+static int AudioThreadPriority;		///< realtime priority of the play thread
 static char AlsaPlayerStop;		///< stop audio thread
 
 static char AudioSoftVolume;		///< flag use soft volume
@@ -1102,6 +1104,9 @@ static void AlsaExit(void)
 */
 static void *AudioPlayHandlerThread(void *dummy)
 {
+	SetThreadCpus(AudioThreadCpus);
+	SetThreadPriority(AudioThreadPriority);
+
 	for (;;) {
 		// check if we should stop the thread
 		if (AudioThreadStop) {
@@ -1724,6 +1729,31 @@ void AudioSetAutoAES(int onoff)
     }
 }
 
+/**
+**	Set the cpus of the play thread.
+**
+**	@param mask	bit n set = cpu n, 0 = any cpu
+**
+**	@note used when the thread starts.
+*/
+void AudioSetThreadCpus(int mask)
+{
+    AudioThreadCpus = mask & 0x7FFFFFFF;
+}
+
+/**
+**	Set the realtime priority of the play thread.
+**
+**	@param prio	1 .. 99 = SCHED_FIFO, -1 .. -99 = SCHED_RR priority,
+**			0 = normal scheduling
+**
+**	@note used when the thread starts.
+*/
+void AudioSetThreadPriority(int prio)
+{
+    AudioThreadPriority = prio;
+}
+
 /**
 **	Initialize audio output module.
 **
@@ -52,6 +52,8 @@ extern void AudioSetDevice(const char *);	///< set PCM audio device
 extern void AudioSetPassthroughDevice(const char *);	/// set pass-through device
 extern void AudioSetChannel(const char *);	///< set mixer channel
 extern void AudioSetAutoAES(int);	///< set automatic AES flag handling
+extern void AudioSetThreadCpus(int);	///< set play thread cpu mask
+extern void AudioSetThreadPriority(int);	///< set play thread priority
 
 extern void AudioInit(void);		///< setup audio module
 extern void AudioExit(void);		///< cleanup and exit audio module
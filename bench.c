@@ -0,0 +1,782 @@
+///
+///	@file bench.c	@brief Headless pipeline benchmark
+///
+///	Copyright (c) 2021 by zille.  All Rights Reserved.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@defgroup Bench The benchmark.
+///
+///	Replays a transport stream recording or a PES dump through
+///	PlayVideo and PlayAudio like vdr does, into the null video output
+///	and an alsa device without a sound card. Built with make bench, it
+///	reports the decoded and shown frame rate, latency percentiles of the
+///	stages, drops and dupes, the channel switch time and the memory high
+///	water marks.
+///
+
+#include <inttypes.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+
+#include <pthread.h>
+
+#include <libavcodec/avcodec.h>
+
+#include "iatomic.h"			// portable atomic_t
+#include "misc.h"
+#include "video.h"
+#include "audio.h"
+#include "softhddev.h"
+
+/// @addtogroup Bench
+/// @{
+
+//----------------------------------------------------------------------------
+//	Defines
+//----------------------------------------------------------------------------
+
+#define BENCH_TS_SIZE 188		///< transport stream packet size
+#define BENCH_PIDS 16			///< max assembled pids of a ts
+#define BENCH_PTS_MAX 512		///< pts of the video pes in flight
+#define BENCH_READ_SIZE (1024 * 1024)	///< bytes of a file read
+#define BENCH_LEAD 500			///< ms video is fed ahead in real time
+#define BENCH_IDLE 1000			///< ms without frames ending the run
+
+//----------------------------------------------------------------------------
+//	Typedefs
+//----------------------------------------------------------------------------
+
+    /// Latency samples typedef
+typedef struct _bench_samples_ BenchSamples;
+
+///
+///	Latency samples structure.
+///
+struct _bench_samples_
+{
+    const char *Name;			///< stage name
+    int *Us;				///< samples in us
+    int Count;				///< number of samples
+    int Size;				///< allocated samples
+};
+
+///
+///	Pes assembly of a ts pid.
+///
+typedef struct _bench_pid_
+{
+    int Pid;				///< pid, -1 unused
+    uint8_t *Data;			///< pes data
+    int Size;				///< bytes of pes data
+    int Alloc;				///< allocated bytes
+} BenchPid;
+
+///
+///	Video pes in flight.
+///
+typedef struct _bench_pts_
+{
+    int64_t Pts;			///< pes pts
+    uint64_t Fed;			///< us ticks pes accepted
+    uint64_t Queued;			///< us ticks frame decoded
+} BenchPts;
+
+//----------------------------------------------------------------------------
+//	Variables
+//----------------------------------------------------------------------------
+
+int SysLogLevel = 2;			///< info to stderr
+int ConfigAudioBufferTime;		///< default audio buffer
+int ConfigFastSwitch;			///< no fast channel switch
+
+static int BenchRealTime;		///< pace the feed by the pts
+static int BenchZapInterval;		///< s between channel switches
+static int BenchLoops = 1;		///< times the input is played
+
+static BenchPid BenchPids[BENCH_PIDS];	///< ts pes assembly
+static int BenchVideoPid = -1;		///< pid of the played video
+static int BenchAudioPid = -1;		///< pid of the played audio
+
+static pthread_mutex_t BenchMutex = PTHREAD_MUTEX_INITIALIZER;
+static BenchPts BenchPtsRb[BENCH_PTS_MAX];	///< video pes in flight
+static int BenchPtsWrite;		///< write pointer of the pts ring
+
+static int BenchDecoded;		///< frames decoded
+static int BenchShown;			///< frames shown
+static int BenchDropped;		///< frames dropped
+static int BenchDuped;			///< frames duped
+static uint64_t BenchLastFrame;		///< us ticks of the last frame event
+
+static int64_t BenchPacePts = AV_NOPTS_VALUE;	///< pts of the pace start
+static uint64_t BenchPaceTick;		///< us ticks of the pace start
+
+static int BenchVideoPackets;		///< video pes fed
+static int BenchAudioPackets;		///< audio pes fed
+static int64_t BenchBytes;		///< bytes fed
+static int BenchAudioMax;		///< max bytes in the audio buffer
+
+static int BenchZaps;			///< channel switches
+static int BenchZapPending;		///< switch without sync yet
+static int BenchZapFailed;		///< switches never synced
+static uint64_t BenchZapTick;		///< us ticks of the last switch
+
+static BenchSamples BenchFeedVideo = { "feed video", NULL, 0, 0 };
+static BenchSamples BenchFeedAudio = { "feed audio", NULL, 0, 0 };
+static BenchSamples BenchDecode = { "decode", NULL, 0, 0 };
+static BenchSamples BenchDisplay = { "display", NULL, 0, 0 };
+static BenchSamples BenchTotal = { "total", NULL, 0, 0 };
+static BenchSamples BenchZapFirst = { "zap first frame", NULL, 0, 0 };
+static BenchSamples BenchZapSync = { "zap a/v sync", NULL, 0, 0 };
+
+//----------------------------------------------------------------------------
+//	Plugin replacements
+//----------------------------------------------------------------------------
+
+///
+///	Jpeg encoder of the plugin, the screenshot isn't benchmarked.
+///
+uint8_t *CreateJpeg( __attribute__ ((unused)) uint8_t * image,
+	__attribute__ ((unused)) int *size,
+	__attribute__ ((unused)) int quality,
+	__attribute__ ((unused)) int width,
+	__attribute__ ((unused)) int height)
+{
+    return NULL;
+}
+
+//----------------------------------------------------------------------------
+//	Samples
+//----------------------------------------------------------------------------
+
+///
+///	Add a latency sample.
+///
+static void BenchAdd(BenchSamples * samples, int64_t us)
+{
+    if (samples->Count == samples->Size) {
+	int *p;
+	int size = samples->Size ? samples->Size * 2 : 4096;
+
+	if (!(p = realloc(samples->Us, size * sizeof(*p)))) {
+	    return;
+	}
+	samples->Us = p;
+	samples->Size = size;
+    }
+    samples->Us[samples->Count++] = us < 0 ? 0 : us > INT32_MAX ? INT32_MAX : us;
+}
+
+///
+///	Compare two samples for qsort.
+///
+static int BenchCompare(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+///
+///	Print the percentiles of sorted samples.
+///
+///	@param samples	latency samples
+///	@param scale	divisor of the printed values
+///
+static void BenchPrint(BenchSamples * samples, int scale)
+{
+    int n = samples->Count;
+
+    if (!n) {
+	printf("  %-16s        -\n", samples->Name);
+	return;
+    }
+    qsort(samples->Us, n, sizeof(*samples->Us), BenchCompare);
+    printf("  %-16s %8d %8d %8d %8d %8d\n", samples->Name, n,
+	samples->Us[n / 2] / scale, samples->Us[n * 95 / 100] / scale,
+	samples->Us[n * 99 / 100] / scale, samples->Us[n - 1] / scale);
+}
+
+//----------------------------------------------------------------------------
+//	Frame events
+//----------------------------------------------------------------------------
+
+///
+///	Find the video pes of a frame.
+///
+static BenchPts *BenchFind(int64_t pts)
+{
+    int i;
+
+    if (pts == (int64_t)AV_NOPTS_VALUE) {
+	return NULL;
+    }
+    for (i = 0; i < BENCH_PTS_MAX; ++i) {
+	if (BenchPtsRb[i].Pts == pts && BenchPtsRb[i].Fed) {
+	    return &BenchPtsRb[i];
+	}
+    }
+    return NULL;
+}
+
+///
+///	Frame event hook of the null render.
+///
+///	@param event	VIDEO_NULL_QUEUED, _SHOWN, _DROPPED or _DUPED
+///	@param pts	frame pts
+///
+static void BenchFrameHook(int event, int64_t pts)
+{
+    uint64_t now = GetUsTicks();
+    BenchPts *p;
+
+    pthread_mutex_lock(&BenchMutex);
+    p = BenchFind(pts);
+    switch (event) {
+	case VIDEO_NULL_QUEUED:
+	    BenchDecoded++;
+	    if (p) {
+		p->Queued = now;
+		BenchAdd(&BenchDecode, now - p->Fed);
+	    }
+	    break;
+	case VIDEO_NULL_SHOWN:
+	    BenchShown++;
+	    if (p) {
+		if (p->Queued) {
+		    BenchAdd(&BenchDisplay, now - p->Queued);
+		}
+		BenchAdd(&BenchTotal, now - p->Fed);
+		p->Fed = 0;
+	    }
+	    break;
+	case VIDEO_NULL_DROPPED:
+	    BenchDropped++;
+	    if (p) {
+		p->Fed = 0;
+	    }
+	    break;
+	case VIDEO_NULL_DUPED:
+	    BenchDuped++;
+	    break;
+    }
+    BenchLastFrame = now;
+    pthread_mutex_unlock(&BenchMutex);
+}
+
+//----------------------------------------------------------------------------
+//	Feed
+//----------------------------------------------------------------------------
+
+///
+///	Get the pts of a pes packet.
+///
+static int64_t BenchPesPts(const uint8_t * data, int size)
+{
+    if (size < 14 || !(data[7] & 0x80)) {
+	return AV_NOPTS_VALUE;
+    }
+    return (int64_t) (data[9] & 0x0E) << 29 | data[10] << 22 | (data[11] &
+	0xFE) << 14 | data[12] << 7 | (data[13] & 0xFE) >> 1;
+}
+
+///
+///	Wait until a pes is due in real time.
+///
+///	Video is fed BENCH_LEAD ms ahead of the audio, like the mux of a
+///	broadcast. A pts jump restarts the pace.
+///
+static void BenchPace(int64_t pts, int video)
+{
+    int64_t due;
+    int64_t now;
+
+    if (!BenchRealTime || pts == (int64_t)AV_NOPTS_VALUE) {
+	return;
+    }
+    now = GetUsTicks();
+    if (BenchPacePts == (int64_t)AV_NOPTS_VALUE) {
+	BenchPacePts = pts;
+	BenchPaceTick = now + BENCH_LEAD * 1000;
+    }
+    due = BenchPaceTick + (pts - BenchPacePts) * 100 / 9;
+    if (video) {
+	due -= BENCH_LEAD * 1000;
+    }
+    if (due - now > 5000000 || now - due > 5000000) {
+	BenchPacePts = AV_NOPTS_VALUE;
+	return;
+    }
+    if (due > now) {
+	usleep(due - now);
+    }
+}
+
+///
+///	Feed a complete pes packet like vdr.
+///
+///	@param pid	ts pid or pes stream id
+///	@param data	pes packet
+///	@param size	pes packet size
+///
+static void BenchPes(int pid, const uint8_t * data, int size)
+{
+    uint64_t start;
+    int64_t pts;
+    int video;
+    int n;
+
+    if (size < 9 || data[0] || data[1] || data[2] != 0x01) {
+	return;
+    }
+    video = (data[3] & 0xF0) == 0xE0;
+    if (video) {
+	if (BenchVideoPid < 0) {
+	    BenchVideoPid = pid;
+	}
+	if (pid != BenchVideoPid) {
+	    return;
+	}
+    } else if ((data[3] & 0xE0) == 0xC0 || data[3] == 0xBD) {
+	if (BenchAudioPid < 0) {
+	    BenchAudioPid = pid;
+	}
+	if (pid != BenchAudioPid) {
+	    return;
+	}
+    } else {
+	return;
+    }
+
+    pts = BenchPesPts(data, size);
+    BenchPace(pts, video);
+
+    for (;;) {
+	start = GetUsTicks();
+	n = video ? PlayVideo(data, size) : PlayAudio(data, size, data[3]);
+	if (n) {
+	    break;
+	}
+	usleep(1000);			// buffers full, vdr polls
+    }
+    BenchAdd(video ? &BenchFeedVideo : &BenchFeedAudio, GetUsTicks() - start);
+    BenchBytes += size;
+
+    if (video) {
+	BenchVideoPackets++;
+	if (pts != (int64_t)AV_NOPTS_VALUE) {
+	    pthread_mutex_lock(&BenchMutex);
+	    BenchPtsRb[BenchPtsWrite].Pts = pts;
+	    BenchPtsRb[BenchPtsWrite].Fed = GetUsTicks();
+	    BenchPtsRb[BenchPtsWrite].Queued = 0;
+	    BenchPtsWrite = (BenchPtsWrite + 1) % BENCH_PTS_MAX;
+	    pthread_mutex_unlock(&BenchMutex);
+	}
+    } else {
+	BenchAudioPackets++;
+    }
+    if ((n = AudioUsedBytes()) > BenchAudioMax) {
+	BenchAudioMax = n;
+    }
+}
+
+///
+///	Drop the partly assembled pes packets.
+///
+static void BenchTsReset(void)
+{
+    int i;
+
+    for (i = 0; i < BENCH_PIDS; ++i) {
+	BenchPids[i].Size = 0;
+    }
+}
+
+///
+///	Assemble the pes packets of a ts packet.
+///
+static void BenchTs(const uint8_t * ts)
+{
+    BenchPid *slot = NULL;
+    int pid;
+    int pusi;
+    int n;
+    int i;
+
+    pid = (ts[1] & 0x1F) << 8 | ts[2];
+    pusi = ts[1] & 0x40;
+    if (!(ts[3] & 0x10) || pid == 0x1FFF) {	// no payload
+	return;
+    }
+    n = 4;
+    if (ts[3] & 0x20) {			// adaption field
+	n += 1 + ts[4];
+    }
+    if (n + 4 > BENCH_TS_SIZE) {
+	return;
+    }
+
+    for (i = 0; i < BENCH_PIDS; ++i) {
+	if (BenchPids[i].Pid == pid) {
+	    slot = &BenchPids[i];
+	    break;
+	}
+	if (!slot && BenchPids[i].Pid < 0) {
+	    slot = &BenchPids[i];
+	}
+    }
+    if (!slot || (slot->Pid != pid && !pusi)) {
+	return;
+    }
+    slot->Pid = pid;
+
+    if (pusi) {
+	if (slot->Size) {
+	    BenchPes(pid, slot->Data, slot->Size);
+	}
+	slot->Size = 0;
+	// only audio and video pes are assembled
+	if (ts[n] || ts[n + 1] || ts[n + 2] != 0x01 || !((ts[n + 3] & 0xF0) == 0xE0
+		|| (ts[n + 3] & 0xE0) == 0xC0 || ts[n + 3] == 0xBD)) {
+	    return;
+	}
+    } else if (!slot->Size) {
+	return;
+    }
+
+    if (slot->Size + BENCH_TS_SIZE > slot->Alloc) {
+	uint8_t *p;
+	int alloc = slot->Alloc ? slot->Alloc * 2 : 256 * 1024;
+
+	if (!(p = realloc(slot->Data, alloc))) {
+	    slot->Size = 0;
+	    return;
+	}
+	slot->Data = p;
+	slot->Alloc = alloc;
+    }
+    memcpy(slot->Data + slot->Size, ts + n, BENCH_TS_SIZE - n);
+    slot->Size += BENCH_TS_SIZE - n;
+}
+
+///
+///	Find the end of a pes packet without length.
+///
+///	@returns offset of the next pes start code, or -1.
+///
+static int BenchPesEnd(const uint8_t * data, int size)
+{
+    int i;
+
+    for (i = 9; i + 3 < size; ++i) {
+	if (!data[i] && !data[i + 1] && data[i + 2] == 0x01
+	    && ((data[i + 3] & 0xF0) == 0xE0 || (data[i + 3] & 0xE0) == 0xC0
+		|| data[i + 3] == 0xBD)) {
+	    return i;
+	}
+    }
+    return -1;
+}
+
+///
+///	Switch the channel, like vdr the stream continues at any picture.
+///
+static void BenchZap(void)
+{
+    if (BenchZapPending) {
+	BenchZapFailed++;
+    }
+    SetPlayMode(0);
+    SetPlayMode(1);
+    BenchTsReset();
+    BenchPacePts = AV_NOPTS_VALUE;
+    BenchZaps++;
+    BenchZapPending = 1;
+    BenchZapTick = GetUsTicks();
+}
+
+///
+///	Check the channel switch, zap if it's time.
+///
+///	@param zap	switch the channel after the interval
+///
+static void BenchZapCheck(int zap)
+{
+    int first_frame;
+    int sync;
+
+    if (BenchZapPending) {
+	GetZapTime(&first_frame, &sync);
+	if (first_frame && sync) {
+	    BenchAdd(&BenchZapFirst, first_frame * 1000);
+	    BenchAdd(&BenchZapSync, sync * 1000);
+	    BenchZapPending = 0;
+	}
+    }
+    if (zap && BenchZapInterval &&
+	GetUsTicks() - BenchZapTick >= (uint64_t)BenchZapInterval * 1000000) {
+	BenchZap();
+    }
+}
+
+///
+///	Play a ts recording or a pes dump.
+///
+///	@returns -1 if the file can't be read.
+///
+static int BenchFile(const char *name)
+{
+    FILE *file;
+    uint8_t *buf;
+    int size = 0;
+    int ts = -1;
+    int pos;
+    size_t n;
+
+    if (!(file = fopen(name, "rb"))) {
+	fprintf(stderr, "bench: can't open %s: %m\n", name);
+	return -1;
+    }
+    if (!(buf = malloc(2 * BENCH_READ_SIZE))) {
+	fclose(file);
+	return -1;
+    }
+    BenchTsReset();
+
+    while ((n = fread(buf + size, 1, 2 * BENCH_READ_SIZE - size, file)) || size) {
+	size += n;
+	if (ts < 0) {
+	    ts = buf[0] == 0x47 && (size < 2 * BENCH_TS_SIZE
+		|| buf[BENCH_TS_SIZE] == 0x47);
+	}
+
+	pos = 0;
+	if (ts) {
+	    while (size - pos >= BENCH_TS_SIZE) {
+		if (buf[pos] != 0x47) {	// resync
+		    pos++;
+		    continue;
+		}
+		BenchTs(buf + pos);
+		pos += BENCH_TS_SIZE;
+		BenchZapCheck(1);
+	    }
+	    if (!n) {
+		break;
+	    }
+	} else {
+	    while (size - pos >= 9) {
+		uint8_t *p = buf + pos;
+		int len;
+
+		if (p[0] || p[1] || p[2] != 0x01) {	// resync
+		    pos++;
+		    continue;
+		}
+		len = p[4] << 8 | p[5];
+		if (len) {
+		    len += 6;
+		    if (len > size - pos) {
+			break;
+		    }
+		} else if ((len = BenchPesEnd(p, size - pos)) < 0) {
+		    if (n && size - pos < BENCH_READ_SIZE) {
+			break;
+		    }
+		    len = size - pos;	// end of file or oversized
+		}
+		BenchPes(p[3], p, len);
+		pos += len;
+		BenchZapCheck(1);
+	    }
+	    if (!n && pos == 0) {
+		break;
+	    }
+	}
+	memmove(buf, buf + pos, size - pos);
+	size -= pos;
+    }
+
+    free(buf);
+    fclose(file);
+    return 0;
+}
+
+//----------------------------------------------------------------------------
+//	Report
+//----------------------------------------------------------------------------
+
+///
+///	Get a memory high water mark of the process.
+///
+///	@param key	VmHWM or VmPeak
+///
+///	@returns KiB, 0 if unknown.
+///
+static long BenchMemory(const char *key)
+{
+    FILE *file;
+    char line[128];
+    long kib = 0;
+    size_t len = strlen(key);
+
+    if ((file = fopen("/proc/self/status", "r"))) {
+	while (fgets(line, sizeof(line), file)) {
+	    if (!strncmp(line, key, len) && line[len] == ':') {
+		kib = atol(line + len + 1);
+		break;
+	    }
+	}
+	fclose(file);
+    }
+    return kib;
+}
+
+///
+///	Print the report.
+///
+static void BenchReport(const char *name, uint64_t us)
+{
+    double s = us / 1000000.0;
+
+    printf("input: %s, %d video %d audio pes, %.1f MiB\n", name,
+	BenchVideoPackets, BenchAudioPackets, BenchBytes / (1024.0 * 1024.0));
+    printf("time: %.2fs %s, %.1f MiB/s\n", s,
+	BenchRealTime ? "real time" : "max speed",
+	BenchBytes / (1024.0 * 1024.0) / s);
+    printf("frames: %d decoded %.1f/s, %d shown %.1f/s, %d dropped, %d duped\n",
+	BenchDecoded, BenchDecoded / s, BenchShown, BenchShown / s,
+	BenchDropped, BenchDuped);
+    printf("latency us:          count      p50      p95      p99      max\n");
+    BenchPrint(&BenchFeedVideo, 1);
+    BenchPrint(&BenchFeedAudio, 1);
+    BenchPrint(&BenchDecode, 1);
+    BenchPrint(&BenchDisplay, 1);
+    BenchPrint(&BenchTotal, 1);
+    if (BenchZaps) {
+	printf("channel switch ms: %d switches, %d without sync\n", BenchZaps,
+	    BenchZapFailed + BenchZapPending);
+	BenchPrint(&BenchZapFirst, 1000);
+	BenchPrint(&BenchZapSync, 1000);
+    }
+    printf("memory: rss peak %ld KiB, virtual peak %ld KiB, audio buffer peak %d bytes\n",
+	BenchMemory("VmHWM"), BenchMemory("VmPeak"), BenchAudioMax);
+}
+
+//----------------------------------------------------------------------------
+//	Main
+//----------------------------------------------------------------------------
+
+///
+///	Print usage.
+///
+static void BenchUsage(void)
+{
+    printf("Usage: softhddev-bench [-r] [-z s] [-l n] [-a device] file\n"
+	"\t-r\t\tfeed in real time by the pts (default max speed)\n"
+	"\t-z s\t\tswitch the channel every s seconds\n"
+	"\t-l n\t\tplay the file n times\n"
+	"\t-a device\talsa device (default null)\n"
+	"\tfile\t\tts recording or pes dump\n"
+	"Video output: VIDEO_NULL_HZ (default 50, max speed 0), VIDEO_NULL_LOG\n");
+}
+
+///
+///	Benchmark main.
+///
+int main(int argc, char *const argv[])
+{
+    const char *device = "null";
+    uint64_t start;
+    uint64_t end;
+    uint64_t last;
+    int i;
+
+    for (;;) {
+	switch (getopt(argc, argv, "a:l:rz:")) {
+	    case 'a':
+		device = optarg;
+		continue;
+	    case 'l':
+		BenchLoops = atoi(optarg);
+		continue;
+	    case 'r':
+		BenchRealTime = 1;
+		continue;
+	    case 'z':
+		BenchZapInterval = atoi(optarg);
+		continue;
+	    case EOF:
+		break;
+	    default:
+		BenchUsage();
+		return 2;
+	}
+	break;
+    }
+    if (optind + 1 != argc) {
+	BenchUsage();
+	return 2;
+    }
+
+    openlog("softhddev-bench", LOG_PERROR, LOG_USER);
+    // max speed: audio doesn't pace the null display
+    if (!BenchRealTime) {
+	setenv("VIDEO_NULL_HZ", "0", 0);
+    }
+    for (i = 0; i < BENCH_PIDS; ++i) {
+	BenchPids[i].Pid = -1;
+    }
+    VideoNullHook = BenchFrameHook;
+    AudioSetDevice(device);
+
+    Start();
+    SetPlayMode(1);
+
+    start = GetUsTicks();
+    BenchZapTick = start;
+    for (i = 0; i < BenchLoops; ++i) {
+	if (BenchFile(argv[optind])) {
+	    return 1;
+	}
+    }
+
+    // wait until the queued frames are shown
+    end = GetUsTicks();
+    for (;;) {
+	usleep(100000);
+	BenchZapCheck(0);
+	pthread_mutex_lock(&BenchMutex);
+	last = BenchLastFrame;
+	pthread_mutex_unlock(&BenchMutex);
+	if (GetUsTicks() - (last > end ? last : end) >= BENCH_IDLE * 1000) {
+	    break;
+	}
+    }
+
+    BenchReport(argv[optind], (last > start ? last : end) - start);
+
+    SetPlayMode(0);
+    SoftHdDeviceExit();
+
+    return BenchShown ? 0 : 1;
+}
+
+/// @}
@@ -0,0 +1,762 @@
+///
+///	@file check.c	@brief Self checks and micro benchmarks
+///
+///	Copyright (c) 2021 by zille.  All Rights Reserved.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@defgroup Check The self checks.
+///
+///	Checks the pure cpu code against reference vectors and measures its
+///	throughput: the ring buffer (also with a concurrent writer and
+///	reader), the audio sync checkers of the pes demux, the sequence
+///	header parser and the audio filters (check_audio.c). make check
+///	builds and runs it, the exit code is the number of failed checks.
+///
+///	The sync checkers are static, softhddev.c is included.
+///
+
+#include "softhddev.c"
+
+#include <sched.h>
+
+#include "ringbuffer.h"
+
+/// @addtogroup Check
+/// @{
+
+//----------------------------------------------------------------------------
+//	Defines
+//----------------------------------------------------------------------------
+
+#define CHECK_RB_SIZE (64 * 1024)	///< ring buffer size
+#define CHECK_RB_BYTES (256 * 1024 * 1024)	///< bytes through the ring buffer
+#define CHECK_AUDIO_FRAMES 4096		///< frames of an audio check stream
+#define CHECK_PARSE_LOOPS 1000000	///< sequence headers parsed
+#define CHECK_SCAN_SIZE (4 * 1024 * 1024)	///< bytes scanned for start codes
+
+    /// Check a condition, count and print the failure
+#define CHECK(cond) \
+    do { \
+	if (!(cond)) { \
+	    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+	    CheckFailed++; \
+	} \
+    } while (0)
+
+//----------------------------------------------------------------------------
+//	Variables
+//----------------------------------------------------------------------------
+
+int SysLogLevel = 1;			///< warnings to stderr
+int ConfigAudioBufferTime;		///< default audio buffer
+int ConfigFastSwitch;			///< no fast channel switch
+
+static int CheckFailed;			///< failed checks
+static int64_t CheckQueuedPts[VIDEO_SURFACES_MAX];	///< pts queued to the render
+static int CheckQueued;			///< frames queued to the render
+
+    /// audio filter checks of check_audio.c
+extern int CheckAudioFilter(void);
+
+//----------------------------------------------------------------------------
+//	Plugin replacements
+//----------------------------------------------------------------------------
+
+///
+///	Jpeg encoder of the plugin, not checked.
+///
+uint8_t *CreateJpeg( __attribute__ ((unused)) uint8_t * image,
+	__attribute__ ((unused)) int *size,
+	__attribute__ ((unused)) int quality,
+	__attribute__ ((unused)) int width,
+	__attribute__ ((unused)) int height)
+{
+    return NULL;
+}
+
+//----------------------------------------------------------------------------
+//	Helper
+//----------------------------------------------------------------------------
+
+///
+///	Deterministic pseudo random numbers.
+///
+static uint32_t CheckRandom(uint32_t * seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 16;
+}
+
+///
+///	Byte of the check pattern at a stream position.
+///
+static inline uint8_t CheckPattern(size_t pos)
+{
+    return pos ^ pos >> 11 ^ pos >> 19;
+}
+
+///
+///	Print a throughput.
+///
+static void CheckRate(const char *what, double count, const char *unit,
+    uint64_t us)
+{
+    if (!us) {
+	us = 1;
+    }
+    printf("  %-28s %12.1f %s/s\n", what, count * 1000000.0 / us, unit);
+}
+
+//----------------------------------------------------------------------------
+//	Ring buffer
+//----------------------------------------------------------------------------
+
+///
+///	Ring buffer writer thread.
+///
+///	Writes the check pattern with random chunks, alternating the copy
+///	and the zero copy interface.
+///
+static void *CheckRbWriter(void *arg)
+{
+    RingBuffer *rb = arg;
+    uint8_t chunk[4096];
+    uint32_t seed = 1;
+    size_t pos = 0;
+
+    while (pos < CHECK_RB_BYTES) {
+	size_t n = CheckRandom(&seed) % sizeof(chunk) + 1;
+	size_t i;
+
+	if (n > CHECK_RB_BYTES - pos) {
+	    n = CHECK_RB_BYTES - pos;
+	}
+	if (n & 1) {
+	    void *p;
+
+	    if ((i = RingBufferGetWritePointer(rb, &p)) < n) {
+		n = i;
+	    }
+	    if (!n) {
+		sched_yield();
+		continue;
+	    }
+	    for (i = 0; i < n; ++i) {
+		((uint8_t *) p)[i] = CheckPattern(pos + i);
+	    }
+	    RingBufferWriteAdvance(rb, n);
+	} else {
+	    for (i = 0; i < n; ++i) {
+		chunk[i] = CheckPattern(pos + i);
+	    }
+	    if (!(n = RingBufferWrite(rb, chunk, n))) {
+		sched_yield();
+		continue;
+	    }
+	}
+	pos += n;
+    }
+    return NULL;
+}
+
+///
+///	Check the ring buffer.
+///
+static void CheckRingBuffer(void)
+{
+    RingBuffer *rb;
+    pthread_t thread;
+    uint8_t buf[4096];
+    const void *rp;
+    void *wp;
+    uint32_t seed = 2;
+    size_t pos;
+    size_t n;
+    size_t i;
+    uint64_t start;
+    int errors;
+
+    printf("ring buffer:\n");
+
+    // single thread: fill, wrap around, partial writes and reads
+    rb = RingBufferNew(1000);
+    CHECK(rb != NULL);
+    CHECK(RingBufferFreeBytes(rb) == 1000 && RingBufferUsedBytes(rb) == 0);
+    memset(buf, 0xAA, sizeof(buf));
+    CHECK(RingBufferWrite(rb, buf, 600) == 600);
+    CHECK(RingBufferRead(rb, buf, 500) == 500);
+    CHECK(RingBufferUsedBytes(rb) == 100 && RingBufferFreeBytes(rb) == 900);
+    for (i = 0; i < 900; ++i) {
+	buf[i] = CheckPattern(i);
+    }
+    CHECK(RingBufferWrite(rb, buf, 1000) == 900);	// full: partial write
+    CHECK(RingBufferFreeBytes(rb) == 0);
+    CHECK(RingBufferWrite(rb, buf, 1) == 0);
+    CHECK(RingBufferReadAdvance(rb, 100) == 100);
+    CHECK(RingBufferGetWritePointer(rb, &wp) == 100);	// contiguous to end
+    n = RingBufferGetReadPointer(rb, &rp);
+    CHECK(n == 400);					// contiguous until wrap
+    for (i = 0, errors = 0; i < n; ++i) {
+	errors += ((const uint8_t *)rp)[i] != CheckPattern(i);
+    }
+    CHECK(!errors);
+    memset(buf, 0, sizeof(buf));
+    CHECK(RingBufferRead(rb, buf, 1000) == 900);	// read over the wrap
+    for (i = 0, errors = 0; i < 900; ++i) {
+	errors += buf[i] != CheckPattern(i);
+    }
+    CHECK(!errors);
+    CHECK(RingBufferUsedBytes(rb) == 0 && RingBufferRead(rb, buf, 1) == 0);
+    RingBufferReset(rb);
+    CHECK(RingBufferFreeBytes(rb) == 1000);
+    RingBufferDel(rb);
+
+    // single thread throughput with the copy interface
+    rb = RingBufferNew(CHECK_RB_SIZE);
+    start = GetUsTicks();
+    for (pos = 0; pos < CHECK_RB_BYTES; pos += sizeof(buf)) {
+	RingBufferWrite(rb, buf, sizeof(buf));
+	RingBufferRead(rb, buf, sizeof(buf));
+    }
+    CheckRate("write+read 4KiB", CHECK_RB_BYTES / (1024.0 * 1024.0), "MiB",
+	GetUsTicks() - start);
+
+    // concurrent writer and reader with random chunks
+    RingBufferReset(rb);
+    start = GetUsTicks();
+    pthread_create(&thread, NULL, CheckRbWriter, rb);
+    pos = 0;
+    errors = 0;
+    while (pos < CHECK_RB_BYTES) {
+	n = CheckRandom(&seed) % sizeof(buf) + 1;
+	if (n & 1) {
+	    if ((i = RingBufferGetReadPointer(rb, &rp)) < n) {
+		n = i;
+	    }
+	    if (!n) {
+		sched_yield();
+		continue;
+	    }
+	    for (i = 0; i < n; ++i) {
+		errors += ((const uint8_t *)rp)[i] != CheckPattern(pos + i);
+	    }
+	    RingBufferReadAdvance(rb, n);
+	} else {
+	    if (!(n = RingBufferRead(rb, buf, n))) {
+		sched_yield();
+		continue;
+	    }
+	    for (i = 0; i < n; ++i) {
+		errors += buf[i] != CheckPattern(pos + i);
+	    }
+	}
+	pos += n;
+    }
+    pthread_join(thread, NULL);
+    CHECK(!errors);
+    CHECK(RingBufferUsedBytes(rb) == 0);
+    CheckRate("concurrent writer/reader", CHECK_RB_BYTES / (1024.0 * 1024.0),
+	"MiB", GetUsTicks() - start);
+    RingBufferDel(rb);
+}
+
+//----------------------------------------------------------------------------
+//	Audio sync checkers
+//----------------------------------------------------------------------------
+
+///
+///	Build a stream of audio frames.
+///
+///	@param buf	output buffer
+///	@param header	frame header
+///	@param len	bytes of the header
+///	@param size	frame size
+///	@param count	number of frames
+///
+static void CheckAudioStream(uint8_t * buf, const uint8_t * header, int len,
+    int size, int count)
+{
+    int i;
+
+    memset(buf, 0x55, size * count + 16);
+    for (i = 0; i < count; ++i) {
+	memcpy(buf + i * size, header, len);
+    }
+}
+
+///
+///	Measure a sync checker over a stream of frames.
+///
+static void CheckAudioRate(const char *name,
+    int (*check)(const uint8_t *, int), const uint8_t * buf, int size)
+{
+    uint64_t start;
+    int frames = 0;
+    int loop;
+    int pos;
+    int n;
+
+    start = GetUsTicks();
+    for (loop = 0; loop < 100; ++loop) {
+	for (pos = 0; (n = check(buf + pos, size * CHECK_AUDIO_FRAMES - pos)) > 0;
+	    pos += n) {
+	    frames++;
+	}
+    }
+    start = GetUsTicks() - start;
+    CHECK(frames == 100 * (CHECK_AUDIO_FRAMES - 1));
+    printf("  %-28s %12.1f frames/s %9.1f MiB/s\n", name,
+	frames * 1000000.0 / (start ? start : 1),
+	pos * 100.0 * 1000000.0 / (start ? start : 1) / (1024.0 * 1024.0));
+}
+
+///
+///	Check the sync checkers of the pes audio demux.
+///
+static void CheckAudioSync(void)
+{
+    // MPEG-1 layer II 192 kbit/s 48 kHz: 576 bytes
+    static const uint8_t mpeg[] = { 0xFF, 0xFD, 0xA4, 0x00 };
+    // LATM: 13 bit frame length 256 + 3 bytes header
+    static const uint8_t latm[] = { 0x56, 0xE1, 0x00 };
+    // AC-3 48 kHz frmsizcod 28: 768 words
+    static const uint8_t ac3[] = { 0x0B, 0x77, 0x00, 0x00, 0x1C, 0x40 };
+    // E-AC-3 bsid 16 frmsiz 767: 768 words
+    static const uint8_t eac3[] = { 0x0B, 0x77, 0x02, 0xFF, 0x3F, 0x80 };
+    // ADTS AAC LC 48 kHz stereo: 371 bytes
+    static const uint8_t adts[] = { 0xFF, 0xF1, 0x4C, 0x80, 0x2E, 0x7F, 0xFC };
+    uint8_t *buf;
+
+    printf("audio sync:\n");
+
+    if (!(buf = malloc(2048 * CHECK_AUDIO_FRAMES + 16))) {
+	CHECK(buf != NULL);
+	return;
+    }
+
+    CheckAudioStream(buf, mpeg, sizeof(mpeg), 576, 2);
+    CHECK(FastMpegCheck(buf) && MpegCheck(buf, 2 * 576) == 576);
+    CHECK(MpegCheck(buf, 100) == -576 - 4);		// need more data
+    buf[576] = 0;
+    CHECK(MpegCheck(buf, 2 * 576) == 0);		// no following frame
+    buf[2] = 0xF4;
+    CHECK(!FastMpegCheck(buf));				// reserved bitrate
+    CheckAudioStream(buf, mpeg, sizeof(mpeg), 576, CHECK_AUDIO_FRAMES);
+    CheckAudioRate("MpegCheck", MpegCheck, buf, 576);
+
+    CheckAudioStream(buf, latm, sizeof(latm), 259, 2);
+    CHECK(FastLatmCheck(buf) && LatmCheck(buf, 2 * 259) == 259);
+    CHECK(LatmCheck(buf, 100) == -259 - 2);
+    buf[259] = 0;
+    CHECK(LatmCheck(buf, 2 * 259) == 0);
+    CheckAudioStream(buf, latm, sizeof(latm), 259, CHECK_AUDIO_FRAMES);
+    CheckAudioRate("LatmCheck", LatmCheck, buf, 259);
+
+    CheckAudioStream(buf, ac3, sizeof(ac3), 1536, 2);
+    CHECK(FastAc3Check(buf) && Ac3Check(buf, 2 * 1536) == 1536);
+    CHECK(Ac3Check(buf, 4) == -5);
+    CHECK(Ac3Check(buf, 100) == -1536 - 5);
+    buf[4] = 0xDC;
+    CHECK(Ac3Check(buf, 2 * 1536) == 0);		// reserved fscod
+    CheckAudioStream(buf, eac3, sizeof(eac3), 1536, 2);
+    CHECK(FastAc3Check(buf) && Ac3Check(buf, 2 * 1536) == 1536);
+    CheckAudioStream(buf, ac3, sizeof(ac3), 1536, CHECK_AUDIO_FRAMES);
+    CheckAudioRate("Ac3Check", Ac3Check, buf, 1536);
+
+    CheckAudioStream(buf, adts, sizeof(adts), 371, 2);
+    CHECK(FastAdtsCheck(buf) && AdtsCheck(buf, 2 * 371) == 371);
+    CHECK(AdtsCheck(buf, 100) == -371 - 3);
+    buf[371] = 0;
+    CHECK(AdtsCheck(buf, 2 * 371) == 0);
+    buf[2] = 0x7C;
+    CHECK(!FastAdtsCheck(buf));				// sampling index 15
+    CheckAudioStream(buf, adts, sizeof(adts), 371, CHECK_AUDIO_FRAMES);
+    CheckAudioRate("AdtsCheck", AdtsCheck, buf, 371);
+
+    free(buf);
+}
+
+//----------------------------------------------------------------------------
+//	Sequence header parser
+//----------------------------------------------------------------------------
+
+///
+///	Bit writer of the reference sequence headers.
+///
+typedef struct _check_bits_
+{
+    uint8_t Data[64];			///< rbsp
+    int Pos;				///< bit position
+} CheckBits;
+
+///
+///	Write n bits.
+///
+static void CheckPut(CheckBits * bw, uint32_t val, int n)
+{
+    while (n--) {
+	if (val >> n & 1) {
+	    bw->Data[bw->Pos >> 3] |= 0x80 >> (bw->Pos & 7);
+	}
+	bw->Pos++;
+    }
+}
+
+///
+///	Write an unsigned exp-golomb code.
+///
+static void CheckPutUE(CheckBits * bw, uint32_t val)
+{
+    int n = 0;
+
+    while ((val + 1) >> (n + 1)) {
+	n++;
+    }
+    CheckPut(bw, 0, n);
+    CheckPut(bw, val + 1, n + 1);
+}
+
+///
+///	Build a H.264 access unit with a high profile SPS.
+///
+///	@param buf		output buffer
+///	@param width_mbs	width in macroblocks
+///	@param height_units	height in map units
+///	@param progressive	frame_mbs_only_flag
+///	@param crop_bottom	frame_crop_bottom_offset
+///
+///	@returns bytes in buf.
+///
+static int CheckH264Sps(uint8_t * buf, int width_mbs, int height_units,
+    int progressive, int crop_bottom)
+{
+    static const uint8_t aud[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xF0,
+	0x00, 0x00, 0x00, 0x01, 0x67 };
+    static const uint8_t slice[] = { 0x00, 0x00, 0x01, 0x65, 0x88, 0x84 };
+    CheckBits bw;
+    int zeros = 0;
+    int n;
+    int i;
+
+    memset(&bw, 0, sizeof(bw));
+    CheckPut(&bw, 100, 8);		// profile_idc high
+    CheckPut(&bw, 0, 8);		// constraint flags
+    CheckPut(&bw, 40, 8);		// level_idc
+    CheckPutUE(&bw, 0);			// seq_parameter_set_id
+    CheckPutUE(&bw, 1);			// chroma_format_idc 4:2:0
+    CheckPutUE(&bw, 0);			// bit_depth_luma_minus8
+    CheckPutUE(&bw, 0);			// bit_depth_chroma_minus8
+    CheckPut(&bw, 0, 2);		// transform bypass, scaling matrix
+    CheckPutUE(&bw, 0);			// log2_max_frame_num_minus4
+    CheckPutUE(&bw, 0);			// pic_order_cnt_type
+    CheckPutUE(&bw, 0);			// log2_max_pic_order_cnt_lsb_minus4
+    CheckPutUE(&bw, 4);			// max_num_ref_frames
+    CheckPut(&bw, 0, 1);		// gaps_in_frame_num_allowed
+    CheckPutUE(&bw, width_mbs - 1);
+    CheckPutUE(&bw, height_units - 1);
+    CheckPut(&bw, progressive, 1);
+    if (!progressive) {
+	CheckPut(&bw, 1, 1);		// mb_adaptive_frame_field
+    }
+    CheckPut(&bw, 1, 1);		// direct_8x8_inference
+    CheckPut(&bw, 1, 1);		// frame_cropping
+    CheckPutUE(&bw, 0);
+    CheckPutUE(&bw, 0);
+    CheckPutUE(&bw, 0);
+    CheckPutUE(&bw, crop_bottom);
+    CheckPut(&bw, 0, 1);		// vui_parameters_present
+    CheckPut(&bw, 1, 1);		// rbsp stop bit
+
+    memcpy(buf, aud, sizeof(aud));
+    n = sizeof(aud);
+    for (i = 0; i < (bw.Pos + 7) / 8; ++i) {	// emulation prevention
+	if (zeros >= 2 && bw.Data[i] <= 0x03) {
+	    buf[n++] = 0x03;
+	    zeros = 0;
+	}
+	zeros = bw.Data[i] ? 0 : zeros + 1;
+	buf[n++] = bw.Data[i];
+    }
+    memcpy(buf + n, slice, sizeof(slice));
+    return n + sizeof(slice);
+}
+
+///
+///	Check the sequence header parser.
+///
+static void CheckParser(void)
+{
+    // MPEG-2 720x576 4:3 25 Hz, MP@ML interlaced extension
+    static const uint8_t mpeg2[] = { 0x00, 0x00, 0x01, 0xB3, 0x2D, 0x02,
+	0x40, 0x23, 0xFF, 0xFF, 0xE0, 0x18, 0x00, 0x00, 0x01, 0xB5, 0x14,
+	0x82, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x0F
+    };
+    VideoStreamInfo info;
+    uint8_t buf[128];
+    uint8_t *scan;
+    uint64_t start;
+    int size;
+    int offset;
+    int i;
+
+    printf("parser:\n");
+
+    size = CheckH264Sps(buf, 120, 68, 1, 4);
+    CHECK(ParseDetectCodec(buf, size, &offset) == AV_CODEC_ID_H264
+	&& offset == 1);
+    memset(&info, 0, sizeof(info));
+    CHECK(ParseStreamInfo(AV_CODEC_ID_H264, buf, size, &info) == 1);
+    CHECK(info.Width == 1920 && info.Height == 1080 && !info.Interlaced);
+    CHECK(info.Profile == 100 && info.Level == 40 && info.BitDepth == 8
+	&& info.ChromaFormat == 1);
+
+    size = CheckH264Sps(buf, 120, 34, 0, 2);
+    memset(&info, 0, sizeof(info));
+    CHECK(ParseStreamInfo(AV_CODEC_ID_H264, buf, size, &info) == 1);
+    CHECK(info.Width == 1920 && info.Height == 1080 && info.Interlaced);
+
+    size = CheckH264Sps(buf, 80, 45, 1, 0);
+    memset(&info, 0, sizeof(info));
+    CHECK(ParseStreamInfo(AV_CODEC_ID_H264, buf, size, &info) == 1);
+    CHECK(info.Width == 1280 && info.Height == 720 && !info.Interlaced);
+
+    // slice without sequence header
+    CHECK(ParseStreamInfo(AV_CODEC_ID_H264, buf + size - 6, 6, &info) == 0);
+
+    CHECK(ParseDetectCodec(mpeg2, sizeof(mpeg2), &offset)
+	== AV_CODEC_ID_MPEG2VIDEO && offset == 0);
+    memset(&info, 0, sizeof(info));
+    CHECK(ParseStreamInfo(AV_CODEC_ID_MPEG2VIDEO, mpeg2, sizeof(mpeg2),
+	    &info) == 1);
+    CHECK(info.Width == 720 && info.Height == 576 && info.Interlaced);
+    CHECK(info.Profile == 4 && info.Level == 8 && info.ChromaFormat == 1);
+
+    size = CheckH264Sps(buf, 120, 68, 1, 4);
+    start = GetUsTicks();
+    for (i = 0; i < CHECK_PARSE_LOOPS; ++i) {
+	ParseStreamInfo(AV_CODEC_ID_H264, buf, size, &info);
+    }
+    CheckRate("ParseStreamInfo H.264", CHECK_PARSE_LOOPS, "SPS",
+	GetUsTicks() - start);
+
+    if (!(scan = malloc(CHECK_SCAN_SIZE))) {
+	CHECK(scan != NULL);
+	return;
+    }
+    for (i = 0; i < CHECK_SCAN_SIZE; ++i) {	// slice data without start codes
+	scan[i] = CheckPattern(i) | 0x04;
+    }
+    start = GetUsTicks();
+    for (i = 0; i < 25; ++i) {
+	CHECK(ParseFindStartCode(scan, scan + CHECK_SCAN_SIZE)
+	    == scan + CHECK_SCAN_SIZE);
+    }
+    CheckRate("ParseFindStartCode", 25.0 * CHECK_SCAN_SIZE / (1024.0 * 1024.0),
+	"MiB", GetUsTicks() - start);
+    free(scan);
+}
+
+///
+///	Check the access unit splitter with PES packets split at every byte.
+///
+///	A start code split over the PES packets must start the access unit
+///	as in the unsplit stream.
+///
+static void CheckEnqueue(void)
+{
+    // three h264 access units: aud, idr slice / aud, slice / aud, slice
+    static const uint8_t es[] = {
+	0x00, 0x00, 0x01, 0x09, 0x10, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84,
+	0x21, 0xA0, 0x55,
+	0x00, 0x00, 0x00, 0x01, 0x09, 0x30, 0x00, 0x00, 0x01, 0x41, 0x9A,
+	0x12, 0x34, 0x56, 0x78,
+	0x00, 0x00, 0x00, 0x01, 0x09, 0x30, 0x00, 0x00, 0x01, 0x41, 0x9A,
+	0x9A, 0xBC, 0xDE, 0xF0
+    };
+    static VideoStream stream[1];
+    const int au2 = 15;			// 00 00 01 of the second aud
+    const int au3 = 30;			// 00 00 01 of the third aud
+    int split;
+
+    printf("access unit splitter:\n");
+
+    VideoPacketInit(stream);
+    // the pes packets with timestamp start in an access unit or the
+    // start code of the third one is split
+    for (split = 6; split <= au3 + VIDEO_SCAN_TAIL; ++split) {
+	atomic_set(&stream->PacketsFilled, 0);
+	stream->PacketRead = stream->PacketWrite = 0;
+	stream->PacketRb[0].size = 0;
+	stream->CodecID = AV_CODEC_ID_H264;
+	stream->AuPicture = 0;
+	stream->ScanTail = 0;
+
+	VideoEnqueue(stream, 1000, AV_NOPTS_VALUE, es, split);
+	VideoEnqueue(stream, 2000, AV_NOPTS_VALUE, es + split,
+	    sizeof(es) - split);
+
+	CHECK(atomic_read(&stream->PacketsFilled) == 2);
+	CHECK(stream->PacketRb[0].size == au2 && stream->PacketRb[0].pts == 1000);
+	CHECK(stream->PacketRb[1].size == au3 - au2);
+	CHECK(stream->PacketRb[1].pts == (au2 + VIDEO_SCAN_TAIL >= split ?
+		2000 : AV_NOPTS_VALUE));
+	CHECK(stream->PacketRb[2].size == (int)sizeof(es) - au3);
+	CHECK(stream->PacketRb[2].pts == (au2 + VIDEO_SCAN_TAIL >= split ?
+		AV_NOPTS_VALUE : 2000));
+    }
+    VideoPacketExit(stream);
+}
+
+///
+///	Record the frames queued to the null render.
+///
+static void CheckFrameHook(int event, int64_t pts)
+{
+    if (event == VIDEO_NULL_QUEUED && CheckQueued < VIDEO_SURFACES_MAX) {
+	CheckQueuedPts[CheckQueued++] = pts;
+    }
+}
+
+///
+///	Give a gop of frames to a render in reverse mode.
+///
+///	@returns number of frames dropped by the reverse buffer.
+///
+static int CheckReverseGop(VideoRender * render, AVCodecContext * ctx,
+    enum AVPixelFormat format, int width, int height, int count)
+{
+    int duped;
+    int dropped;
+    int counter;
+    int i;
+
+    VideoSetClosing(render);
+    VideoSetReverse(render, 1);
+    for (i = 0; i < count; ++i) {
+	AVFrame *frame;
+
+	if (!(frame = av_frame_alloc())) {
+	    CHECK(frame != NULL);
+	    break;
+	}
+	frame->format = format;
+	frame->width = width;
+	frame->height = height;
+	frame->pts = i;
+	VideoRenderFrame(render, ctx, frame);
+    }
+    VideoGetStats(render, &duped, &dropped, &counter);
+    return dropped;
+}
+
+///
+///	Check the reverse buffer with gops longer than its limits.
+///
+///	Hardware frames are surfaces of the decoder pool, the buffer may
+///	hold only a few of them or the decoder starves. The limit is shared
+///	by the drm and the null render, the gops run through the reverse
+///	buffer of the null render.
+///
+static void CheckReverse(void)
+{
+    VideoRender *render;
+    AVCodecContext *ctx;
+    AVFrame *frame;
+    int i;
+
+    printf("reverse:\n");
+
+    // limit of the drm and the null render
+    if (!(frame = av_frame_alloc())) {
+	CHECK(0);
+	return;
+    }
+    frame->format = AV_PIX_FMT_DRM_PRIME;
+    frame->width = 1920;
+    frame->height = 1080;
+    CHECK(VideoReverseLimit(frame) == VIDEO_REVERSE_HW_MAX);
+    frame->width = 3840;
+    frame->height = 2160;
+    CHECK(VideoReverseLimit(frame) == VIDEO_REVERSE_HW_MAX);
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = 1920;
+    frame->height = 1080;
+    CHECK(VideoReverseLimit(frame) == VIDEO_REVERSE_MAX);
+    frame->width = 3840;
+    frame->height = 2160;
+    CHECK(VideoReverseLimit(frame) ==
+	VIDEO_REVERSE_BYTES / (3840 * 2160 * 3 / 2 + 1));
+    frame->width = 8192;
+    frame->height = 8192;
+    CHECK(VideoReverseLimit(frame) == 1);
+    av_frame_free(&frame);
+
+    if (!(render = VideoNewRender(NULL)) || !(ctx = avcodec_alloc_context3(NULL))) {
+	CHECK(0);
+	return;
+    }
+    VideoNullHook = CheckFrameHook;
+
+    // hardware gop: the oldest frames are dropped, the newest shown first
+    CHECK(CheckReverseGop(render, ctx, AV_PIX_FMT_DRM_PRIME, 1920, 1080,
+	    3 * VIDEO_REVERSE_HW_MAX) == 2 * VIDEO_REVERSE_HW_MAX);
+    CHECK(!CheckQueued);
+    for (i = 0; i < VIDEO_SURFACES_MAX && VideoReverseOutput(render); ++i) {
+    }
+    CHECK(CheckQueued == VIDEO_SURFACES_MAX);
+    for (i = 0; i < CheckQueued; ++i) {
+	CHECK(CheckQueuedPts[i] == 3 * VIDEO_REVERSE_HW_MAX - 1 - i);
+    }
+    VideoExit(render);
+
+    // software gop: limited by VIDEO_REVERSE_MAX
+    CHECK(CheckReverseGop(render, ctx, AV_PIX_FMT_YUV420P, 64, 64,
+	    VIDEO_REVERSE_MAX + 4) == 4);
+    VideoSetReverse(render, 0);
+
+    VideoNullHook = NULL;
+    VideoExit(render);
+    VideoDelRender(render);
+    avcodec_free_context(&ctx);
+}
+
+//----------------------------------------------------------------------------
+//	Main
+//----------------------------------------------------------------------------
+
+///
+///	Self check main.
+///
+int main(void)
+{
+    openlog("softhddev-check", LOG_PERROR, LOG_USER);
+
+    CheckRingBuffer();
+    CheckAudioSync();
+    CheckParser();
+    CheckEnqueue();
+    CheckReverse();
+    CheckFailed += CheckAudioFilter();
+
+    printf("%d checks failed\n", CheckFailed);
+    return CheckFailed;
+}
+
+/// @}
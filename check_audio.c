@@ -0,0 +1,200 @@
+///
+///	@file check_audio.c	@brief Audio filter self checks
+///
+///	Copyright (c) 2021 by zille.  All Rights Reserved.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@addtogroup Check
+///
+///	The software volume, compressor and normalizer are static, audio.c
+///	is included.
+///
+/// @{
+
+#include "audio.c"
+
+//----------------------------------------------------------------------------
+//	Defines
+//----------------------------------------------------------------------------
+
+#define CHECK_PCM_SAMPLES (48000 * 2)	///< 1s 48kHz stereo
+#define CHECK_PCM_LOOPS 100		///< buffers filtered for the throughput
+
+    /// Check a condition, count and print the failure
+#define CHECK(cond) \
+    do { \
+	if (!(cond)) { \
+	    fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+	    failed++; \
+	} \
+    } while (0)
+
+//----------------------------------------------------------------------------
+//	Helper
+//----------------------------------------------------------------------------
+
+///
+///	Fill a square wave.
+///
+static void CheckPcmSquare(int16_t * samples, int count, int amplitude)
+{
+    int i;
+
+    for (i = 0; i < count; ++i) {
+	samples[i] = i & 1 ? -amplitude : amplitude;
+    }
+}
+
+///
+///	Check all samples of a square wave.
+///
+static int CheckPcmIsSquare(const int16_t * samples, int count, int amplitude)
+{
+    int i;
+
+    for (i = 0; i < count; ++i) {
+	if (samples[i] != (i & 1 ? -amplitude : amplitude)) {
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+///
+///	Measure an audio filter.
+///
+static void CheckPcmRate(const char *name, void (*filter)(int16_t *, int),
+    int16_t * samples)
+{
+    uint64_t start;
+    int i;
+
+    start = GetUsTicks();
+    for (i = 0; i < CHECK_PCM_LOOPS; ++i) {
+	CheckPcmSquare(samples, CHECK_PCM_SAMPLES, 1000);
+	filter(samples, CHECK_PCM_SAMPLES * AudioBytesProSample);
+    }
+    start = GetUsTicks() - start;
+    printf("  %-28s %12.1f samples/s\n", name,
+	CHECK_PCM_LOOPS * (double)CHECK_PCM_SAMPLES * 1000000.0 /
+	(start ? start : 1));
+}
+
+//----------------------------------------------------------------------------
+//	Checks
+//----------------------------------------------------------------------------
+
+///
+///	Check the audio filters.
+///
+///	@returns number of failed checks.
+///
+int CheckAudioFilter(void)
+{
+    static const int16_t in[4] = { 1000, -1000, INT16_MAX, INT16_MIN };
+    int16_t pcm[4];
+    int16_t *samples;
+    int failed = 0;
+    int i;
+
+    printf("audio filter:\n");
+
+    // software volume: scale, clip and mute
+    AudioMute = 0;
+    AudioAmplifier = 500;
+    memcpy(pcm, in, sizeof(pcm));
+    AudioSoftAmplifier(pcm, sizeof(pcm));
+    CHECK(pcm[0] == 500 && pcm[1] == -500 && pcm[2] == 16383
+	&& pcm[3] == -16384);
+    AudioAmplifier = 2000;
+    memcpy(pcm, in, sizeof(pcm));
+    AudioSoftAmplifier(pcm, sizeof(pcm));
+    CHECK(pcm[0] == 2000 && pcm[1] == -2000 && pcm[2] == INT16_MAX
+	&& pcm[3] == INT16_MIN);
+    AudioMute = 1;
+    memcpy(pcm, in, sizeof(pcm));
+    AudioSoftAmplifier(pcm, sizeof(pcm));
+    CHECK(!pcm[0] && !pcm[1] && !pcm[2] && !pcm[3]);
+    AudioMute = 0;
+
+    if (!(samples = malloc(CHECK_PCM_SAMPLES * AudioBytesProSample))) {
+	CHECK(samples != NULL);
+	return failed;
+    }
+
+    // compressor: smoothed up to the max factor, never clips
+    AudioMaxCompression = 4000;
+    AudioResetCompressor();
+    CheckPcmSquare(samples, 1024, 8000);
+    AudioCompressor(samples, 1024 * AudioBytesProSample);
+    CHECK(AudioCompressionFactor == (2000 * 950 + 4095 * 50) / 1000);
+    CHECK(CheckPcmIsSquare(samples, 1024, 8000 * AudioCompressionFactor / 1000));
+    for (i = 0; i < 200; ++i) {
+	CheckPcmSquare(samples, 1024, 8000);
+	AudioCompressor(samples, 1024 * AudioBytesProSample);
+    }
+    CHECK(AudioCompressionFactor == 4000);
+    CHECK(CheckPcmIsSquare(samples, 1024, 32000));
+    AudioMaxCompression = 8000;
+    for (i = 0; i < 200; ++i) {
+	CheckPcmSquare(samples, 1024, 8000);
+	AudioCompressor(samples, 1024 * AudioBytesProSample);
+    }
+    CHECK(AudioCompressionFactor > 4000
+	&& AudioCompressionFactor <= INT16_MAX * 1000 / 8000);
+    CHECK(CheckPcmIsSquare(samples, 1024, 8000 * AudioCompressionFactor / 1000));
+
+    // normalizer: unchanged until the average is ready, then smoothed up
+    // to the max factor
+    AudioMaxNormalize = 3000;
+    AudioResetNormalizer();
+    for (i = 0; i < AudioNormMaxIndex * AudioNormSamples / 1024; ++i) {
+	CheckPcmSquare(samples, 1024, 1000);
+	AudioNormalizer(samples, 1024 * AudioBytesProSample);
+	if (AudioNormalizeFactor != 1000) {
+	    break;
+	}
+    }
+    CHECK(AudioNormalizeFactor == 1000 && CheckPcmIsSquare(samples, 1024, 1000));
+    for (i = 0; i < 4 * AudioNormSamples / 1024; ++i) {
+	CheckPcmSquare(samples, 1024, 1000);
+	AudioNormalizer(samples, 1024 * AudioBytesProSample);
+    }
+    CHECK(AudioNormalizeFactor == 3000 && CheckPcmIsSquare(samples, 1024, 3000));
+    AudioMaxNormalize = 10000;
+    for (i = 0; i < AudioNormMaxIndex * AudioNormSamples / 1024; ++i) {
+	CheckPcmSquare(samples, 1024, 20000);
+	AudioNormalizer(samples, 1024 * AudioBytesProSample);
+    }
+    CHECK(AudioNormalizeFactor >= AudioMinNormalize
+	&& AudioNormalizeFactor < 1000);
+
+    AudioAmplifier = 700;
+    CheckPcmRate("AudioSoftAmplifier", AudioSoftAmplifier, samples);
+    AudioResetCompressor();
+    CheckPcmRate("AudioCompressor", AudioCompressor, samples);
+    AudioResetNormalizer();
+    CheckPcmRate("AudioNormalizer", AudioNormalizer, samples);
+
+    free(samples);
+    return failed;
+}
+
+/// @}
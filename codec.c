@@ -38,6 +38,7 @@
 #include <pthread.h>
 
 #include <libavcodec/avcodec.h>
+#include <libavutil/cpu.h>
 
 #ifdef MAIN_H
 #include MAIN_H
@@ -47,6 +48,8 @@
 #include "video.h"
 #include "audio.h"
 #include "codec.h"
+#include "parser.h"
+#include "grab.h"
 #include "softhddev.h"
 
 
@@ -56,6 +59,33 @@
 
 static pthread_mutex_t CodecLockMutex;
 
+    /// drm hw device, kept open for the plugin lifetime
+static AVBufferRef *HwDeviceCtx;
+
+#define CODEC_POOL_MAX 4		///< max number of cached video contexts
+
+///
+///	Cached opened video codec context.
+///
+struct _codec_pool_entry_
+{
+    AVCodecContext *VideoCtx;		///< flushed, opened codec context
+    int SizeClass;			///< resolution class of the stream
+    int Hw;				///< hardware decoder, holds decoder memory
+    unsigned Stamp;			///< last use, oldest is dropped first
+};
+
+    /// opened video codec contexts for the next streams
+static struct _codec_pool_entry_ CodecPool[CODEC_POOL_MAX];
+static unsigned CodecPoolStamp;		///< use counter of the pool
+
+#define CODEC_THREADS_MAX 8		///< max decoder threads of the auto setup
+
+static int CodecVideoThreads;		///< config decoder threads (0 = auto)
+static int CodecVideoCpus;		///< config cpu mask of the decoder threads
+
+extern int ConfigFastSwitch;		///< config fast channel switch
+
 //----------------------------------------------------------------------------
 //	Video
 //----------------------------------------------------------------------------
@@ -69,6 +99,11 @@ struct _video_decoder_
 
     AVCodecContext *VideoCtx;		///< video codec context
     AVFrame *Frame;			///< decoded video frame
+
+    int Pooled;				///< context goes back to the pool
+    int StreamInterlaced;		///< sequence header is interlaced
+    int SizeClass;			///< resolution class of the stream
+    int64_t SkipPts;			///< drop the frames before this pts
 };
 
 //----------------------------------------------------------------------------
@@ -92,6 +127,117 @@ static enum AVPixelFormat Codec_get_format(AVCodecContext * video_ctx,
 	return Video_get_format(decoder->Render, video_ctx, fmt);
 }
 
+//----------------------------------------------------------------------------
+//	Context pool
+//----------------------------------------------------------------------------
+
+/**
+**	Get the resolution class of a video size.
+**
+**	@returns 0 unknown, 1 SD, 2 HD, 3 UHD.
+*/
+static int CodecSizeClass(int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return 0;
+	if (width <= 720 && height <= 576)
+		return 1;
+	if (width <= 1920 && height <= 1088)
+		return 2;
+	return 3;
+}
+
+/**
+**	Take an opened codec context out of the pool.
+**
+**	@param codec		decoder
+**	@param size_class	resolution class of the stream
+**
+**	@returns flushed codec context or NULL if none is cached.
+*/
+static AVCodecContext *CodecPoolGet(const AVCodec * codec, int size_class)
+{
+	AVCodecContext *video_ctx = NULL;
+	int i;
+
+	pthread_mutex_lock(&CodecLockMutex);
+	for (i = 0; i < CODEC_POOL_MAX; ++i) {
+		if (CodecPool[i].VideoCtx && CodecPool[i].VideoCtx->codec == codec &&
+			CodecPool[i].SizeClass == size_class) {
+			video_ctx = CodecPool[i].VideoCtx;
+			CodecPool[i].VideoCtx = NULL;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&CodecLockMutex);
+
+	return video_ctx;
+}
+
+/**
+**	Put a codec context into the pool.
+**
+**	The context is flushed. If the pool is full, the oldest context is
+**	closed.
+**
+**	@param video_ctx	opened codec context
+**	@param size_class	resolution class of the stream
+*/
+static void CodecPoolPut(AVCodecContext * video_ctx, int size_class)
+{
+	int n;
+	int i;
+
+	avcodec_flush_buffers(video_ctx);
+	video_ctx->opaque = NULL;
+
+	for (n = 0, i = 1; i < CODEC_POOL_MAX; ++i) {
+		if (!CodecPool[n].VideoCtx)
+			break;
+		if (!CodecPool[i].VideoCtx || CodecPool[i].Stamp < CodecPool[n].Stamp)
+			n = i;
+	}
+	if (CodecPool[n].VideoCtx)
+		avcodec_free_context(&CodecPool[n].VideoCtx);
+
+	CodecPool[n].VideoCtx = video_ctx;
+	CodecPool[n].SizeClass = size_class;
+	CodecPool[n].Hw = video_ctx->hw_device_ctx ||
+		strstr(video_ctx->codec->name, "_v4l2");
+	CodecPool[n].Stamp = ++CodecPoolStamp;
+}
+
+/**
+**	Close the cached hardware codec contexts.
+**
+**	An idle hardware context holds a decoder instance and its buffers,
+**	they are closed before a new hardware context is opened.
+*/
+static void CodecPoolFreeHw(void)
+{
+	int i;
+
+	pthread_mutex_lock(&CodecLockMutex);
+	for (i = 0; i < CODEC_POOL_MAX; ++i) {
+		if (CodecPool[i].VideoCtx && CodecPool[i].Hw)
+			avcodec_free_context(&CodecPool[i].VideoCtx);
+	}
+	pthread_mutex_unlock(&CodecLockMutex);
+}
+
+/**
+**	Close all cached codec contexts.
+*/
+static void CodecPoolExit(void)
+{
+	int i;
+
+	for (i = 0; i < CODEC_POOL_MAX; ++i) {
+		if (CodecPool[i].VideoCtx)
+			avcodec_free_context(&CodecPool[i].VideoCtx);
+	}
+}
+
 //----------------------------------------------------------------------------
 //	Test
 //----------------------------------------------------------------------------
@@ -111,6 +257,7 @@ VideoDecoder *CodecVideoNewDecoder(VideoRender * render)
 		Fatal(_("codec: can't allocate vodeo decoder\n"));
     }
     decoder->Render = render;
+    decoder->SkipPts = AV_NOPTS_VALUE;
 
     return decoder;
 }
@@ -125,9 +272,38 @@ void CodecVideoDelDecoder(VideoDecoder * decoder)
     free(decoder);
 }
 
+/**
+**	Set the decoder threads.
+**
+**	@param threads	threads per decoder, 0 = by cpus and codec
+**
+**	@note used at the next decoder open.
+*/
+void CodecSetVideoThreads(int threads)
+{
+	CodecVideoThreads = threads < 0 ? 0 : threads;
+}
+
+/**
+**	Set the cpus of the decoder threads.
+**
+**	@param mask	bit n set = cpu n, 0 = any cpu
+**
+**	@note used at the next decoder open.
+*/
+void CodecSetVideoCpus(int mask)
+{
+	CodecVideoCpus = mask & 0x7FFFFFFF;
+}
+
 /**
 **	Open video decoder.
 **
+**	Streams without codec parameters (live tv) get an opened context of
+**	the pool, if one with the same decoder and resolution class is cached.
+**	The idle hardware contexts of the pool are closed before a new
+**	hardware context is opened.
+**
 **	@param decoder	private video decoder
 **	@param codec_id	video codec id
 */
@@ -136,7 +312,11 @@ void CodecVideoOpen(VideoDecoder * decoder, int codec_id, AVCodecParameters * Pa
 {
 	AVCodec * codec;
 	enum AVHWDeviceType type = 0;
-	static AVBufferRef *hw_device_ctx = NULL;
+	cpu_set_t saved;
+	int restore;
+	int ret;
+	int width = 0;
+	int height = 0;
 
 	if (VideoCodecMode(decoder->Render) == 1 ||
 		(VideoCodecMode(decoder->Render) == 3 && codec_id == AV_CODEC_ID_H264)) {
@@ -177,6 +357,42 @@ void CodecVideoOpen(VideoDecoder * decoder, int codec_id, AVCodecParameters * Pa
 #ifdef CODEC_DEBUG
 	fprintf(stderr, "CodecVideoOpen: Codec %s found\n", codec->long_name);
 #endif
+	// sequence header parsed by PlayVideo
+	decoder->StreamInterlaced = 0;
+	if (!Par && VideoGetStream(decoder->Render)) {
+		const VideoStreamInfo *info = GetVideoStreamInfo(VideoGetStream(decoder->Render));
+
+		if (info->CodecID == codec_id) {
+			width = info->Width;
+			height = info->Height;
+			if (strstr(codec->name, "_v4l2"))
+				decoder->StreamInterlaced = info->Interlaced;
+		}
+#ifdef CODEC_DEBUG
+		fprintf(stderr, "CodecVideoOpen: Parsed width %d height %d interlaced %d profile %d level %d\n",
+			width, height, info->Interlaced, info->Profile, info->Level);
+#endif
+	}
+
+	// the parameters of a media file can't be shared
+	decoder->Pooled = !Par;
+	decoder->SizeClass = CodecSizeClass(width, height);
+	if (decoder->Pooled &&
+		(decoder->VideoCtx = CodecPoolGet(codec, decoder->SizeClass))) {
+#ifdef CODEC_DEBUG
+		fprintf(stderr, "CodecVideoOpen: reuse context of %s class %d\n",
+			codec->name, decoder->SizeClass);
+#endif
+		decoder->VideoCtx->opaque = decoder;
+		if (timebase) {
+			decoder->VideoCtx->pkt_timebase.num = timebase->num;
+			decoder->VideoCtx->pkt_timebase.den = timebase->den;
+		}
+		return;
+	}
+	if (type || strstr(codec->name, "_v4l2"))
+		CodecPoolFreeHw();
+
 	decoder->VideoCtx = avcodec_alloc_context3(codec);
 	if (!decoder->VideoCtx) {
 		fprintf(stderr, "CodecVideoOpen: can't open video codec!\n");
@@ -186,14 +402,7 @@ void CodecVideoOpen(VideoDecoder * decoder, int codec_id, AVCodecParameters * Pa
 	decoder->VideoCtx->get_format = Codec_get_format;
 	decoder->VideoCtx->opaque = decoder;
 
-	if (strstr(codec->name, "_v4l2")) {
-		int width;
-		int height;
-
-		ParseResolutionH264(&width, &height);
-#ifdef CODEC_DEBUG
-		fprintf(stderr, "CodecVideoOpen: Parsed width %d height %d\n", width, height);
-#endif
+	if (width && height && strstr(codec->name, "_v4l2")) {
 		decoder->VideoCtx->coded_width = width;
 		decoder->VideoCtx->coded_height = height;
 	}
@@ -203,26 +412,38 @@ void CodecVideoOpen(VideoDecoder * decoder, int codec_id, AVCodecParameters * Pa
 //	decoder->VideoCtx->flags |= AV_CODEC_FLAG_TRUNCATED;
 //	if (codec->capabilities & AV_CODEC_CAP_DR1)
 //		fprintf(stderr, "[CodecVideoOpen] AV_CODEC_CAP_DR1 => get_buffer()\n");
-	if (codec->capabilities & AV_CODEC_CAP_FRAME_THREADS ||
-		AV_CODEC_CAP_SLICE_THREADS) {
-		decoder->VideoCtx->thread_count = 4;
-#ifdef CODEC_DEBUG
-		fprintf(stderr, "CodecVideoOpen: decoder use %d threads\n",
-			decoder->VideoCtx->thread_count);
-#endif
-	}
-	if (codec->capabilities & AV_CODEC_CAP_SLICE_THREADS){
+	if (codec->capabilities & (AV_CODEC_CAP_FRAME_THREADS |
+		AV_CODEC_CAP_SLICE_THREADS)) {
+		int threads = CodecVideoThreads;
+
+		if (!threads) {
+			threads = av_cpu_count();
+			if (threads > CODEC_THREADS_MAX)
+				threads = CODEC_THREADS_MAX;
+		}
+		decoder->VideoCtx->thread_count = threads;
+		// each frame thread delays the output by a frame, live SD and
+		// fast channel switch keep the latency of slice threads
 		decoder->VideoCtx->thread_type = FF_THREAD_SLICE;
+		if ((codec->capabilities & AV_CODEC_CAP_FRAME_THREADS) &&
+			(Par || (decoder->SizeClass != 1 && !ConfigFastSwitch)))
+			decoder->VideoCtx->thread_type |= FF_THREAD_FRAME;
 #ifdef CODEC_DEBUG
-		fprintf(stderr, "CodecVideoOpen: decoder use THREAD_SLICE threads\n");
+		fprintf(stderr, "CodecVideoOpen: decoder use %d threads type %d\n",
+			decoder->VideoCtx->thread_count,
+			decoder->VideoCtx->thread_type);
 #endif
 	}
 
 	if (type) {
-		if (av_hwdevice_ctx_create(&hw_device_ctx, type, NULL, NULL, 0) < 0)
+		// the hw device is created once and shared by all decoders
+		if (!HwDeviceCtx &&
+			av_hwdevice_ctx_create(&HwDeviceCtx, type, NULL, NULL, 0) < 0)
 			fprintf(stderr, "CodecVideoOpen: Error init the HW decoder\n");
-		else
-			decoder->VideoCtx->hw_device_ctx = av_buffer_ref(hw_device_ctx);
+		if (HwDeviceCtx)
+			decoder->VideoCtx->hw_device_ctx = av_buffer_ref(HwDeviceCtx);
+		// surfaces held by the reverse buffer
+		decoder->VideoCtx->extra_hw_frames = VIDEO_REVERSE_HW_MAX;
 	}
 
 	if (Par) {
@@ -234,7 +455,14 @@ void CodecVideoOpen(VideoDecoder * decoder, int codec_id, AVCodecParameters * Pa
 		decoder->VideoCtx->pkt_timebase.den = timebase->den;
 	}
 
-	if (avcodec_open2(decoder->VideoCtx, decoder->VideoCtx->codec, NULL) < 0) {
+	// the decoder threads inherit the affinity of the opening thread
+	restore = CodecVideoCpus &&
+		!pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) &&
+		!SetThreadCpus(CodecVideoCpus);
+	ret = avcodec_open2(decoder->VideoCtx, decoder->VideoCtx->codec, NULL);
+	if (restore)
+		pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+	if (ret < 0) {
 		fprintf(stderr, "CodecVideoOpen: Error opening the decoder\n");
 		Fatal(_("CodecVideoOpen: Error opening the decoder\n"));
 	}
@@ -243,6 +471,8 @@ void CodecVideoOpen(VideoDecoder * decoder, int codec_id, AVCodecParameters * Pa
 /**
 **	Close video decoder.
 **
+**	A pooled context is flushed and kept for the next stream.
+**
 **	@param decoder	private video decoder
 */
 void CodecVideoClose(VideoDecoder * decoder)
@@ -252,7 +482,11 @@ void CodecVideoClose(VideoDecoder * decoder)
 #endif
 	pthread_mutex_lock(&CodecLockMutex);
 	if (decoder->VideoCtx) {
-		avcodec_free_context(&decoder->VideoCtx);
+		if (decoder->Pooled) {
+			CodecPoolPut(decoder->VideoCtx, decoder->SizeClass);
+			decoder->VideoCtx = NULL;
+		} else
+			avcodec_free_context(&decoder->VideoCtx);
 	}
 	pthread_mutex_unlock(&CodecLockMutex);
 }
@@ -355,7 +589,25 @@ int CodecVideoReceiveFrame(VideoDecoder * decoder, int no_deint)
 	}
 	pthread_mutex_unlock(&CodecLockMutex);
 
+	// seek: decode from the key frame, show from the target
+	if (!ret && decoder->SkipPts != (int64_t)AV_NOPTS_VALUE) {
+		if (decoder->Frame->pts != (int64_t)AV_NOPTS_VALUE &&
+			decoder->Frame->pts < decoder->SkipPts) {
+			av_frame_free(&decoder->Frame);
+			return 0;
+		}
+		pthread_mutex_lock(&CodecLockMutex);
+		decoder->SkipPts = AV_NOPTS_VALUE;
+		if (decoder->VideoCtx)
+			decoder->VideoCtx->skip_frame = AVDISCARD_DEFAULT;
+		pthread_mutex_unlock(&CodecLockMutex);
+	}
+
 	if (!ret) {
+		// v4l2 decoders don't report the field coding of the stream
+		if (decoder->StreamInterlaced &&
+			decoder->Frame->format == AV_PIX_FMT_DRM_PRIME)
+			decoder->Frame->interlaced_frame = 1;
 		if (no_deint) {
 			decoder->Frame->interlaced_frame = 0;
 #ifdef STILL_DEBUG
@@ -376,6 +628,51 @@ int CodecVideoReceiveFrame(VideoDecoder * decoder, int no_deint)
 	return 0;
 }
 
+/**
+**	Drain the video decoder.
+**
+**	Sends the end of stream to the decoder, renders all delayed
+**	frames and resets the decoder for the next packets.
+**
+**	@param decoder		video decoder data
+**	@param no_deint		set interlaced_frame to 0
+*/
+void CodecVideoDrain(VideoDecoder * decoder, int no_deint)
+{
+	AVFrame *frame;
+	int ret;
+
+	pthread_mutex_lock(&CodecLockMutex);
+	if (!decoder->VideoCtx) {
+		pthread_mutex_unlock(&CodecLockMutex);
+		return;
+	}
+	avcodec_send_packet(decoder->VideoCtx, NULL);
+	pthread_mutex_unlock(&CodecLockMutex);
+
+	for (;;) {
+		if (!(frame = av_frame_alloc())) {
+			Fatal(_("CodecVideoDrain: can't allocate decoder frame\n"));
+		}
+		pthread_mutex_lock(&CodecLockMutex);
+		ret = decoder->VideoCtx ?
+			avcodec_receive_frame(decoder->VideoCtx, frame) : AVERROR_EOF;
+		pthread_mutex_unlock(&CodecLockMutex);
+		if (ret) {
+			av_frame_free(&frame);
+			break;
+		}
+		if (decoder->StreamInterlaced &&
+			frame->format == AV_PIX_FMT_DRM_PRIME)
+			frame->interlaced_frame = 1;
+		if (no_deint)
+			frame->interlaced_frame = 0;
+		VideoRenderFrame(decoder->Render, decoder->VideoCtx, frame);
+	}
+
+	CodecVideoFlushBuffers(decoder);
+}
+
 /**
 **	Flush the video decoder.
 **
@@ -389,10 +686,125 @@ void CodecVideoFlushBuffers(VideoDecoder * decoder)
 	pthread_mutex_lock(&CodecLockMutex);
 	if (decoder->VideoCtx) {
 		avcodec_flush_buffers(decoder->VideoCtx);
+		decoder->VideoCtx->skip_frame = AVDISCARD_DEFAULT;
 	}
+	decoder->SkipPts = AV_NOPTS_VALUE;
+	pthread_mutex_unlock(&CodecLockMutex);
+}
+
+/**
+**	Drop the decoded frames before a seek target.
+**
+**	The frames before the target are needed only as references,
+**	the decoder skips the non-reference frames until the target.
+**
+**	@param decoder	video decoder data
+**	@param pts	first pts to render, AV_NOPTS_VALUE renders all
+*/
+void CodecVideoSkipTo(VideoDecoder * decoder, int64_t pts)
+{
+	pthread_mutex_lock(&CodecLockMutex);
+	decoder->SkipPts = pts;
+	if (decoder->VideoCtx)
+		decoder->VideoCtx->skip_frame = pts == (int64_t)AV_NOPTS_VALUE ?
+			AVDISCARD_DEFAULT : AVDISCARD_NONREF;
 	pthread_mutex_unlock(&CodecLockMutex);
 }
 
+//----------------------------------------------------------------------------
+//	Image
+//----------------------------------------------------------------------------
+
+/**
+**	Encode a grabbed image.
+**
+**	JPEG uses the slice threads of the mjpeg encoder, every thread
+**	encodes a stripe between restart markers.
+**
+**	@param rgb		packed R, G, B image
+**	@param width		image width
+**	@param height		image height
+**	@param codec_id		AV_CODEC_ID_MJPEG or AV_CODEC_ID_PNG
+**	@param quality		JPEG quality 0 - 100, < 0 best
+**	@param size[out]	size of the encoded image
+**
+**	@returns allocated image or NULL if the encoder failed.
+*/
+uint8_t *CodecEncodeImage(const uint8_t * rgb, int width, int height,
+	int codec_id, int quality, int *size)
+{
+	const AVCodec *codec;
+	AVCodecContext *ctx;
+	AVFrame *frame;
+	AVPacket *pkt;
+	uint8_t *image = NULL;
+	int y;
+
+	if (!(codec = avcodec_find_encoder(codec_id))) {
+		fprintf(stderr, "CodecEncodeImage: no encoder %s\n",
+			avcodec_get_name(codec_id));
+		return NULL;
+	}
+	if (!(ctx = avcodec_alloc_context3(codec)))
+		return NULL;
+
+	ctx->width = width;
+	ctx->height = height;
+	ctx->time_base.num = 1;
+	ctx->time_base.den = 25;
+	if (codec_id == AV_CODEC_ID_MJPEG) {
+		ctx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+		ctx->flags |= AV_CODEC_FLAG_QSCALE;
+		ctx->global_quality = FF_QP2LAMBDA * (quality < 0 || quality > 100 ?
+			2 : 31 - quality * 29 / 100);
+		ctx->thread_count = 0;
+		ctx->thread_type = FF_THREAD_SLICE;
+	} else {
+		ctx->pix_fmt = AV_PIX_FMT_RGB24;
+	}
+
+	frame = av_frame_alloc();
+	pkt = av_packet_alloc();
+	if (!frame || !pkt || avcodec_open2(ctx, codec, NULL) < 0) {
+		fprintf(stderr, "CodecEncodeImage: can't open encoder %s\n",
+			avcodec_get_name(codec_id));
+		goto out;
+	}
+
+	frame->format = ctx->pix_fmt;
+	frame->width = width;
+	frame->height = height;
+	if (av_frame_get_buffer(frame, 0) < 0)
+		goto out;
+
+	if (codec_id == AV_CODEC_ID_MJPEG) {
+		GrabRgbToYuv420(rgb, width * 3, width, height, frame->data,
+			frame->linesize);
+	} else {
+		for (y = 0; y < height; y++)
+			memcpy(frame->data[0] + y * frame->linesize[0],
+				rgb + y * width * 3, width * 3);
+	}
+	frame->quality = ctx->global_quality;
+	frame->pts = 0;
+
+	if (avcodec_send_frame(ctx, frame) < 0 || avcodec_send_frame(ctx, NULL) < 0 ||
+		avcodec_receive_packet(ctx, pkt) < 0) {
+		fprintf(stderr, "CodecEncodeImage: encode failed\n");
+		goto out;
+	}
+	if ((image = malloc(pkt->size))) {
+		memcpy(image, pkt->data, pkt->size);
+		*size = pkt->size;
+	}
+
+out:
+	av_packet_free(&pkt);
+	av_frame_free(&frame);
+	avcodec_free_context(&ctx);
+	return image;
+}
+
 //----------------------------------------------------------------------------
 //	Audio
 //----------------------------------------------------------------------------
@@ -677,5 +1089,7 @@ void CodecInit(void)
 */
 void CodecExit(void)
 {
+	CodecPoolExit();
+	av_buffer_unref(&HwDeviceCtx);
 	pthread_mutex_destroy(&CodecLockMutex);
 }
@@ -58,6 +58,12 @@ extern VideoDecoder *CodecVideoNewDecoder(VideoRender *);
     /// Deallocate a video decoder context.
 extern void CodecVideoDelDecoder(VideoDecoder *);
 
+    /// Set video decoder threads.
+extern void CodecSetVideoThreads(int);
+
+    /// Set video decoder cpu mask.
+extern void CodecSetVideoCpus(int);
+
     /// Open video codec.
 extern void CodecVideoOpen(VideoDecoder *, int, AVCodecParameters *, AVRational *);
 
@@ -69,9 +75,18 @@ extern int CodecVideoSendPacket(VideoDecoder *, const AVPacket *);
 
 extern int CodecVideoReceiveFrame(VideoDecoder *, int);
 
+    /// Drain the delayed frames of the video decoder.
+extern void CodecVideoDrain(VideoDecoder *, int);
+
     /// Flush video buffers.
 extern void CodecVideoFlushBuffers(VideoDecoder *);
 
+    /// Drop the decoded frames before a seek target.
+extern void CodecVideoSkipTo(VideoDecoder *, int64_t);
+
+
+    /// Encode a grabbed image.
+extern uint8_t *CodecEncodeImage(const uint8_t *, int, int, int, int, int *);
 
     /// Allocate a new audio decoder context.
 extern AudioDecoder *CodecAudioNewDecoder(void);
@@ -0,0 +1,357 @@
+///
+///	@file grab.c	@brief Screen grab conversion
+///
+///	Copyright (c) 2021 by zille.  All Rights Reserved.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@defgroup Grab The screen grab conversion.
+///
+///	YUV to RGB conversion with scaling and osd blending for the
+///	screen grab. The picture is scaled while it is converted, only
+///	the pixels of the output image are read and converted.
+///
+///	The scaler gathers the samples of an output line into line
+///	buffers, the conversion works on these buffers without branches,
+///	so the compiler can vectorize it (NEON, SSE).
+///
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "grab.h"
+
+#define GRAB_FIX 12			///< fixed point bits of the coefficients
+#define GRAB_BOX_SAMPLES 8		///< max. samples per line of a box cell
+
+    /// BT.601 limited range: y, v->r, u->g, v->g, u->b
+static const int GrabBt601[5] = { 4768, 6537, 1605, 3330, 8263 };
+
+    /// BT.709 limited range: y, v->r, u->g, v->g, u->b
+static const int GrabBt709[5] = { 4768, 7343, 873, 2183, 8652 };
+
+//----------------------------------------------------------------------------
+//	Conversion
+//----------------------------------------------------------------------------
+
+///
+///	Clamp to 0 .. 255.
+///
+static inline int GrabClamp(int v)
+{
+	return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+///
+///	Convert a line of YUV samples to packed RGB.
+///
+///	@param y	luma samples
+///	@param u	cb samples
+///	@param v	cr samples
+///	@param out	output line
+///	@param n	pixels in line
+///	@param k	conversion coefficients
+///	@param format	GRAB_RGB24 or GRAB_BGRA
+///
+static void GrabConvertLine(const int *restrict y, const int *restrict u,
+    const int *restrict v, uint8_t * restrict out, int n, const int *k,
+    int format)
+{
+	int x;
+
+	if (format == GRAB_BGRA) {
+		for (x = 0; x < n; x++) {
+			int l = (y[x] - 16) * k[0] + (1 << (GRAB_FIX - 1));
+			int cb = u[x] - 128;
+			int cr = v[x] - 128;
+
+			out[x * 4 + 0] = GrabClamp((l + k[4] * cb) >> GRAB_FIX);
+			out[x * 4 + 1] = GrabClamp((l - k[2] * cb - k[3] * cr) >> GRAB_FIX);
+			out[x * 4 + 2] = GrabClamp((l + k[1] * cr) >> GRAB_FIX);
+			out[x * 4 + 3] = 0xFF;
+		}
+		return;
+	}
+	for (x = 0; x < n; x++) {
+		int l = (y[x] - 16) * k[0] + (1 << (GRAB_FIX - 1));
+		int cb = u[x] - 128;
+		int cr = v[x] - 128;
+
+		out[x * 3 + 0] = GrabClamp((l + k[1] * cr) >> GRAB_FIX);
+		out[x * 3 + 1] = GrabClamp((l - k[2] * cb - k[3] * cr) >> GRAB_FIX);
+		out[x * 3 + 2] = GrabClamp((l + k[4] * cb) >> GRAB_FIX);
+	}
+}
+
+///
+///	Convert and scale a YUV picture to packed RGB.
+///
+///	The source rectangle is scaled to the output size, SD pictures
+///	are converted with BT.601, HD pictures with BT.709.
+///
+///	@param src		source picture
+///	@param sx		source rectangle x
+///	@param sy		source rectangle y
+///	@param sw		source rectangle width
+///	@param sh		source rectangle height
+///	@param dst		output image
+///	@param dst_pitch	bytes per line of the output image
+///	@param dw		output width
+///	@param dh		output height
+///	@param format		GRAB_RGB24 or GRAB_BGRA
+///
+///	@returns 0 on success, -1 if out of memory.
+///
+int GrabConvert(const GrabSource * src, int sx, int sy, int sw, int sh,
+    uint8_t * dst, int dst_pitch, int dw, int dh, int format)
+{
+	const int *k;
+	int *lx;
+	int *cx;
+	int *line;
+	int x;
+	int y;
+
+	if (dw <= 0 || dh <= 0 || sw <= 0 || sh <= 0)
+		return 0;
+
+	if (!(lx = malloc(5 * dw * sizeof(*lx))))
+		return -1;
+	cx = lx + dw;
+	line = cx + dw;
+
+	k = src->Height > 576 ? GrabBt709 : GrabBt601;
+
+	// sample positions of the output columns
+	for (x = 0; x < dw; x++) {
+		lx[x] = sx + (int)(((int64_t)x * sw + sw / 2) / dw);
+		cx[x] = src->Nv12 ? lx[x] & ~1 : lx[x] / 2;
+	}
+
+	for (y = 0; y < dh; y++) {
+		const uint8_t *py;
+		const uint8_t *pu;
+		const uint8_t *pv;
+		int ly;
+
+		ly = sy + (int)(((int64_t)y * sh + sh / 2) / dh);
+		py = src->Plane[0] + ly * src->Pitch[0];
+		pu = src->Plane[1] + ly / 2 * src->Pitch[1];
+		pv = src->Nv12 ? pu + 1 : src->Plane[2] + ly / 2 * src->Pitch[2];
+
+		for (x = 0; x < dw; x++) {
+			line[x] = py[lx[x]];
+			line[dw + x] = pu[cx[x]];
+			line[2 * dw + x] = pv[cx[x]];
+		}
+		GrabConvertLine(line, line + dw, line + 2 * dw,
+			dst + y * dst_pitch, dw, k, format);
+	}
+
+	free(lx);
+	return 0;
+}
+
+///
+///	Box filter a YUV picture to a small packed RGB image.
+///
+///	Every output pixel is the average of its source cell, a cell is
+///	sampled with max. GRAB_BOX_SAMPLES x GRAB_BOX_SAMPLES pixels.
+///
+///	@param src		source picture
+///	@param sx		source rectangle x
+///	@param sy		source rectangle y
+///	@param sw		source rectangle width
+///	@param sh		source rectangle height
+///	@param dst		output image
+///	@param dst_pitch	bytes per line of the output image
+///	@param dw		output width
+///	@param dh		output height
+///	@param format		GRAB_RGB24 or GRAB_BGRA
+///
+///	@returns 0 on success, -1 if out of memory.
+///
+int GrabSample(const GrabSource * src, int sx, int sy, int sw, int sh,
+    uint8_t * dst, int dst_pitch, int dw, int dh, int format)
+{
+	const int *k;
+	int *line;
+	int x;
+	int y;
+
+	if (dw <= 0 || dh <= 0 || sw < dw || sh < dh)
+		return GrabConvert(src, sx, sy, sw, sh, dst, dst_pitch, dw, dh,
+			format);
+
+	if (!(line = malloc(3 * dw * sizeof(*line))))
+		return -1;
+
+	k = src->Height > 576 ? GrabBt709 : GrabBt601;
+
+	for (y = 0; y < dh; y++) {
+		int y0 = sy + y * sh / dh;
+		int y1 = sy + (y + 1) * sh / dh;
+		int ystep = (y1 - y0 + GRAB_BOX_SAMPLES - 1) / GRAB_BOX_SAMPLES;
+
+		for (x = 0; x < dw; x++) {
+			int x0 = sx + x * sw / dw;
+			int x1 = sx + (x + 1) * sw / dw;
+			int xstep = (x1 - x0 + GRAB_BOX_SAMPLES - 1) / GRAB_BOX_SAMPLES;
+			int sum_y = 0;
+			int sum_u = 0;
+			int sum_v = 0;
+			int n = 0;
+			int i;
+			int j;
+
+			for (j = y0; j < y1; j += ystep) {
+				const uint8_t *py = src->Plane[0] + j * src->Pitch[0];
+				const uint8_t *pu = src->Plane[1] + j / 2 * src->Pitch[1];
+				const uint8_t *pv = src->Nv12 ? pu + 1 :
+					src->Plane[2] + j / 2 * src->Pitch[2];
+
+				for (i = x0; i < x1; i += xstep) {
+					int c = src->Nv12 ? i & ~1 : i / 2;
+
+					sum_y += py[i];
+					sum_u += pu[c];
+					sum_v += pv[c];
+					n++;
+				}
+			}
+			line[x] = sum_y / n;
+			line[dw + x] = sum_u / n;
+			line[2 * dw + x] = sum_v / n;
+		}
+		GrabConvertLine(line, line + dw, line + 2 * dw,
+			dst + y * dst_pitch, dw, k, format);
+	}
+
+	free(line);
+	return 0;
+}
+
+///
+///	Convert packed RGB to full range YUV 4:2:0 (JFIF).
+///
+///	The chroma is the average of 2x2 pixels.
+///
+///	@param rgb	packed R, G, B image
+///	@param pitch	bytes per line of the image
+///	@param w	image width
+///	@param h	image height
+///	@param dst	Y, U and V plane
+///	@param dst_pitch	bytes per line of the planes
+///
+void GrabRgbToYuv420(const uint8_t * rgb, int pitch, int w, int h,
+    uint8_t * const dst[3], const int dst_pitch[3])
+{
+	int x;
+	int y;
+
+	for (y = 0; y < h; y++) {
+		const uint8_t *s = rgb + y * pitch;
+		uint8_t *out = dst[0] + y * dst_pitch[0];
+
+		for (x = 0; x < w; x++) {
+			out[x] = (19595 * s[x * 3] + 38470 * s[x * 3 + 1] +
+				7471 * s[x * 3 + 2] + 32768) >> 16;
+		}
+	}
+
+	for (y = 0; y < (h + 1) / 2; y++) {
+		const uint8_t *s0 = rgb + 2 * y * pitch;
+		const uint8_t *s1 = 2 * y + 1 < h ? s0 + pitch : s0;
+		uint8_t *u = dst[1] + y * dst_pitch[1];
+		uint8_t *v = dst[2] + y * dst_pitch[2];
+
+		for (x = 0; x < (w + 1) / 2; x++) {
+			int i0 = 2 * x * 3;
+			int i1 = 2 * x + 1 < w ? i0 + 3 : i0;
+			int r = s0[i0] + s0[i1] + s1[i0] + s1[i1];
+			int g = s0[i0 + 1] + s0[i1 + 1] + s1[i0 + 1] + s1[i1 + 1];
+			int b = s0[i0 + 2] + s0[i1 + 2] + s1[i0 + 2] + s1[i1 + 2];
+
+			u[x] = GrabClamp(((-11059 * r - 21709 * g + 32768 * b) >> 18) + 128);
+			v[x] = GrabClamp(((32768 * r - 27439 * g - 5329 * b) >> 18) + 128);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+//	Osd
+//----------------------------------------------------------------------------
+
+///
+///	Blend and scale an ARGB osd over a packed RGB image.
+///
+///	@param dst		image
+///	@param dst_pitch	bytes per line of the image
+///	@param dw		image width
+///	@param dh		image height
+///	@param format		GRAB_RGB24 or GRAB_BGRA
+///	@param osd		osd pixels, ARGB8888 or ARGB4444
+///	@param osd_pitch	bytes per line of the osd
+///	@param ow		osd width
+///	@param oh		osd height
+///	@param argb4444		osd is ARGB4444
+///
+void GrabBlendOsd(uint8_t * dst, int dst_pitch, int dw, int dh, int format,
+    const uint8_t * osd, int osd_pitch, int ow, int oh, int argb4444)
+{
+	int bpp;
+	int ri;
+	int bi;
+	int x;
+	int y;
+
+	bpp = format == GRAB_BGRA ? 4 : 3;
+	ri = format == GRAB_BGRA ? 2 : 0;
+	bi = 2 - ri;
+
+	for (y = 0; y < dh; y++) {
+		const uint8_t *row = osd + (int)((int64_t)y * oh / dh) * osd_pitch;
+		uint8_t *out = dst + y * dst_pitch;
+
+		for (x = 0; x < dw; x++, out += bpp) {
+			int ox = (int)((int64_t)x * ow / dw);
+			int a, r, g, b;
+
+			if (argb4444) {
+				uint16_t p = ((const uint16_t *)row)[ox];
+
+				a = (p >> 12) * 17;
+				r = (p >> 8 & 0xF) * 17;
+				g = (p >> 4 & 0xF) * 17;
+				b = (p & 0xF) * 17;
+			} else {
+				a = row[ox * 4 + 3];
+				r = row[ox * 4 + 2];
+				g = row[ox * 4 + 1];
+				b = row[ox * 4 + 0];
+			}
+			if (!a)
+				continue;
+
+			out[ri] = (r * a + out[ri] * (255 - a) + 127) / 255;
+			out[1] = (g * a + out[1] * (255 - a) + 127) / 255;
+			out[bi] = (b * a + out[bi] * (255 - a) + 127) / 255;
+		}
+	}
+}
@@ -0,0 +1,75 @@
+///
+///	@file grab.h	@brief Screen grab conversion header file
+///
+///	Copyright (c) 2021 by zille.  All Rights Reserved.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+/// @addtogroup Grab
+/// @{
+
+//----------------------------------------------------------------------------
+//	Defines
+//----------------------------------------------------------------------------
+
+#define GRAB_RGB24	0		///< packed R, G, B bytes
+#define GRAB_BGRA	1		///< packed B, G, R, A bytes
+
+//----------------------------------------------------------------------------
+//	Typedefs
+//----------------------------------------------------------------------------
+
+    /// Grab source picture typedef
+typedef struct _grab_source_ GrabSource;
+
+///
+///	Grab source picture structure.
+///
+///	A mapped 8 bit YUV 4:2:0 picture, planar or with interleaved
+///	chroma (NV12).
+///
+struct _grab_source_
+{
+    const uint8_t *Plane[3];		///< Y, U and V or Y and UV plane
+    int Pitch[3];			///< bytes per line of the planes
+    int Width;				///< picture width
+    int Height;				///< picture height
+    int Nv12;				///< chroma interleaved in plane 1
+};
+
+//----------------------------------------------------------------------------
+//	Prototypes
+//----------------------------------------------------------------------------
+
+    /// Convert and scale a YUV picture to packed RGB
+extern int GrabConvert(const GrabSource *, int, int, int, int, uint8_t *,
+    int, int, int, int);
+
+    /// Box filter a YUV picture to a small packed RGB image
+extern int GrabSample(const GrabSource *, int, int, int, int, uint8_t *,
+    int, int, int, int);
+
+    /// Convert packed RGB to full range YUV 4:2:0
+extern void GrabRgbToYuv420(const uint8_t *, int, int, int,
+    uint8_t * const[3], const int[3]);
+
+    /// Blend and scale an ARGB osd over a packed RGB image
+extern void GrabBlendOsd(uint8_t *, int, int, int, int, const uint8_t *,
+    int, int, int, int);
+
+/// @}
@@ -26,9 +26,12 @@
 using std::string;
 #include <fstream>
 using std::ifstream;
+#include <deque>
+#include <vector>
 #include <sys/stat.h>
 
 #include <vdr/interface.h>
+#include <vdr/osd.h>
 #include <vdr/player.h>
 #include <vdr/plugin.h>
 #include <vdr/videodir.h>
@@ -55,6 +58,635 @@ av_always_inline char* av_err2str(int errnum)
 }
 #endif
 
+#define MEDIA_QUEUE_BYTES (32 * 1024 * 1024)	///< max bytes read ahead
+#define MEDIA_QUEUE_TIME 10000		///< max ms read ahead
+
+    /// AV_TIME_BASE_Q without compound literal
+static const AVRational MediaTimeBase = { 1, AV_TIME_BASE };
+
+//////////////////////////////////////////////////////////////////////////////
+//	cReader Mediaplayer
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+**	Read callback of the buffered io context.
+**
+**	Reads as large as the io buffer pass straight through to the
+**	protocol.
+*/
+static int MediaIoRead(void *opaque, uint8_t *buf, int size)
+{
+	int n;
+
+	n = avio_read((AVIOContext *)opaque, buf, size);
+	return n ? n : AVERROR_EOF;
+}
+
+/**
+**	Seek callback of the buffered io context.
+*/
+static int64_t MediaIoSeek(void *opaque, int64_t offset, int whence)
+{
+	AVIOContext *pb = (AVIOContext *)opaque;
+
+	if (whence & AVSEEK_SIZE)
+		return avio_size(pb);
+	return avio_seek(pb, offset, whence & ~AVSEEK_FORCE);
+}
+
+/**
+**	Open an io context with a buffer of ConfigMediaBufferSize KiB.
+**
+**	@param url	url to open
+**	@param inner	returns the io context of the protocol
+**
+**	@returns the buffered io context, NULL to use the ffmpeg default.
+*/
+static AVIOContext *MediaIoOpen(const char *url, AVIOContext **inner)
+{
+	AVIOContext *pb;
+	unsigned char *buf;
+	int size;
+
+	*inner = NULL;
+	if (ConfigMediaBufferSize <= 0 ||
+		avio_open2(inner, url, AVIO_FLAG_READ, NULL, NULL) < 0)
+		return NULL;
+
+	size = ConfigMediaBufferSize * 1024;
+	if (!(buf = (unsigned char *)av_malloc(size))) {
+		avio_closep(inner);
+		return NULL;
+	}
+	if (!(pb = avio_alloc_context(buf, size, 0, *inner, MediaIoRead,
+		NULL, MediaIoSeek))) {
+		av_free(buf);
+		avio_closep(inner);
+		return NULL;
+	}
+	pb->seekable = (*inner)->seekable;
+
+	return pb;
+}
+
+/**
+**	Close the io context of MediaIoOpen.
+*/
+static void MediaIoClose(AVIOContext **pb, AVIOContext **inner)
+{
+	if (*pb) {
+		av_freep(&(*pb)->buffer);
+		avio_context_free(pb);
+	}
+	avio_closep(inner);
+}
+
+/**
+**	Reader constructor.
+**
+**	@param format		opened input
+**	@param time_stream	stream whose packet durations bound the queue
+**				and whose key frames are indexed
+*/
+cSoftHdReader::cSoftHdReader(AVFormatContext *format, int time_stream)
+:cThread("softhddev media reader")
+{
+	Format = format;
+	TimeStream = time_stream;
+	Bytes = 0;
+	Time = 0;
+	Eof = 0;
+	Seeking = 0;
+	SeekPts = AV_NOPTS_VALUE;
+	// TS and PS have no index, the demuxer seeks by searching timestamps
+	ByteSeek = format->iformat->flags & AVFMT_TS_DISCONT &&
+		!(format->iformat->flags & AVFMT_NO_BYTE_SEEK) &&
+		format->pb && format->pb->seekable;
+	IndexGap = 0;
+	ReadBytes = 0;
+	ReadTime = cTimeMs::Now();
+	Underruns = 0;
+	Stalled = 0;
+}
+
+cSoftHdReader::~cSoftHdReader()
+{
+	Cancel(3);
+	Flush();
+}
+
+/**
+**	Play time of a packet in ms, if it counts for the queue limit.
+*/
+static int64_t MediaPacketTime(AVFormatContext *format, int stream,
+	AVPacket *pkt)
+{
+	if (pkt->stream_index != stream || pkt->duration <= 0)
+		return 0;
+	return av_rescale_q(pkt->duration, format->streams[stream]->time_base,
+		av_make_q(1, 1000));
+}
+
+/**
+**	Free all queued packets, called with the mutex locked.
+*/
+void cSoftHdReader::Flush(void)
+{
+	while (!Queue.empty()) {
+		AVPacket *pkt = Queue.front();
+
+		Queue.pop_front();
+		av_packet_free(&pkt);
+	}
+	Bytes = 0;
+	Time = 0;
+}
+
+void cSoftHdReader::Action(void)
+{
+	while (Running()) {
+		AVPacket *pkt;
+		int err;
+
+		Mutex.Lock();
+		for (size_t i = 0; i < Discards.size(); ++i) {
+			Format->streams[Discards[i].first]->discard =
+				(enum AVDiscard)Discards[i].second;
+		}
+		Discards.clear();
+		if (Seeking) {
+			Flush();
+			SeekInput(SeekPts);
+			Seeking = 0;
+			IndexGap = 1;
+			Eof = 0;
+			Cond.Broadcast();
+			Mutex.Unlock();
+			continue;
+		}
+		if (Eof || Bytes >= MEDIA_QUEUE_BYTES || Time >= MEDIA_QUEUE_TIME) {
+			Cond.TimedWait(Mutex, 100);
+			Mutex.Unlock();
+			continue;
+		}
+		Mutex.Unlock();
+
+		if (!(pkt = av_packet_alloc())) {
+			cCondWait::SleepMs(100);
+			continue;
+		}
+		err = av_read_frame(Format, pkt);
+
+		Mutex.Lock();
+		if (err < 0) {
+			av_packet_free(&pkt);
+			if (err != AVERROR(EAGAIN)) {
+#ifdef MEDIA_DEBUG
+				fprintf(stderr, "Reader: av_read_frame error: %s\n",
+					av_err2str(err));
+#endif
+				Eof = 1;
+			}
+		} else if (Seeking) {		// read before the seek request
+			av_packet_free(&pkt);
+		} else {
+			if (ByteSeek)
+				AddKeyFrame(pkt);
+			Queue.push_back(pkt);
+			Bytes += pkt->size;
+			Time += MediaPacketTime(Format, TimeStream, pkt);
+			ReadBytes += pkt->size;
+		}
+		Cond.Broadcast();
+		Mutex.Unlock();
+	}
+}
+
+/**
+**	Get the next packet of the input.
+**
+**	@param timeout	max ms to wait for the reader
+**
+**	@returns packet to be freed by the caller, NULL on timeout or end.
+*/
+AVPacket *cSoftHdReader::Get(int timeout)
+{
+	AVPacket *pkt;
+	cMutexLock lock(&Mutex);
+
+	if (Queue.empty() && !Eof) {
+		// a stall is counted once, not every poll of the empty queue
+		if (ReadBytes && !Seeking && !Stalled) {
+			Underruns++;
+			Stalled = 1;
+		}
+		Cond.TimedWait(Mutex, timeout);
+	}
+	if (Queue.empty())
+		return NULL;
+
+	Stalled = 0;
+	pkt = Queue.front();
+	Queue.pop_front();
+	Bytes -= pkt->size;
+	Time -= MediaPacketTime(Format, TimeStream, pkt);
+	Cond.Broadcast();
+
+	return pkt;
+}
+
+/**
+**	Check if all packets of the input are consumed.
+*/
+int cSoftHdReader::AtEnd(void)
+{
+	cMutexLock lock(&Mutex);
+
+	return Eof && Queue.empty();
+}
+
+/**
+**	Add a key frame to the index, called with the mutex locked.
+**
+**	The index grows with the read position, key frames read again
+**	after a seek backward are known already.
+*/
+void cSoftHdReader::AddKeyFrame(const AVPacket *pkt)
+{
+	MediaKeyFrame entry;
+
+	if (pkt->stream_index != TimeStream || !(pkt->flags & AV_PKT_FLAG_KEY) ||
+		pkt->pts == AV_NOPTS_VALUE || pkt->pos < 0)
+		return;
+
+	if (!Index.empty() && pkt->pts <= Index.back().Pts) {
+		IndexGap = 0;
+		return;
+	}
+	entry.Pts = pkt->pts;
+	entry.Pos = pkt->pos;
+	entry.Gap = IndexGap;
+	Index.push_back(entry);
+	IndexGap = 0;
+}
+
+/**
+**	Seek the input to the key frame before pts, called with the mutex
+**	locked.
+**
+**	Inside the indexed range the reader seeks straight to the position
+**	of the key frame, else the demuxer seeks backward to the nearest key
+**	frame.
+*/
+void cSoftHdReader::SeekInput(int64_t pts)
+{
+	size_t lo;
+	size_t hi;
+
+	lo = 0;
+	hi = Index.size();
+	while (lo < hi) {			// first key frame after pts
+		size_t mid = (lo + hi) / 2;
+
+		if (Index[mid].Pts <= pts)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo > 0 && lo < Index.size() && !Index[lo].Gap &&
+		av_seek_frame(Format, -1, Index[lo - 1].Pos, AVSEEK_FLAG_BYTE) >= 0)
+		return;
+
+	if (av_seek_frame(Format, TimeStream, pts, AVSEEK_FLAG_BACKWARD) < 0)
+		av_seek_frame(Format, TimeStream, pts, 0);
+}
+
+/**
+**	Seek the input on the reader thread and drop the read ahead.
+**
+**	@param pts	seek target in the time base of the indexed stream
+*/
+void cSoftHdReader::Seek(int64_t pts)
+{
+	cMutexLock lock(&Mutex);
+
+	Flush();
+	Seeking = 1;
+	SeekPts = pts;
+	Cond.Broadcast();
+	while (Seeking && Active())
+		Cond.TimedWait(Mutex, 100);
+}
+
+/**
+**	Change the discard of a stream before the next read.
+**
+**	@param stream	stream index
+**	@param discard	AVDISCARD_ALL skips the stream in the demuxer
+*/
+void cSoftHdReader::SetDiscard(int stream, int discard)
+{
+	cMutexLock lock(&Mutex);
+
+	Discards.push_back(std::make_pair(stream, discard));
+	Cond.Broadcast();
+}
+
+/**
+**	Get the read throughput in KiB/s since the start of the reader.
+*/
+int cSoftHdReader::Throughput(void)
+{
+	uint64_t elapsed;
+
+	elapsed = cTimeMs::Now() - ReadTime;
+	return elapsed ? ReadBytes * 1000 / 1024 / elapsed : 0;
+}
+
+/**
+**	Get how often the player waited for the reader.
+*/
+int cSoftHdReader::GetUnderruns(void)
+{
+	return Underruns;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//	cSubtitle Mediaplayer
+//////////////////////////////////////////////////////////////////////////////
+
+#define MEDIA_SUBTITLE_MAX 16		///< max decoded subtitles waiting
+
+/**
+**	Get the text of an ass dialog line without the override tags.
+*/
+static string MediaAssText(const char *ass)
+{
+	string text;
+	int fields;
+
+	// ReadOrder,Layer,Style,Name,MarginL,MarginR,MarginV,Effect,Text
+	fields = strncmp(ass, "Dialogue:", 9) ? 8 : 9;
+	while (*ass && fields) {
+		if (*ass++ == ',')
+			fields--;
+	}
+	while (*ass) {
+		if (*ass == '{') {
+			const char *end = strchr(ass, '}');
+
+			if (!end)
+				break;
+			ass = end + 1;
+		} else if (*ass == '\\' && (ass[1] == 'N' || ass[1] == 'n')) {
+			text += '\n';
+			ass += 2;
+		} else if (*ass == '\\' && ass[1] == 'h') {
+			text += ' ';
+			ass += 2;
+		} else if (*ass == '\r') {
+			ass++;
+		} else {
+			text += *ass++;
+		}
+	}
+	return text;
+}
+
+/**
+**	Get the ms of the audio clock to show a subtitle.
+*/
+static int64_t MediaSubtitleStart(const AVSubtitle *sub)
+{
+	if (sub->pts == AV_NOPTS_VALUE)
+		return 0;
+	return sub->pts / 1000 + sub->start_display_time;
+}
+
+/**
+**	Get the ms of the audio clock to hide a subtitle.
+**
+**	Subtitles without end stay until the next one.
+*/
+static int64_t MediaSubtitleEnd(const AVSubtitle *sub)
+{
+	if (sub->pts == AV_NOPTS_VALUE || sub->end_display_time == UINT32_MAX ||
+		sub->end_display_time <= sub->start_display_time)
+		return INT64_MAX;
+	return sub->pts / 1000 + sub->end_display_time;
+}
+
+static void MediaSubtitleFree(AVSubtitle **sub)
+{
+	if (*sub) {
+		avsubtitle_free(*sub);
+		av_freep(sub);
+	}
+}
+
+/**
+**	Subtitle render constructor.
+**
+**	@param st	subtitle stream
+*/
+cSoftHdSubtitle::cSoftHdSubtitle(const AVStream *st)
+{
+	const AVCodec *codec;
+
+	Shown = NULL;
+	End = INT64_MAX;
+	Osd = NULL;
+	Ctx = NULL;
+	if (!(codec = avcodec_find_decoder(st->codecpar->codec_id)) ||
+		!(Ctx = avcodec_alloc_context3(codec))) {
+		esyslog("[softhddev]mediaplayer: no subtitle decoder for %s\n",
+			avcodec_get_name(st->codecpar->codec_id));
+		return;
+	}
+	avcodec_parameters_to_context(Ctx, st->codecpar);
+	Ctx->pkt_timebase = st->time_base;
+	if (avcodec_open2(Ctx, codec, NULL) < 0) {
+		esyslog("[softhddev]mediaplayer: can't open subtitle decoder %s\n",
+			codec->name);
+		avcodec_free_context(&Ctx);
+	}
+}
+
+cSoftHdSubtitle::~cSoftHdSubtitle()
+{
+	Clear();
+	avcodec_free_context(&Ctx);
+}
+
+/**
+**	Decode a subtitle packet.
+*/
+void cSoftHdSubtitle::Decode(AVPacket *pkt)
+{
+	AVSubtitle *sub;
+	int got;
+
+	if (!Ctx || Pending.size() >= MEDIA_SUBTITLE_MAX)
+		return;
+	if (!(sub = (AVSubtitle *)av_mallocz(sizeof(*sub))))
+		return;
+
+	got = 0;
+	if (avcodec_decode_subtitle2(Ctx, sub, &got, pkt) < 0 || !got) {
+		av_free(sub);
+		return;
+	}
+	Pending.push_back(sub);
+}
+
+/**
+**	Show and hide the subtitles due at the clock.
+**
+**	@param clock	audio clock in ms
+*/
+void cSoftHdSubtitle::Show(int64_t clock)
+{
+	if (clock == AV_NOPTS_VALUE)
+		return;
+
+	while (!Pending.empty() && MediaSubtitleStart(Pending.front()) <= clock) {
+		MediaSubtitleFree(&Shown);
+		Shown = Pending.front();
+		Pending.pop_front();
+		End = MediaSubtitleEnd(Shown);
+		Draw();
+	}
+	if (Shown && clock >= End) {
+		Hide();
+		MediaSubtitleFree(&Shown);
+	}
+}
+
+/**
+**	Drop all subtitles, called on seek.
+*/
+void cSoftHdSubtitle::Clear(void)
+{
+	Hide();
+	MediaSubtitleFree(&Shown);
+	while (!Pending.empty()) {
+		AVSubtitle *sub = Pending.front();
+
+		Pending.pop_front();
+		MediaSubtitleFree(&sub);
+	}
+	if (Ctx)
+		avcodec_flush_buffers(Ctx);
+}
+
+void cSoftHdSubtitle::Hide(void)
+{
+	delete Osd;
+	Osd = NULL;
+}
+
+/**
+**	Draw the shown subtitle on a subtitle osd.
+*/
+void cSoftHdSubtitle::Draw(void)
+{
+	int width;
+	int height;
+	double aspect;
+
+	Hide();
+	if (!Shown->num_rects)
+		return;
+
+	cDevice::PrimaryDevice()->GetOsdSize(width, height, aspect);
+	if (!(Osd = cOsdProvider::NewOsd(0, 0, OSD_LEVEL_SUBTITLES)))
+		return;
+	tArea area = { 0, 0, width - 1, height - 1, 32 };
+	if (Osd->SetAreas(&area, 1) != oeOk) {
+		Hide();
+		return;
+	}
+	Osd->DrawRectangle(0, 0, width - 1, height - 1, clrTransparent);
+
+	for (unsigned i = 0; i < Shown->num_rects; ++i) {
+		const AVSubtitleRect *rect = Shown->rects[i];
+
+		if (rect->type == SUBTITLE_BITMAP) {
+			DrawBitmap(rect, width, height);
+		} else if (rect->type == SUBTITLE_ASS && rect->ass) {
+			DrawText(MediaAssText(rect->ass).c_str(), width, height);
+		} else if (rect->type == SUBTITLE_TEXT && rect->text) {
+			DrawText(rect->text, width, height);
+		}
+	}
+	Osd->Flush();
+}
+
+/**
+**	Draw a paletted subtitle bitmap scaled from the video to the osd.
+*/
+void cSoftHdSubtitle::DrawBitmap(const AVSubtitleRect *rect, int width,
+	int height)
+{
+	cBitmap *scaled;
+	double fx;
+	double fy;
+
+	if (rect->w <= 0 || rect->h <= 0 || rect->nb_colors > 256)
+		return;
+
+	// dvb subtitles without display definition are for sd
+	fx = (double)width / (Ctx->width ? Ctx->width : 720);
+	fy = (double)height / (Ctx->height ? Ctx->height : 576);
+
+	cBitmap bitmap(rect->w, rect->h, 8);
+	for (int i = 0; i < rect->nb_colors; ++i)
+		bitmap.SetColor(i, ((const uint32_t *)rect->data[1])[i]);
+	for (int y = 0; y < rect->h; ++y) {
+		for (int x = 0; x < rect->w; ++x) {
+			bitmap.SetIndex(x, y, rect->data[0][y * rect->linesize[0] + x]);
+		}
+	}
+
+	scaled = bitmap.Scaled(fx, fy, Setup.AntiAlias);
+	Osd->DrawBitmap(rect->x * fx, rect->y * fy, *scaled);
+	delete scaled;
+}
+
+/**
+**	Draw outlined text lines centered at the bottom of the osd.
+*/
+void cSoftHdSubtitle::DrawText(const char *text, int width, int height)
+{
+	const cFont *font = cFont::GetFont(fontOsd);
+	std::vector<string> lines;
+	string line;
+	int y;
+
+	for (; *text; ++text) {
+		if (*text == '\n') {
+			lines.push_back(line);
+			line.clear();
+		} else {
+			line += *text;
+		}
+	}
+	if (!line.empty())
+		lines.push_back(line);
+
+	y = height - height / 12 - (int)lines.size() * font->Height();
+	for (size_t i = 0; i < lines.size(); ++i, y += font->Height()) {
+		const char *s = lines[i].c_str();
+		int x = (width - font->Width(s)) / 2;
+
+		for (int d = 0; d < 4; ++d) {
+			Osd->DrawText(x + (d & 1 ? 2 : -2), y + (d & 2 ? 2 : -2), s,
+				clrBlack, clrTransparent, font);
+		}
+		Osd->DrawText(x, y, s, clrWhite, clrTransparent, font);
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //	cPlayer Mediaplayer
 //////////////////////////////////////////////////////////////////////////////
@@ -187,22 +819,88 @@ void cSoftHdPlayer::SetEntry(int index)
 	StopPlay = 1;
 }
 
+/**
+**	Make the audio and subtitle streams selectable in the vdr menus.
+**
+**	@param format	opened input
+**	@param audio	stream index of the current audio track
+*/
+void cSoftHdPlayer::SetTracks(AVFormatContext *format, int audio)
+{
+	int audio_tracks = 0;
+	int subtitle_tracks = 0;
+
+	DeviceClrAvailableTracks();
+	for (unsigned int i = 0; i < format->nb_streams; i++) {
+		AVStream *st = format->streams[i];
+		AVDictionaryEntry *lang = av_dict_get(st->metadata, "language", NULL, 0);
+		AVDictionaryEntry *title = av_dict_get(st->metadata, "title", NULL, 0);
+		const char *name = title ? title->value :
+			avcodec_get_name(st->codecpar->codec_id);
+
+		if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+			audio_tracks < ttMaxTrackAudio) {
+			DeviceSetAvailableTrack(ttAudio, audio_tracks, i,
+				lang ? lang->value : NULL, name);
+			if ((int)i == audio)
+				DeviceSetCurrentAudioTrack(eTrackType(ttAudio + audio_tracks));
+			audio_tracks++;
+		} else if (st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE &&
+			subtitle_tracks < ttMaxTrackSubtitle &&
+			avcodec_find_decoder(st->codecpar->codec_id)) {
+			DeviceSetAvailableTrack(ttSubtitle, subtitle_tracks, i,
+				lang ? lang->value : NULL, name);
+			subtitle_tracks++;
+		}
+	}
+}
+
+/**
+**	Select an audio track, called by vdr.
+*/
+void cSoftHdPlayer::SetAudioTrack(eTrackType type, const tTrackId *track)
+{
+	if (IS_AUDIO_TRACK(type) && track)
+		AudioTrack = track->id;
+}
+
+/**
+**	Select a subtitle track, called by vdr.
+*/
+void cSoftHdPlayer::SetSubtitleTrack(eTrackType type, const tTrackId *track)
+{
+	SubtitleTrack = IS_SUBTITLE_TRACK(type) && track ? track->id : -1;
+}
+
 void cSoftHdPlayer::Player(const char *url)
 {
-	AVPacket packet;
+	AVPacket *packet;
 	AVCodec *video_codec;
-	int err = 0;
+	AVIOContext *pb;
+	AVIOContext *inner;
+	cSoftHdReader *reader;
+	cSoftHdSubtitle *subtitle = NULL;
+	int subtitle_stream_index = -1;
 	int audio_stream_index = 0;
 	int video_stream_index;
 	int jump_stream_index = 0;
 	int start_time;
+	int64_t last_pts = AV_NOPTS_VALUE;
+	int64_t audio_skip = AV_NOPTS_VALUE;
+	uint64_t seek_tick = 0;
+	int seek_demux = 0;
+	int seek_jump = 0;
+	int reseek;
 
 	StopPlay = 0;
 	Jump = 0;
 
 	AVFormatContext *format = avformat_alloc_context();
+	if ((pb = MediaIoOpen(url, &inner)))
+		format->pb = pb;
 	if (avformat_open_input(&format, url, NULL, NULL) != 0) {
 		fprintf(stderr, "Mediaplayer: Could not open file '%s'\n", url);
+		MediaIoClose(&pb, &inner);
 		return;
 	}
 #ifdef MEDIA_DEBUG
@@ -210,6 +908,8 @@ void cSoftHdPlayer::Player(const char *url)
 #endif
 	if (avformat_find_stream_info(format, NULL) < 0) {
 		fprintf(stderr, "Mediaplayer: Could not retrieve stream info from file '%s'\n", url);
+		avformat_close_input(&format);
+		MediaIoClose(&pb, &inner);
 		return;
 	}
 
@@ -239,61 +939,180 @@ void cSoftHdPlayer::Player(const char *url)
 	Duration = format->duration / AV_TIME_BASE;
 	start_time = format->start_time / AV_TIME_BASE;
 
+	// the demuxer skips the packets of the unused streams
+	for (unsigned int i = 0; i < format->nb_streams; i++) {
+		if ((int)i != audio_stream_index && (int)i != video_stream_index)
+			format->streams[i]->discard = AVDISCARD_ALL;
+	}
+	AudioTrack = audio_stream_index;
+	SubtitleTrack = -1;
+	SetTracks(format, audio_stream_index);
+
+	reader = new cSoftHdReader(format, jump_stream_index);
+	reader->Start();
+
 	while (!StopPlay) {
-		err = av_read_frame(format, &packet);
-		if (err == 0) {
-repeat:
-			if (audio_stream_index == packet.stream_index) {
-				if (!PlayAudioPkts(&packet)) {
-					usleep(packet.duration * AV_TIME_BASE *
-						format->streams[audio_stream_index]->time_base.num
-						/ format->streams[audio_stream_index]->time_base.den);
-					goto repeat;
-				}
-				CurrentTime = AudioGetClock() / 1000 - start_time;
+		reseek = 0;
+		// subtitle track changed
+		if (SubtitleTrack != subtitle_stream_index) {
+			int track = SubtitleTrack;
+
+			delete subtitle;
+			subtitle = NULL;
+			if (subtitle_stream_index >= 0)
+				reader->SetDiscard(subtitle_stream_index, AVDISCARD_ALL);
+			subtitle_stream_index = -1;
+			if (track >= 0 && track < (int)format->nb_streams &&
+				format->streams[track]->codecpar->codec_type ==
+				AVMEDIA_TYPE_SUBTITLE) {
+				subtitle = new cSoftHdSubtitle(format->streams[track]);
+				reader->SetDiscard(track, AVDISCARD_DEFAULT);
+				subtitle_stream_index = track;
 			}
+			SubtitleTrack = subtitle_stream_index;
+		}
+		// audio track changed, read again from the shown position
+		if (AudioTrack != audio_stream_index) {
+			int track = AudioTrack;
+
+			if (track >= 0 && track < (int)format->nb_streams &&
+				format->streams[track]->codecpar->codec_type ==
+				AVMEDIA_TYPE_AUDIO) {
+				AVStream *st = format->streams[track];
+
+				reader->SetDiscard(audio_stream_index, AVDISCARD_ALL);
+				reader->SetDiscard(track, AVDISCARD_DEFAULT);
+				audio_stream_index = track;
+				SetAudioCodec(st->codecpar->codec_id, st->codecpar,
+					&st->time_base);
+				reseek = 1;
+			} else {
+				AudioTrack = audio_stream_index;
+			}
+		}
 
-			if (video_stream_index == packet.stream_index) {
-				if (!PlayVideoPkts(&packet)) {
-					usleep(packet.duration * AV_TIME_BASE *
-						format->streams[video_stream_index]->time_base.num
-						/ format->streams[video_stream_index]->time_base.den);
-					goto repeat;
+		if (Jump || reseek) {
+			if (format->pb && format->pb->seekable) {
+				AVStream *st = format->streams[jump_stream_index];
+				int64_t clock = AudioGetClock();
+				int64_t target;
+
+				seek_tick = Jump ? cTimeMs::Now() : 0;
+				seek_jump = Jump;
+				// the demuxer reads ahead, start at the shown position
+				if (clock != (int64_t)AV_NOPTS_VALUE)
+					target = clock * 1000;
+				else if (last_pts != (int64_t)AV_NOPTS_VALUE)
+					target = av_rescale_q(last_pts, st->time_base,
+						MediaTimeBase);
+				else
+					target = 0;
+				target += (int64_t)Jump * AV_TIME_BASE;
+				if (format->start_time != (int64_t)AV_NOPTS_VALUE) {
+					if (format->duration > AV_TIME_BASE &&
+						target > format->start_time + format->duration -
+						AV_TIME_BASE)
+						target = format->start_time + format->duration -
+							AV_TIME_BASE;
+					if (target < format->start_time)
+						target = format->start_time;
 				}
+
+				reader->Seek(av_rescale_q(target, MediaTimeBase,
+					st->time_base));
+				seek_demux = seek_tick ? cTimeMs::Now() - seek_tick : 0;
+				SeekClear(video_stream_index < 0 ? AV_NOPTS_VALUE :
+					av_rescale_q(target, MediaTimeBase,
+					format->streams[video_stream_index]->time_base));
+				audio_skip = av_rescale_q(target, MediaTimeBase,
+					format->streams[audio_stream_index]->time_base);
+				last_pts = AV_NOPTS_VALUE;
+				if (subtitle)
+					subtitle->Clear();
 			}
-		} else {
-#ifdef MEDIA_DEBUG
-			fprintf(stderr, "Player: av_read_frame error: %s\n",
-				av_err2str(err));
-#endif
-			StopPlay = 1;
+			Jump = 0;
+		}
+		if (subtitle)
+			subtitle->Show(AudioGetClock());
+
+		if (!(packet = reader->Get(100))) {
+			if (reader->AtEnd())
+				StopPlay = 1;
 			continue;
 		}
 
-		while (Pause) {
-			sleep(1);
+		// decode the audio from the seek target
+		if (audio_skip != (int64_t)AV_NOPTS_VALUE &&
+			audio_stream_index == packet->stream_index) {
+			if (packet->pts != (int64_t)AV_NOPTS_VALUE &&
+				packet->pts + packet->duration <= audio_skip) {
+				av_packet_free(&packet);
+				continue;
+			}
+			audio_skip = AV_NOPTS_VALUE;
+		}
+repeat:
+		if (audio_stream_index == packet->stream_index) {
+			if (!PlayAudioPkts(packet)) {
+				usleep(packet->duration * AV_TIME_BASE *
+					format->streams[audio_stream_index]->time_base.num
+					/ format->streams[audio_stream_index]->time_base.den);
+				goto repeat;
+			}
+			CurrentTime = AudioGetClock() / 1000 - start_time;
 		}
 
-		if (Jump && format->pb->seekable) {
-			av_seek_frame(format, format->streams[jump_stream_index]->index,
-				packet.pts + (int64_t)(Jump *		// - BufferOffset
-				format->streams[jump_stream_index]->time_base.den /
-				format->streams[jump_stream_index]->time_base.num), 0);
-			Clear();
-			Jump = 0;
+		if (video_stream_index == packet->stream_index) {
+			if (!PlayVideoPkts(packet)) {
+				usleep(packet->duration * AV_TIME_BASE *
+					format->streams[video_stream_index]->time_base.num
+					/ format->streams[video_stream_index]->time_base.den);
+				goto repeat;
+			}
+		}
+
+		if (subtitle && subtitle_stream_index == packet->stream_index)
+			subtitle->Decode(packet);
+
+		if (jump_stream_index == packet->stream_index &&
+			packet->pts != (int64_t)AV_NOPTS_VALUE)
+			last_pts = packet->pts;
+
+		// seek latency until the first frame at the target is shown
+		if (seek_tick) {
+			int first_frame;
+			int sync;
+
+			GetZapTime(&first_frame, &sync);
+			if (first_frame || video_stream_index < 0) {
+				isyslog("[softhddev]mediaplayer: jump %+ds, demuxer seek %dms, first frame after %dms\n",
+					seek_jump, seek_demux, seek_demux + first_frame);
+				seek_tick = 0;
+			}
+		}
+
+		while (Pause) {
+			sleep(1);
 		}
 
 		if (StopPlay)
 			Clear();
 
-		av_packet_unref(&packet);
+		av_packet_free(&packet);
 	}
 
+	isyslog("[softhddev]mediaplayer: read %d KiB/s, read ahead ran dry %d times\n",
+		reader->Throughput(), reader->GetUnderruns());
+	delete reader;
+	delete subtitle;
+	DeviceClrAvailableTracks();
+
 	Duration = 0;
 	CurrentTime = 0;
 
 	avformat_close_input(&format);
 	avformat_free_context(format);
+	MediaIoClose(&pb, &inner);
 }
 
 const char * cSoftHdPlayer::GetTitle(void)
@@ -473,6 +1292,12 @@ void cSoftHdMenu::MainMenu(void)
 	int duped;
 	int dropped;
 	int counter;
+	int first_frame;
+	int sync;
+	const char *filter;
+	int threads;
+	int us;
+	int load;
 
 	current = Current();		// get current menu item index
 	Clear();				// clear the menu
@@ -485,6 +1310,16 @@ void cSoftHdMenu::MainMenu(void)
 	Add(new cOsdItem(cString::sprintf(tr
 		(" Frames duped(%d) dropped(%d) total(%d)"),
 		duped, dropped, counter), osUnknown, false));
+	GetZapTime(&first_frame, &sync);
+	Add(new cOsdItem(cString::sprintf(tr
+		(" Channel switch first frame(%dms) a/v sync(%dms)"),
+		first_frame, sync), osUnknown, false));
+	GetFilterStats(&filter, &threads, &us, &load);
+	if (filter) {
+		Add(new cOsdItem(cString::sprintf(tr
+			(" Filter %s threads(%d) %dus/frame (%d%%)"),
+			filter, threads, us, load), osUnknown, false));
+	}
 
 	SetCurrent(Get(current));		// restore selected menu entry
 	Display();
@@ -28,6 +28,92 @@
 		struct PLEntry *NextEntry;
 	};
 
+extern int ConfigMediaBufferSize;	///< config media player io buffer (KiB)
+
+//////////////////////////////////////////////////////////////////////////////
+//	cReader
+//////////////////////////////////////////////////////////////////////////////
+
+	struct MediaKeyFrame {
+		int64_t Pts;
+		int64_t Pos;
+		int Gap;		///< not read contiguous after the previous
+	};
+
+/**
+**	read ahead thread of the mediaplayer.
+**
+**	Demuxes the input on its own thread into a packet queue bounded by
+**	bytes and play time, so slow reads don't stall the device feeders.
+**	Indexes the key frames of byte seekable streams for seeking.
+*/
+class cSoftHdReader : public cThread
+{
+private:
+	struct AVFormatContext *Format;
+	int TimeStream;
+	std::deque<struct AVPacket *> Queue;
+	cMutex Mutex;
+	cCondVar Cond;
+	int Bytes;
+	int64_t Time;
+	int Eof;
+	int Seeking;
+	int64_t SeekPts;
+	int ByteSeek;
+	int IndexGap;
+	std::vector<MediaKeyFrame> Index;
+	std::vector<std::pair<int, int> > Discards;
+	int64_t ReadBytes;
+	uint64_t ReadTime;
+	int Underruns;
+	int Stalled;
+	void Flush(void);
+	void AddKeyFrame(const struct AVPacket *);
+	void SeekInput(int64_t);
+protected:
+	virtual void Action(void);
+public:
+	cSoftHdReader(struct AVFormatContext *, int);
+	virtual ~ cSoftHdReader();
+	struct AVPacket *Get(int);
+	int AtEnd(void);
+	void Seek(int64_t);
+	void SetDiscard(int, int);
+	int Throughput(void);
+	int GetUnderruns(void);
+};
+
+//////////////////////////////////////////////////////////////////////////////
+//	cSubtitle
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+**	subtitle render of the mediaplayer.
+**
+**	Decodes bitmap and text subtitles and shows them on a subtitle osd
+**	in sync with the audio clock.
+*/
+class cSoftHdSubtitle
+{
+private:
+	struct AVCodecContext *Ctx;
+	std::deque<struct AVSubtitle *> Pending;
+	struct AVSubtitle *Shown;
+	int64_t End;
+	cOsd *Osd;
+	void Draw(void);
+	void DrawBitmap(const struct AVSubtitleRect *, int, int);
+	void DrawText(const char *, int, int);
+	void Hide(void);
+public:
+	cSoftHdSubtitle(const struct AVStream *);
+	virtual ~ cSoftHdSubtitle();
+	void Decode(struct AVPacket *);
+	void Show(int64_t);
+	void Clear(void);
+};
+
 //////////////////////////////////////////////////////////////////////////////
 //	cPlayer
 //////////////////////////////////////////////////////////////////////////////
@@ -40,6 +126,7 @@ class cSoftHdPlayer : public cPlayer, cThread
 private:
 	void Player(const char *);
 	void ReadPL(const char *);
+	void SetTracks(struct AVFormatContext *, int);
 	char *Source;
 	int Entries;
 protected:
@@ -52,6 +139,10 @@ public:
 	struct PLEntry *CurrentEntry;
 	void SetEntry(int);
 	const char * GetTitle(void);
+	virtual void SetAudioTrack(eTrackType, const tTrackId *);
+	virtual void SetSubtitleTrack(eTrackType, const tTrackId *);
+	int AudioTrack;
+	int SubtitleTrack;
 	int Jump;
 	int Pause;
 	int StopPlay;
@@ -27,6 +27,8 @@
 #include <syslog.h>
 #include <stdarg.h>
 #include <time.h>			// clock_gettime
+#include <pthread.h>
+#include <sched.h>			// cpu_set_t, SCHED_FIFO
 
 //////////////////////////////////////////////////////////////////////////////
 //	Defines
@@ -154,6 +156,91 @@ static inline uint32_t GetMsTicks(void)
 #endif
 }
 
+/**
+**	Get ticks in us.
+**
+**	@returns ticks in us,
+*/
+static inline uint64_t GetUsTicks(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec tspec;
+
+    clock_gettime(CLOCK_MONOTONIC, &tspec);
+    return (tspec.tv_sec * (uint64_t)1000000) + (tspec.tv_nsec / 1000);
+#else
+    struct timeval tval;
+
+    if (gettimeofday(&tval, NULL) < 0) {
+	return 0;
+    }
+    return (tval.tv_sec * (uint64_t)1000000) + tval.tv_usec;
+#endif
+}
+
+/**
+**	Bind the calling thread to cpus.
+**
+**	Threads created later by the thread inherit the affinity.
+**
+**	@param cpus	cpu mask, bit n = cpu n, 0 = keep the affinity
+**
+**	@retval 0	affinity set
+**	@retval -1	no cpus given or failed
+*/
+static inline int SetThreadCpus(int cpus)
+{
+    cpu_set_t set;
+    int cpu;
+
+    if (cpus <= 0) {
+	return -1;
+    }
+    CPU_ZERO(&set);
+    for (cpu = 0; cpu < 31; cpu++) {
+	if (cpus & (1 << cpu)) {
+	    CPU_SET(cpu, &set);
+	}
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+	Warning("misc: can't bind thread to cpus %#x\n", cpus);
+	return -1;
+    }
+    return 0;
+}
+
+/**
+**	Set the realtime priority of the calling thread.
+**
+**	Needs CAP_SYS_NICE or a rtprio limit, otherwise the thread keeps
+**	the normal scheduling.
+**
+**	@param prio	1 .. 99 = SCHED_FIFO, -1 .. -99 = SCHED_RR priority,
+**			0 = keep normal scheduling
+**
+**	@retval 0	priority set
+**	@retval -1	no priority given or failed
+*/
+static inline int SetThreadPriority(int prio)
+{
+    struct sched_param param;
+    int policy;
+
+    if (!prio) {
+	return -1;
+    }
+    policy = prio > 0 ? SCHED_FIFO : SCHED_RR;
+    param.sched_priority = prio > 0 ? prio : -prio;
+    if (param.sched_priority > 99) {
+	param.sched_priority = 99;
+    }
+    if (pthread_setschedparam(pthread_self(), policy, &param)) {
+	Warning("misc: can't set thread priority %d\n", prio);
+	return -1;
+    }
+    return 0;
+}
+
 /**
 **	Read if there a PES packet length in PES header.
 **
@@ -0,0 +1,601 @@
+///
+///	@file parser.c	@brief Video elementary stream parser
+///
+///	Copyright (c) 2021 by zille.  All Rights Reserved.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@defgroup Parser The video elementary stream parser.
+///
+///	Start code scanner and sequence header parser for MPEG-2, H.264
+///	and HEVC. All functions are re-entrant, the parser has no state.
+///
+
+#include <stdint.h>
+#include <string.h>
+
+#include <libavcodec/avcodec.h>
+
+#include "parser.h"
+
+    /// max size of a sequence header without emulation prevention bytes
+#define PARSER_HEADER_MAX 512
+
+//----------------------------------------------------------------------------
+//	Bitstream reader
+//----------------------------------------------------------------------------
+
+/**
+**	Init bitstream reader.
+**
+**	@param br	bitstream reader
+**	@param data	bitstream data
+**	@param size	bytes in data
+*/
+void BitReaderInit(BitReader * br, const uint8_t * data, int size)
+{
+	br->Data = data;
+	br->Size = size;
+	br->Pos = 0;
+}
+
+/**
+**	Read up to 32 bits.
+**
+**	Bits behind the end of the data are read as 0.
+**
+**	@param br	bitstream reader
+**	@param n	number of bits
+*/
+uint32_t BitReaderGet(BitReader * br, int n)
+{
+	uint32_t r = 0;
+
+	while (n > 0) {
+		int index = br->Pos >> 3;
+		int offset = br->Pos & 7;
+		int take = 8 - offset;
+		uint32_t byte;
+
+		if (take > n)
+			take = n;
+		byte = index < br->Size ? br->Data[index] : 0;
+		r = (r << take) | ((byte >> (8 - offset - take)) & ((1 << take) - 1));
+		br->Pos += take;
+		n -= take;
+	}
+	return r;
+}
+
+/**
+**	Read unsigned exp-golomb code.
+**
+**	@param br	bitstream reader
+*/
+uint32_t BitReaderGetUE(BitReader * br)
+{
+	int zeros = 0;
+
+	while (!BitReaderGet(br, 1) && zeros < 31) {
+		if (br->Pos > br->Size * 8)
+			return 0;
+		zeros++;
+	}
+	return ((1U << zeros) - 1) + BitReaderGet(br, zeros);
+}
+
+/**
+**	Read signed exp-golomb code.
+**
+**	@param br	bitstream reader
+*/
+int32_t BitReaderGetSE(BitReader * br)
+{
+	uint32_t r = BitReaderGetUE(br);
+
+	if (r & 0x01)
+		return (r + 1) / 2;
+	return -(int32_t)(r / 2);
+}
+
+//----------------------------------------------------------------------------
+//	Start code
+//----------------------------------------------------------------------------
+
+/**
+**	Find next 00 00 01 start code.
+**
+**	memchr searches the 0x01 with the vector unit of the cpu, the two
+**	zero bytes are checked only at the hits.
+**
+**	@param data	begin of data
+**	@param end	end of data
+**
+**	@returns pointer to the first 00 of the start code or end.
+*/
+const uint8_t *ParseFindStartCode(const uint8_t * data, const uint8_t * end)
+{
+	const uint8_t *p = data + 2;
+
+	while (p < end) {
+		if (!(p = memchr(p, 0x01, end - p)))
+			return end;
+		if (!p[-1] && !p[-2])
+			return p - 2;
+		// a start code ending behind p needs two zeros behind p
+		p += 3;
+	}
+	return end;
+}
+
+/**
+**	Copy a NAL unit without emulation prevention bytes.
+**
+**	@param dst	destination buffer with PARSER_HEADER_MAX bytes
+**	@param src	NAL unit payload
+**	@param size	bytes in src
+**
+**	@returns bytes in dst.
+*/
+static int ParseUnescape(uint8_t * dst, const uint8_t * src, int size)
+{
+	int zeros = 0;
+	int n = 0;
+	int i;
+
+	for (i = 0; i < size && n < PARSER_HEADER_MAX; ++i) {
+		if (zeros >= 2 && src[i] == 0x03) {
+			zeros = 0;
+			continue;
+		}
+		zeros = src[i] ? 0 : zeros + 1;
+		dst[n++] = src[i];
+	}
+	return n;
+}
+
+/**
+**	Detect the codec of a PES payload.
+**
+**	The payload must start with an access unit delimiter (H.264, HEVC)
+**	or a sequence header / picture start code (MPEG-2), only zero bytes
+**	may be in front of it. A start code in the middle of the payload
+**	belongs to a continued access unit and isn't detected.
+**
+**	@param data		PES payload
+**	@param size		bytes in payload
+**	@param[out] offset	offset of the start code in the payload
+**
+**	@returns codec id or AV_CODEC_ID_NONE.
+*/
+int ParseDetectCodec(const uint8_t * data, int size, int *offset)
+{
+	const uint8_t *p;
+	int i;
+
+	for (i = 0; i < size && !data[i]; ++i) ;
+	// data[i] is the first non zero byte, the start code ends there
+	if (i < 2 || i + 3 > size || data[i] != 0x01)
+		return AV_CODEC_ID_NONE;
+	p = data + i - 2;
+	*offset = i - 2;
+
+	switch (p[3]) {
+		case 0xB3:			// MPEG-2 sequence header
+		case 0x00:			// MPEG-2 picture
+			return AV_CODEC_ID_MPEG2VIDEO;
+		case 0x09:			// H.264 access unit delimiter
+			return AV_CODEC_ID_H264;
+		case 0x46:			// HEVC access unit delimiter
+			return AV_CODEC_ID_HEVC;
+	}
+	return AV_CODEC_ID_NONE;
+}
+
+//----------------------------------------------------------------------------
+//	Sequence header
+//----------------------------------------------------------------------------
+
+/**
+**	Parse a H.264 sequence parameter set.
+**
+**	@param info	stream info
+**	@param data	SPS without NAL header
+**	@param size	bytes in data
+*/
+static void ParseH264Sps(VideoStreamInfo * info, const uint8_t * data, int size)
+{
+	uint8_t buf[PARSER_HEADER_MAX];
+	BitReader br[1];
+	int chroma_format_idc = 1;
+	int separate_colour_plane = 0;
+	int bit_depth = 8;
+	int frame_mbs_only;
+	int width_mbs;
+	int height_map_units;
+	int crop_left = 0;
+	int crop_right = 0;
+	int crop_top = 0;
+	int crop_bottom = 0;
+	int crop_unit_x;
+	int crop_unit_y;
+	int profile_idc;
+	int i;
+
+	BitReaderInit(br, buf, ParseUnescape(buf, data, size));
+
+	profile_idc = BitReaderGet(br, 8);
+	BitReaderGet(br, 8);			// constraint flags
+	info->Level = BitReaderGet(br, 8);
+	BitReaderGetUE(br);			// seq_parameter_set_id
+
+	if (profile_idc == 100 || profile_idc == 110 ||
+		profile_idc == 122 || profile_idc == 244 ||
+		profile_idc == 44 || profile_idc == 83 ||
+		profile_idc == 86 || profile_idc == 118 ||
+		profile_idc == 128 || profile_idc == 138 ||
+		profile_idc == 139 || profile_idc == 134 ||
+		profile_idc == 135) {
+
+		chroma_format_idc = BitReaderGetUE(br);
+		if (chroma_format_idc == 3)
+			separate_colour_plane = BitReaderGet(br, 1);
+		bit_depth = BitReaderGetUE(br) + 8;
+		BitReaderGetUE(br);		// bit_depth_chroma_minus8
+		BitReaderGet(br, 1);		// qpprime_y_zero_transform_bypass
+		if (BitReaderGet(br, 1)) {	// seq_scaling_matrix_present
+			for (i = 0; i < (chroma_format_idc != 3 ? 8 : 12); i++) {
+				if (BitReaderGet(br, 1)) {
+					int size_of_list = (i < 6) ? 16 : 64;
+					int last_scale = 8;
+					int next_scale = 8;
+					int j;
+
+					for (j = 0; j < size_of_list; j++) {
+						if (next_scale)
+							next_scale = (last_scale + BitReaderGetSE(br) + 256) % 256;
+						last_scale = next_scale ? next_scale : last_scale;
+					}
+				}
+			}
+		}
+	}
+	BitReaderGetUE(br);			// log2_max_frame_num_minus4
+	switch (BitReaderGetUE(br)) {		// pic_order_cnt_type
+		case 0:
+			BitReaderGetUE(br);
+			break;
+		case 1: {
+			int n;
+
+			BitReaderGet(br, 1);
+			BitReaderGetSE(br);
+			BitReaderGetSE(br);
+			n = BitReaderGetUE(br);
+			for (i = 0; i < n && i < 256; i++)
+				BitReaderGetSE(br);
+			break;
+		}
+	}
+	BitReaderGetUE(br);			// max_num_ref_frames
+	BitReaderGet(br, 1);			// gaps_in_frame_num_allowed
+	width_mbs = BitReaderGetUE(br) + 1;
+	height_map_units = BitReaderGetUE(br) + 1;
+	frame_mbs_only = BitReaderGet(br, 1);
+	if (!frame_mbs_only)
+		BitReaderGet(br, 1);		// mb_adaptive_frame_field
+	BitReaderGet(br, 1);			// direct_8x8_inference
+	if (BitReaderGet(br, 1)) {		// frame_cropping
+		crop_left = BitReaderGetUE(br);
+		crop_right = BitReaderGetUE(br);
+		crop_top = BitReaderGetUE(br);
+		crop_bottom = BitReaderGetUE(br);
+	}
+
+	// crop units in luma samples
+	if (chroma_format_idc == 0 || separate_colour_plane) {
+		crop_unit_x = 1;
+		crop_unit_y = 2 - frame_mbs_only;
+	} else {
+		crop_unit_x = chroma_format_idc == 3 ? 1 : 2;
+		crop_unit_y = (chroma_format_idc == 1 ? 2 : 1) * (2 - frame_mbs_only);
+	}
+
+	info->CodecID = AV_CODEC_ID_H264;
+	info->Profile = profile_idc;
+	info->BitDepth = bit_depth;
+	info->ChromaFormat = chroma_format_idc;
+	info->Interlaced = !frame_mbs_only;
+	info->Width = width_mbs * 16 - (crop_left + crop_right) * crop_unit_x;
+	info->Height = (2 - frame_mbs_only) * height_map_units * 16 -
+		(crop_top + crop_bottom) * crop_unit_y;
+}
+
+/**
+**	Parse a HEVC sequence parameter set.
+**
+**	@param info	stream info
+**	@param data	SPS without NAL header
+**	@param size	bytes in data
+*/
+static void ParseHevcSps(VideoStreamInfo * info, const uint8_t * data, int size)
+{
+	uint8_t buf[PARSER_HEADER_MAX];
+	BitReader br[1];
+	int max_sub_layers;
+	int sub_layer_profile[8];
+	int sub_layer_level[8];
+	int progressive_source;
+	int interlaced_source;
+	int chroma_format_idc;
+	int width;
+	int height;
+	int sub_width = 1;
+	int sub_height = 1;
+	int i;
+
+	BitReaderInit(br, buf, ParseUnescape(buf, data, size));
+
+	BitReaderGet(br, 4);			// sps_video_parameter_set_id
+	max_sub_layers = BitReaderGet(br, 3) + 1;
+	BitReaderGet(br, 1);			// temporal_id_nesting
+
+	// profile_tier_level
+	BitReaderGet(br, 2);			// general_profile_space
+	BitReaderGet(br, 1);			// general_tier
+	info->Profile = BitReaderGet(br, 5);
+	BitReaderGet(br, 32);			// profile compatibility flags
+	progressive_source = BitReaderGet(br, 1);
+	interlaced_source = BitReaderGet(br, 1);
+	BitReaderGet(br, 2);			// non_packed, frame_only
+	BitReaderGet(br, 32);			// 43 reserved bits + inbld
+	BitReaderGet(br, 12);
+	info->Level = BitReaderGet(br, 8);
+	for (i = 0; i < max_sub_layers - 1; i++) {
+		sub_layer_profile[i] = BitReaderGet(br, 1);
+		sub_layer_level[i] = BitReaderGet(br, 1);
+	}
+	if (max_sub_layers > 1) {
+		for (i = max_sub_layers - 1; i < 8; i++)
+			BitReaderGet(br, 2);	// reserved_zero_2bits
+	}
+	for (i = 0; i < max_sub_layers - 1; i++) {
+		if (sub_layer_profile[i]) {
+			BitReaderGet(br, 32);
+			BitReaderGet(br, 32);
+			BitReaderGet(br, 24);
+		}
+		if (sub_layer_level[i])
+			BitReaderGet(br, 8);
+	}
+
+	BitReaderGetUE(br);			// sps_seq_parameter_set_id
+	chroma_format_idc = BitReaderGetUE(br);
+	if (chroma_format_idc == 3)
+		BitReaderGet(br, 1);		// separate_colour_plane
+	width = BitReaderGetUE(br);
+	height = BitReaderGetUE(br);
+	if (BitReaderGet(br, 1)) {		// conformance_window
+		if (chroma_format_idc == 1 || chroma_format_idc == 2)
+			sub_width = 2;
+		if (chroma_format_idc == 1)
+			sub_height = 2;
+		width -= (BitReaderGetUE(br) + BitReaderGetUE(br)) * sub_width;
+		height -= (BitReaderGetUE(br) + BitReaderGetUE(br)) * sub_height;
+	}
+
+	info->CodecID = AV_CODEC_ID_HEVC;
+	info->BitDepth = BitReaderGetUE(br) + 8;
+	info->ChromaFormat = chroma_format_idc;
+	info->Interlaced = interlaced_source && !progressive_source;
+	info->Width = width;
+	info->Height = height;
+}
+
+/**
+**	Parse a MPEG-2 sequence header and its sequence extension.
+**
+**	@param info	stream info
+**	@param data	sequence header after the start code
+**	@param end	end of the packet
+*/
+static void ParseMpeg2Sequence(VideoStreamInfo * info, const uint8_t * data,
+	const uint8_t * end)
+{
+	BitReader br[1];
+	const uint8_t *p;
+
+	BitReaderInit(br, data, end - data);
+
+	info->CodecID = AV_CODEC_ID_MPEG2VIDEO;
+	info->Width = BitReaderGet(br, 12);
+	info->Height = BitReaderGet(br, 12);
+	info->BitDepth = 8;
+	info->ChromaFormat = 1;
+	info->Profile = 0;
+	info->Level = 0;
+	info->Interlaced = 0;			// MPEG-1 is progressive
+
+	// sequence extension follows the sequence header
+	p = ParseFindStartCode(data, end);
+	if (p + 9 < end && p[3] == 0xB5 && (p[4] >> 4) == 0x01) {
+		BitReaderInit(br, p + 4, end - p - 4);
+		BitReaderGet(br, 4);		// extension_start_code_identifier
+		BitReaderGet(br, 1);		// escape bit
+		info->Profile = BitReaderGet(br, 3);
+		info->Level = BitReaderGet(br, 4);
+		info->Interlaced = !BitReaderGet(br, 1);
+		info->ChromaFormat = BitReaderGet(br, 2);
+		info->Width |= BitReaderGet(br, 2) << 12;
+		info->Height |= BitReaderGet(br, 2) << 12;
+	}
+}
+
+/**
+**	Parse the sequence header of an elementary stream packet.
+**
+**	The scan stops at the first slice or picture, the sequence header is
+**	always in front of it.
+**
+**	@param codec_id	codec id of the stream
+**	@param data	elementary stream data
+**	@param size	bytes in data
+**	@param[out] info	stream info, only changed if a header is found
+**
+**	@returns 1 if a sequence header is parsed.
+*/
+int ParseStreamInfo(int codec_id, const uint8_t * data, int size,
+	VideoStreamInfo * info)
+{
+	const uint8_t *end = data + size;
+	const uint8_t *p = data;
+	const uint8_t *next;
+	int type;
+
+	while ((p = ParseFindStartCode(p, end)) + 5 < end) {
+		next = ParseFindStartCode(p + 3, end);
+		switch (codec_id) {
+			case AV_CODEC_ID_MPEG2VIDEO:
+				if (p[3] == 0xB3) {
+					ParseMpeg2Sequence(info, p + 4, end);
+					return 1;
+				}
+				if (!p[3])		// picture
+					return 0;
+				break;
+			case AV_CODEC_ID_H264:
+				type = p[3] & 0x1F;
+				if (type == 7) {
+					ParseH264Sps(info, p + 4, next - p - 4);
+					return 1;
+				}
+				if (type >= 1 && type <= 5)	// slice
+					return 0;
+				break;
+			case AV_CODEC_ID_HEVC:
+				type = (p[3] >> 1) & 0x3F;
+				if (type == 33) {
+					ParseHevcSps(info, p + 5, next - p - 5);
+					return 1;
+				}
+				if (type < 32)		// slice
+					return 0;
+				break;
+			default:
+				return 0;
+		}
+		p = next;
+	}
+	return 0;
+}
+
+/**
+**	Check if an elementary stream packet starts a decodable picture.
+**
+**	MPEG-2 needs a sequence header or an I-picture, H.264 an IDR picture
+**	or SPS and HEVC an IRAP picture or VPS/SPS in front of the first slice.
+**
+**	@param codec_id	codec id of the stream
+**	@param data	elementary stream data
+**	@param size	bytes in data
+*/
+int ParseIsKeyFrame(int codec_id, const uint8_t * data, int size)
+{
+	const uint8_t *end = data + size;
+	const uint8_t *p = data;
+
+	while ((p = ParseFindStartCode(p, end)) + 5 < end) {
+		switch (codec_id) {
+			case AV_CODEC_ID_MPEG2VIDEO:
+				if (p[3] == 0xB3)	// sequence header
+					return 1;
+				if (!p[3])		// picture, I-frame?
+					return ((p[5] >> 3) & 0x07) == 1;
+				break;
+			case AV_CODEC_ID_H264:
+				switch (p[3] & 0x1F) {
+					case 5:		// IDR slice
+					case 7:		// SPS
+						return 1;
+					case 1:		// non IDR slice
+						return 0;
+				}
+				break;
+			case AV_CODEC_ID_HEVC:
+				switch ((p[3] >> 1) & 0x3F) {
+					case 16 ... 21:	// IRAP slice
+					case 32:	// VPS
+					case 33:	// SPS
+						return 1;
+					case 0 ... 9:	// non IRAP slice
+						return 0;
+				}
+				break;
+			default:
+				return 1;
+		}
+		p += 3;
+	}
+	return 0;
+}
+
+/**
+**	Check if an elementary stream packet has a reference picture.
+**
+**	Non-reference pictures are MPEG-2 B-pictures, H.264 slices with
+**	nal_ref_idc 0 and HEVC sub-layer non-reference and RASL pictures.
+**	The first slice or picture decides.
+**
+**	@param codec_id	codec id of the stream
+**	@param data	elementary stream data
+**	@param size	bytes in data
+**
+**	@returns 0 if no other picture references the picture.
+*/
+int ParseIsReference(int codec_id, const uint8_t * data, int size)
+{
+	const uint8_t *end = data + size;
+	const uint8_t *p = data;
+	int type;
+
+	while ((p = ParseFindStartCode(p, end)) + 5 < end) {
+		switch (codec_id) {
+			case AV_CODEC_ID_MPEG2VIDEO:
+				if (!p[3])		// picture, B-frame?
+					return ((p[5] >> 3) & 0x07) != 3;
+				break;
+			case AV_CODEC_ID_H264:
+				type = p[3] & 0x1F;
+				if (type >= 1 && type <= 5)	// slice
+					return (p[3] >> 5) & 0x03;
+				break;
+			case AV_CODEC_ID_HEVC:
+				type = (p[3] >> 1) & 0x3F;
+				if (type < 16)		// non IRAP slice
+					return (type & 1) && type != 9;
+				if (type < 32)
+					return 1;
+				break;
+			default:
+				return 1;
+		}
+		p += 3;
+	}
+	return 1;
+}
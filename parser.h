@@ -0,0 +1,95 @@
+///
+///	@file parser.h	@brief Video elementary stream parser header file
+///
+///	Copyright (c) 2021 by zille.  All Rights Reserved.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+/// @addtogroup Parser
+/// @{
+
+//----------------------------------------------------------------------------
+//	Typedefs
+//----------------------------------------------------------------------------
+
+    /// Bitstream reader typedef
+typedef struct _bit_reader_ BitReader;
+
+    /// Video stream info typedef
+typedef struct _video_stream_info_ VideoStreamInfo;
+
+///
+///	Bitstream reader structure.
+///
+struct _bit_reader_
+{
+    const uint8_t *Data;		///< bitstream data
+    int Size;				///< bytes in data
+    int Pos;				///< current bit position
+};
+
+///
+///	Video stream info structure.
+///
+///	Filled from the sequence header (SPS, MPEG-2 sequence header and
+///	extension) of the elementary stream.
+///
+struct _video_stream_info_
+{
+    int CodecID;			///< codec id of the parsed header
+    int Width;				///< picture width without cropping
+    int Height;				///< picture height without cropping
+    int Interlaced;			///< stream is coded interlaced
+    int Profile;			///< profile (idc)
+    int Level;				///< level (idc)
+    int BitDepth;			///< luma bit depth
+    int ChromaFormat;			///< 0 mono, 1 4:2:0, 2 4:2:2, 3 4:4:4
+};
+
+//----------------------------------------------------------------------------
+//	Prototypes
+//----------------------------------------------------------------------------
+
+    /// Init bitstream reader
+extern void BitReaderInit(BitReader *, const uint8_t *, int);
+
+    /// Read up to 32 bits
+extern uint32_t BitReaderGet(BitReader *, int);
+
+    /// Read unsigned exp-golomb code
+extern uint32_t BitReaderGetUE(BitReader *);
+
+    /// Read signed exp-golomb code
+extern int32_t BitReaderGetSE(BitReader *);
+
+    /// Find next 00 00 01 start code
+extern const uint8_t *ParseFindStartCode(const uint8_t *, const uint8_t *);
+
+    /// Detect the codec of a PES payload
+extern int ParseDetectCodec(const uint8_t *, int, int *);
+
+    /// Parse the sequence header of an elementary stream packet
+extern int ParseStreamInfo(int, const uint8_t *, int, VideoStreamInfo *);
+
+    /// Check if an elementary stream packet starts a decodable picture
+extern int ParseIsKeyFrame(int, const uint8_t *, int);
+
+    /// Check if an elementary stream packet has a reference picture
+extern int ParseIsReference(int, const uint8_t *, int);
+
+/// @}
@@ -48,12 +48,14 @@
 #include "audio.h"
 #include "video.h"
 #include "codec.h"
+#include "parser.h"
 
 //////////////////////////////////////////////////////////////////////////////
 //	Variables
 //////////////////////////////////////////////////////////////////////////////
 
 extern int ConfigAudioBufferTime;	///< config size ms of audio buffer
+extern int ConfigFastSwitch;		///< config fast channel switch
 
 static volatile char StreamFreezed;	///< stream freezed
 
@@ -63,6 +65,8 @@ static volatile char StreamFreezed;	///< stream freezed
 
 #define VIDEO_BUFFER_SIZE (512 * 1024)	///< video PES buffer default size
 #define VIDEO_PACKET_MAX 192		///< max number of video packets
+#define VIDEO_SCAN_TAIL 5		///< bytes behind a start code to check it
+#define STILL_TIMEOUT 500		///< max ms to wait for a still picture
 
 /**
 **	Video output stream device structure.	Parser, decoder, display.
@@ -79,6 +83,15 @@ struct __video_stream__
     volatile char NewStream;		///< flag new video stream
     volatile char ClosingStream;	///< flag closing video stream
     volatile char TrickSpeed;		///< current trick speed
+    volatile char TrickLevel;		///< 1 drop non-reference, 2 key only
+    volatile char Still;		///< still picture: 1 queued, 2 complete
+    volatile char Reverse;		///< reverse playback requested
+    char ReverseActive;			///< decoder runs in reverse mode
+    int ReverseGop;			///< packets of the current reverse gop
+    int SkipToKeyFrame;			///< packets to skip until key frame
+    VideoStreamInfo Info;		///< parsed sequence header
+    int AuPicture;			///< current access unit has a picture
+    int ScanTail;			///< unchecked bytes at the end of the packet
 
     AVPacket PacketRb[VIDEO_PACKET_MAX];	///< PES packet ring buffer
     int PacketWrite;			///< ring buffer write pointer
@@ -87,6 +100,7 @@ struct __video_stream__
 };
 
 static VideoStream MyVideoStream[1];	///< normal video stream
+static VideoStream PipVideoStream[1];	///< pip video stream
 
 static pthread_mutex_t PktsLockMutex;	///< video packets lock mutex
 
@@ -789,150 +803,17 @@ void PrintStreamData(const uint8_t *data, int size)
 		data[27], data[28], data[29], data[30], data[31], data[32], data[33], data[34], size);
 }
 
-// helper functions to parse resolution from stream
-const unsigned char * m_pStart;
-unsigned short m_nLength;
-int m_nCurrentBit;
-
-unsigned int ReadBit()
-{
-	assert(m_nCurrentBit <= m_nLength * 8);
-	int nIndex = m_nCurrentBit / 8;
-	int nOffset = m_nCurrentBit % 8 + 1;
-
-	m_nCurrentBit++;
-	return (m_pStart[nIndex] >> (8-nOffset)) & 0x01;
-}
-
-unsigned int ReadBits(int n)
-{
-	int r = 0;
-
-	for (int i = 0; i < n; i++) {
-		r |= ( ReadBit() << ( n - i - 1 ) );
-	}
-	return r;
-}
-
-unsigned int ReadExponentialGolombCode()
+/**
+**	Get the stream info of the video stream.
+**
+**	The info is parsed from the sequence headers of the enqueued
+**	packets, Width is 0 until the first header is seen.
+**
+**	@param stream	video stream
+*/
+const VideoStreamInfo *GetVideoStreamInfo(VideoStream * stream)
 {
-	int r = 0;
-	int i = 0;
-
-	while((ReadBit() == 0) && (i < 32)) {
-		i++;
-	}
-
-	r = ReadBits(i);
-	r += (1 << i) - 1;
-	return r;
-}
-
-unsigned int ReadSE()
-{
-	int r = ReadExponentialGolombCode();
-
-	if (r & 0x01) {
-		r = (r+1)/2;
-	} else {
-		r = -(r/2);
-	}
-	return r;
-}
-
-void ParseResolutionH264(int *width, int *height)
-{
-	AVPacket *avpkt;
-	const unsigned char * pStart;
-
-	avpkt = &MyVideoStream->PacketRb[MyVideoStream->PacketRead];
-
-	for (int i = 0; i < avpkt->size; i++) {
-		if (!avpkt->data[i] && !avpkt->data[i + 1] &&
-			avpkt->data[i + 2] == 0x01 && avpkt->data[i + 3] == 0x67) {
-
-			m_pStart = pStart = &avpkt->data[i + 4];
-			m_nLength = avpkt->size - i - 4;
-			break;
-		}
-	}
-	m_nCurrentBit = 0;
-
-	int frame_crop_left_offset=0;
-	int frame_crop_right_offset=0;
-	int frame_crop_top_offset=0;
-	int frame_crop_bottom_offset=0;
-
-	int profile_idc = ReadBits(8);
-	ReadBits(16);
-	ReadExponentialGolombCode();
-
-
-	if (profile_idc == 100 || profile_idc == 110 ||
-		profile_idc == 122 || profile_idc == 244 ||
-		profile_idc == 44 || profile_idc == 83 ||
-		profile_idc == 86 || profile_idc == 118) {
-
-		int chroma_format_idc = ReadExponentialGolombCode();
-		if (chroma_format_idc == 3) {
-			ReadBit();
-		}
-		ReadExponentialGolombCode();
-		ReadExponentialGolombCode();
-		ReadBit();
-		int seq_scaling_matrix_present_flag = ReadBit();
-		if (seq_scaling_matrix_present_flag) {
-			for (int i = 0; i < 8; i++) {
-				int seq_scaling_list_present_flag = ReadBit();
-				if (seq_scaling_list_present_flag) {
-					int sizeOfScalingList = (i < 6) ? 16 : 64;
-					int lastScale = 8;
-					int nextScale = 8;
-					for (int j = 0; j < sizeOfScalingList; j++) {
-						if (nextScale != 0) {
-							int delta_scale = ReadSE();
-							nextScale = (lastScale + delta_scale + 256) % 256;
-						}
-						lastScale = (nextScale == 0) ? lastScale : nextScale;
-					}
-				}
-			}
-		}
-	}
-	ReadExponentialGolombCode();
-	int pic_order_cnt_type = ReadExponentialGolombCode();
-	if (pic_order_cnt_type == 0) {
-		ReadExponentialGolombCode();
-	} else if (pic_order_cnt_type == 1) {
-		ReadBit();
-		ReadSE();
-		ReadSE();
-		int num_ref_frames_in_pic_order_cnt_cycle = ReadExponentialGolombCode();
-		for (int i = 0; i < num_ref_frames_in_pic_order_cnt_cycle; i++ ) {
-			ReadSE();
-		}
-	}
-	ReadExponentialGolombCode();
-	ReadBit();
-	int pic_width_in_mbs_minus1 = ReadExponentialGolombCode();
-	int pic_height_in_map_units_minus1 = ReadExponentialGolombCode();
-	int frame_mbs_only_flag = ReadBit();
-	if (!frame_mbs_only_flag) {
-		ReadBit();
-	}
-	ReadBit();
-	int frame_cropping_flag = ReadBit();
-	if (frame_cropping_flag) {
-		frame_crop_left_offset = ReadExponentialGolombCode();
-		frame_crop_right_offset = ReadExponentialGolombCode();
-		frame_crop_top_offset = ReadExponentialGolombCode();
-		frame_crop_bottom_offset = ReadExponentialGolombCode();
-	}
-
-	*width = ((pic_width_in_mbs_minus1 +1)*16) - frame_crop_bottom_offset*2 -
-		frame_crop_top_offset*2;
-	*height = ((2 - frame_mbs_only_flag)* (pic_height_in_map_units_minus1 +1) * 16) -
-		(frame_crop_right_offset * 2) - (frame_crop_left_offset * 2);
+	return &stream->Info;
 }
 
 /**
@@ -972,34 +853,52 @@ static void VideoPacketExit(VideoStream * stream)
 }
 
 /**
-**	Place video data in packet ringbuffer.
+**	Finish the current packet and start a new one.
 **
 **	@param stream	video stream
-**	@param pts	presentation timestamp of pes packet
-**	@param data	data of pes packet
-**	@param size	size of pes packet
+**	@param pts	presentation timestamp of the new packet
+**	@param dts	decoding timestamp of the new packet
 */
-static void VideoEnqueue(VideoStream * stream, int64_t pts, const void *data,
-		int size)
+static void VideoNextPacket(VideoStream * stream, int64_t pts, int64_t dts)
 {
 	AVPacket *avpkt;
 
-//	PrintStreamData(data, size);
-//	fprintf(stderr, "VideoEnqueue: pts %s size %d\n",
-//		PtsTimestamp2String(pts), size);
-
 	avpkt = &stream->PacketRb[stream->PacketWrite];
+	if (avpkt->size) {
+		// the ring buffer is full, the write pointer must not pass the
+		// read pointer
+		if (atomic_read(&stream->PacketsFilled) >= VIDEO_PACKET_MAX - 1) {
+			Warning(_("video: packet buffer full, access unit dropped\n"));
+		} else {
+			if (ParseIsKeyFrame(stream->CodecID, avpkt->data, avpkt->size))
+				avpkt->flags |= AV_PKT_FLAG_KEY;
+			else if (!ParseIsReference(stream->CodecID, avpkt->data, avpkt->size))
+				avpkt->flags |= AV_PKT_FLAG_DISPOSABLE;
 
-	if (pts != AV_NOPTS_VALUE) {
-		if (avpkt->size) {
 			stream->PacketWrite = (stream->PacketWrite + 1) % VIDEO_PACKET_MAX;
 			atomic_inc(&stream->PacketsFilled);
+			avpkt = &stream->PacketRb[stream->PacketWrite];
 		}
-		avpkt = &stream->PacketRb[stream->PacketWrite];
-		avpkt->size = 0;
-		avpkt->pts = pts;
-		avpkt->dts = AV_NOPTS_VALUE;
 	}
+	avpkt->size = 0;
+	avpkt->pts = pts;
+	avpkt->dts = dts;
+	avpkt->flags = 0;
+}
+
+/**
+**	Append video data to the current packet.
+**
+**	@param stream	video stream
+**	@param data	elementary stream data
+**	@param size	bytes in data
+*/
+static void VideoPacketAppend(VideoStream * stream, const uint8_t * data,
+		int size)
+{
+	AVPacket *avpkt;
+
+	avpkt = &stream->PacketRb[stream->PacketWrite];
 
 	if (avpkt->size + size >= avpkt->buf->size) {
 		int pkt_size = avpkt->size;
@@ -1014,6 +913,153 @@ static void VideoEnqueue(VideoStream * stream, int64_t pts, const void *data,
 	memset(avpkt->data + avpkt->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
 }
 
+/**
+**	Check if a start code begins a new access unit.
+**
+**	Access unit delimiters always begin one. Without delimiters the
+**	parameter sets, SEI and the first slice of a picture begin a new
+**	access unit, if the current one already has a picture.
+**
+**	@param stream	video stream
+**	@param p	start code 00 00 01 with at least 3 bytes behind
+*/
+static int VideoIsAccessUnitStart(VideoStream * stream, const uint8_t * p)
+{
+	int start = 0;
+	int type;
+
+	switch (stream->CodecID) {
+		case AV_CODEC_ID_MPEG2VIDEO:
+			switch (p[3]) {
+				case 0xB3:		// sequence header
+				case 0xB8:		// group of pictures
+					start = stream->AuPicture;
+					stream->AuPicture = 0;
+					break;
+				case 0x00:		// picture
+					start = stream->AuPicture;
+					stream->AuPicture = 1;
+					break;
+			}
+			break;
+		case AV_CODEC_ID_H264:
+			type = p[3] & 0x1F;
+			if (type == 9) {		// access unit delimiter
+				start = 1;
+				stream->AuPicture = 0;
+			} else if ((type >= 6 && type <= 8) || (type >= 14 && type <= 18)) {
+				start = stream->AuPicture;
+				stream->AuPicture = 0;
+			} else if (type >= 1 && type <= 5) {
+				// first_mb_in_slice == 0
+				if (p[4] & 0x80) {
+					start = stream->AuPicture;
+				}
+				stream->AuPicture = 1;
+			}
+			break;
+		case AV_CODEC_ID_HEVC:
+			type = (p[3] >> 1) & 0x3F;
+			if (type == 35) {		// access unit delimiter
+				start = 1;
+				stream->AuPicture = 0;
+			} else if ((type >= 32 && type <= 34) || type == 39 ||
+				(type >= 41 && type <= 44) || (type >= 48 && type <= 55)) {
+				start = stream->AuPicture;
+				stream->AuPicture = 0;
+			} else if (type < 32) {
+				// first_slice_segment_in_pic_flag
+				if (p[5] & 0x80) {
+					start = stream->AuPicture;
+				}
+				stream->AuPicture = 1;
+			}
+			break;
+		default:
+			break;
+	}
+	return start;
+}
+
+/**
+**	Place video data in packet ringbuffer.
+**
+**	The data is split into access units, every packet gets exactly one
+**	access unit. The timestamps of the PES packet belong to the first
+**	access unit starting in it. If no access unit start is found, a PES
+**	packet with timestamp starts a new packet.
+**
+**	The last bytes of a PES packet are too short to check a start code,
+**	they are checked together with the begin of the next PES packet. An
+**	access unit with a start code split over the PES packets gets the
+**	timestamps of the second one.
+**
+**	@param stream	video stream
+**	@param pts	presentation timestamp of pes packet
+**	@param dts	decoding timestamp of pes packet
+**	@param data	data of pes packet
+**	@param size	size of pes packet
+*/
+static void VideoEnqueue(VideoStream * stream, int64_t pts, int64_t dts,
+		const void *data, int size)
+{
+	const uint8_t *p = data;
+	const uint8_t *end = p + size;
+	const uint8_t *sc;
+	AVPacket *avpkt;
+	int tail;
+
+//	PrintStreamData(data, size);
+//	fprintf(stderr, "VideoEnqueue: pts %s size %d\n",
+//		PtsTimestamp2String(pts), size);
+
+	// start codes in the unchecked end of the previous PES packet
+	avpkt = &stream->PacketRb[stream->PacketWrite];
+	tail = stream->ScanTail < avpkt->size ? stream->ScanTail : avpkt->size;
+	if (tail) {
+		uint8_t join[2 * VIDEO_SCAN_TAIL];
+		const uint8_t *join_end;
+
+		memcpy(join, avpkt->data + avpkt->size - tail, tail);
+		memcpy(join + tail, data, size < VIDEO_SCAN_TAIL ? size : VIDEO_SCAN_TAIL);
+		join_end = join + tail + (size < VIDEO_SCAN_TAIL ? size : VIDEO_SCAN_TAIL);
+
+		for (sc = join; (sc = ParseFindStartCode(sc, join_end)) < join + tail &&
+			sc + 5 < join_end; sc += 3) {
+			int moved;
+
+			if (!VideoIsAccessUnitStart(stream, sc)) {
+				continue;
+			}
+			// move the begin of the access unit into a new packet
+			moved = join + tail - sc;
+			avpkt = &stream->PacketRb[stream->PacketWrite];
+			avpkt->size -= moved;
+			memset(avpkt->data + avpkt->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+			VideoNextPacket(stream, pts, dts);
+			VideoPacketAppend(stream, sc, moved);
+			pts = dts = AV_NOPTS_VALUE;
+		}
+	}
+	stream->ScanTail = size < VIDEO_SCAN_TAIL ? size : VIDEO_SCAN_TAIL;
+
+	for (sc = p; (sc = ParseFindStartCode(sc, end)) + 5 < end; sc += 3) {
+		if (!VideoIsAccessUnitStart(stream, sc)) {
+			continue;
+		}
+		VideoPacketAppend(stream, p, sc - p);
+		VideoNextPacket(stream, pts, dts);
+		pts = dts = AV_NOPTS_VALUE;
+		p = sc;
+	}
+
+	// no access unit start found
+	if (pts != AV_NOPTS_VALUE) {
+		VideoNextPacket(stream, pts, dts);
+	}
+	VideoPacketAppend(stream, p, end - p);
+}
+
 /**
 **	Close video stream.
 **
@@ -1052,11 +1098,115 @@ void ClearVideo(VideoStream * stream)
 	avpkt = &stream->PacketRb[stream->PacketWrite];
 	avpkt->size = 0;
 	avpkt->pts = AV_NOPTS_VALUE;
+	avpkt->dts = AV_NOPTS_VALUE;
+	avpkt->flags = 0;
+	stream->AuPicture = 0;
+	stream->ScanTail = 0;
 
 	CodecVideoFlushBuffers(stream->Decoder);
 	pthread_mutex_unlock(&PktsLockMutex);
 }
 
+/**
+**	Check if a video packet starts a decodable picture.
+**
+**	Packets of the mediaplayer have the key flag of the demuxer, PES
+**	packets get it from the access unit splitter.
+**
+**	@param avpkt	video packet
+*/
+static int VideoIsKeyPacket(const AVPacket * avpkt)
+{
+	return avpkt->flags & AV_PKT_FLAG_KEY;
+}
+
+/**
+**	End a reverse gop.
+**
+**	All frames of the gop are decoded and buffered by the render.
+**
+**	@param stream	video stream
+*/
+static void VideoReverseGop(VideoStream * stream)
+{
+	CodecVideoDrain(stream->Decoder, 0);
+	stream->ReverseGop = 0;
+}
+
+/**
+**	Decode from PES packet ringbuffer in reverse playback.
+**
+**	The packets of a gop are decoded in stream order, the next key
+**	packet ends the gop. The buffered frames of the gop are shown
+**	newest first before the next gop is decoded. Packets before the
+**	first key packet can't be decoded and are dropped.
+**
+**	@param stream	video stream
+**
+**	@retval 0	packet decoded
+**	@retval	-1	empty stream
+*/
+static int VideoDecodeReverse(VideoStream * stream)
+{
+	AVPacket *avpkt;
+
+	if (VideoReverseOutput(stream->Render))
+		return 0;
+
+	pthread_mutex_lock(&PktsLockMutex);
+	if (!atomic_read(&stream->PacketsFilled)) {
+		pthread_mutex_unlock(&PktsLockMutex);
+		return -1;
+	}
+	avpkt = &stream->PacketRb[stream->PacketRead];
+
+	if (VideoIsKeyPacket(avpkt)) {
+		if (stream->ReverseGop) {
+			pthread_mutex_unlock(&PktsLockMutex);
+			VideoReverseGop(stream);
+			return 0;
+		}
+	} else if (!stream->ReverseGop) {
+		stream->PacketRead = (stream->PacketRead + 1) % VIDEO_PACKET_MAX;
+		atomic_dec(&stream->PacketsFilled);
+		pthread_mutex_unlock(&PktsLockMutex);
+		return 0;
+	}
+
+	if (!CodecVideoSendPacket(stream->Decoder, avpkt)) {
+		stream->PacketRead = (stream->PacketRead + 1) % VIDEO_PACKET_MAX;
+		atomic_dec(&stream->PacketsFilled);
+		stream->ReverseGop++;
+	}
+	pthread_mutex_unlock(&PktsLockMutex);
+
+	while (!CodecVideoReceiveFrame(stream->Decoder, 0))
+		;
+
+	// key frames only, every packet is a gop
+	if (stream->TrickLevel >= 2 && stream->ReverseGop)
+		VideoReverseGop(stream);
+
+	return 0;
+}
+
+/**
+**	Switch the decoder between forward and reverse playback.
+**
+**	@param stream	video stream
+**	@param on	1 = reverse playback
+*/
+static void VideoReverseMode(VideoStream * stream, int on)
+{
+#ifdef DEBUG
+	fprintf(stderr, "VideoReverseMode: %d\n", on);
+#endif
+	VideoSetReverse(stream->Render, on);
+	CodecVideoFlushBuffers(stream->Decoder);
+	stream->ReverseActive = on;
+	stream->ReverseGop = 0;
+}
+
 /**
 **	Decode from PES packet ringbuffer.
 **
@@ -1070,7 +1220,7 @@ int VideoDecodeInput(VideoStream * stream)
 {
 	AVPacket *avpkt;
 
-	if (StreamFreezed) {		// stream freezed
+	if (StreamFreezed && stream == MyVideoStream && !stream->Still) {	// stream freezed
 //		fprintf(stderr, "VideoDecodeInput: stream->Freezed\n");
 		// clear is called during freezed
 		return 1;
@@ -1078,6 +1228,8 @@ int VideoDecodeInput(VideoStream * stream)
 
 	if (stream->ClosingStream && stream->CodecID != AV_CODEC_ID_NONE) {
 
+		if (stream->ReverseActive)
+			VideoReverseMode(stream, 0);
 		if (atomic_read(&stream->PacketsFilled)) {
 #ifdef DEBUG
 			fprintf(stderr, "VideoDecodeInput: ClearVideo(stream)\n");
@@ -1091,19 +1243,59 @@ int VideoDecodeInput(VideoStream * stream)
 	}
 
 	if (stream->NewStream && stream->CodecID != AV_CODEC_ID_NONE) {
+		// codec change without close
+		CodecVideoClose(stream->Decoder);
 		CodecVideoOpen(stream->Decoder, stream->CodecID, stream->Par,
 			&stream->timebase);
 		stream->NewStream = 0;
 		stream->Par = NULL;
+		// start decoding with a key frame, max. one packet buffer
+		if (ConfigFastSwitch)
+			stream->SkipToKeyFrame = VIDEO_PACKET_MAX;
+	}
+
+	if (stream->CodecID != AV_CODEC_ID_NONE && !stream->NewStream) {
+		int reverse = stream->Reverse && !stream->Still;
+
+		if (reverse != stream->ReverseActive)
+			VideoReverseMode(stream, reverse);
+		if (stream->ReverseActive)
+			return VideoDecodeReverse(stream);
 	}
 
 	if (stream->CodecID != AV_CODEC_ID_NONE) {
 		pthread_mutex_lock(&PktsLockMutex);
 		if (!atomic_read(&stream->PacketsFilled)) {
 			pthread_mutex_unlock(&PktsLockMutex);
+			// still picture: force the output of the frame
+			if (stream->Still == 2) {
+				CodecVideoDrain(stream->Decoder, 1);
+				stream->Still = 0;
+				return 0;
+			}
 			return -1;
 		}
 		avpkt = &stream->PacketRb[stream->PacketRead];
+		// trick speed: decode only the frames that are shown
+		if (stream->TrickSpeed && ((stream->TrickLevel >= 2 &&
+			!(avpkt->flags & AV_PKT_FLAG_KEY)) || (stream->TrickLevel >= 1 &&
+			avpkt->flags & AV_PKT_FLAG_DISPOSABLE))) {
+			stream->PacketRead = (stream->PacketRead + 1) % VIDEO_PACKET_MAX;
+			atomic_dec(&stream->PacketsFilled);
+			pthread_mutex_unlock(&PktsLockMutex);
+			return 0;
+		}
+		if (stream->SkipToKeyFrame) {
+			if (VideoIsKeyPacket(avpkt)) {
+				stream->SkipToKeyFrame = 0;
+			} else {
+				stream->SkipToKeyFrame--;
+				stream->PacketRead = (stream->PacketRead + 1) % VIDEO_PACKET_MAX;
+				atomic_dec(&stream->PacketsFilled);
+				pthread_mutex_unlock(&PktsLockMutex);
+				return 0;
+			}
+		}
 		if (!CodecVideoSendPacket(stream->Decoder, avpkt)) {
 			stream->PacketRead = (stream->PacketRead + 1) % VIDEO_PACKET_MAX;
 			atomic_dec(&stream->PacketsFilled);
@@ -1111,7 +1303,7 @@ int VideoDecodeInput(VideoStream * stream)
 		pthread_mutex_unlock(&PktsLockMutex);
 
 		if (!stream->NewStream)
-			CodecVideoReceiveFrame(stream->Decoder, 0);
+			CodecVideoReceiveFrame(stream->Decoder, stream->Still);
 	}
 
 	return 0;
@@ -1127,9 +1319,28 @@ int VideoGetPackets(const VideoStream * stream)
     return atomic_read(&stream->PacketsFilled);
 }
 
+/**
+**	Start a new PES video stream with the given codec.
+**
+**	@param stream		video stream
+**	@param codec_id		detected codec
+*/
+static void VideoNewCodec(VideoStream * stream, enum AVCodecID codec_id)
+{
+	Debug(3, "video: %s detected\n", avcodec_get_name(codec_id));
+	stream->CodecID = codec_id;
+	stream->NewStream = 1;
+	stream->timebase.den = 90000;
+	stream->timebase.num = 1;
+	memset(&stream->Info, 0, sizeof(stream->Info));
+	stream->AuPicture = 0;
+	stream->ScanTail = 0;
+}
+
 /**
 **	Play video packet.
 **
+**	@param stream		video stream
 **	@param data		data of exactly one complete PES packet
 **	@param size		size of PES packet
 **
@@ -1141,15 +1352,16 @@ int VideoGetPackets(const VideoStream * stream)
 **	is no problem, the audio is always far behind us.
 **	cTsToPes::GetPes splits the packets.
 */
-int PlayVideo(const uint8_t * data, int size)
+static int PlayVideo3(VideoStream * stream, const uint8_t * data, int size)
 {
-	VideoStream * stream = MyVideoStream;
 	int64_t pts = AV_NOPTS_VALUE;
+	int64_t dts = AV_NOPTS_VALUE;
+	enum AVCodecID codec_id;
 	int i, n;
 
 //	fprintf(stderr, "[PlayVideo] size %d\n", size);
 
-	if (StreamFreezed) {
+	if (StreamFreezed && stream == MyVideoStream) {
 		return 0;
 	}
 
@@ -1178,60 +1390,35 @@ int PlayVideo(const uint8_t * data, int size)
 		pts = (int64_t) (data[9] & 0x0E) << 29 | data[10] << 22 | (data[11] &
 			0xFE) << 14 | data[12] << 7 | (data[13] & 0xFE) >> 1;
 	}
+	// get dts
+	if ((data[7] & 0xC0) == 0xC0 && size >= 19) {
+		dts = (int64_t) (data[14] & 0x0E) << 29 | data[15] << 22 | (data[16] &
+			0xFE) << 14 | data[17] << 7 | (data[18] & 0xFE) >> 1;
+	}
 
 	n = 9 + data[8];	// PES header size
-	for (i = 0; (i < 2) && (i + 4 < size); i++) {
-		// ES start code 0x00 0x00 0x01
-		if (!data[i + n] && !data[i + n + 1] && data[i + n + 2] == 0x01) {
-			// AV_CODEC_ID_MPEG2VIDEO 0x00 0x00 0x01 0x00 || 0xb3
-			if (data[i + n + 3] == 0xb3 || !data[i + n + 3]) {
-				if (stream->CodecID == AV_CODEC_ID_MPEG2VIDEO) {
-					VideoEnqueue(stream, pts, data + i + n, size - i - n);
-				} else {
-					if (data[i + n + 3] == 0xb3) {
-						Debug(3, "video: mpeg2 detected\n");
-						stream->CodecID = AV_CODEC_ID_MPEG2VIDEO;
-						stream->NewStream = 1;
-						stream->timebase.den = 90000;
-						stream->timebase.num = 1;
-						VideoEnqueue(stream, pts, data + i + n, size - i - n);
-					}
-				}
-				return size;
-			}
-			// AV_CODEC_ID_H264 (0x00) 0x00 0x00 0x01 0x09
-			if (data[i + n + 3] == 0x09) {
-				if (stream->CodecID == AV_CODEC_ID_H264) {
-					VideoEnqueue(stream, pts, data + i + n, size - i - n);
-				} else {
-					if (data[i + n + 4] == 0x10) {
-						Debug(3, "video: H264 detected\n");
-						stream->CodecID = AV_CODEC_ID_H264;
-						stream->NewStream = 1;
-						stream->timebase.den = 90000;
-						stream->timebase.num = 1;
-						VideoEnqueue(stream, pts, data + i + n, size - i - n);
-					}
-				}
-				return size;
-			}
-			// AV_CODEC_ID_HEVC (0x00) 0x00 0x00 0x01 0x46
-			if (data[i + n + 3] == 0x46) {
-				if (stream->CodecID == AV_CODEC_ID_HEVC) {
-					VideoEnqueue(stream, pts, data + i + n, size - i - n);
-				} else {
-					if (data[i + n + 5] == 0x10) {
-						Debug(3, "video: hevc detected\n");
-						stream->CodecID = AV_CODEC_ID_HEVC;
-						stream->NewStream = 1;
-						stream->timebase.den = 90000;
-						stream->timebase.num = 1;
-						VideoEnqueue(stream, pts, data + i + n, size - i - n);
-					}
-				}
+	if (n >= size) {
+		return size;
+	}
+
+	// ES start code 0x00 0x00 0x01 of an access unit
+	codec_id = ParseDetectCodec(data + n, size - n, &i);
+	if (codec_id != AV_CODEC_ID_NONE) {
+		const uint8_t *es = data + n + i;
+		int es_size = size - n - i;
+
+		if (stream->CodecID != codec_id) {
+			// new codec starts with a sequence header or an I-frame AUD
+			if (!(codec_id == AV_CODEC_ID_MPEG2VIDEO && es[3] == 0xb3) &&
+				!(codec_id == AV_CODEC_ID_H264 && es_size > 4 && es[4] == 0x10) &&
+				!(codec_id == AV_CODEC_ID_HEVC && es_size > 5 && es[5] == 0x10)) {
 				return size;
 			}
+			VideoNewCodec(stream, codec_id);
 		}
+		ParseStreamInfo(codec_id, es, es_size, &stream->Info);
+		VideoEnqueue(stream, pts, dts, es, es_size);
+		return size;
 	}
 
 	// this happens when vdr sends incomplete packets
@@ -1241,100 +1428,113 @@ int PlayVideo(const uint8_t * data, int size)
 	}
 
 	// SKIP PES header
-	VideoEnqueue(stream, pts, data + n, size - n);
+	VideoEnqueue(stream, pts, dts, data + n, size - n);
 
 	return size;
 }
 
+/**
+**	Play video packet.
+**
+**	@param data		data of exactly one complete PES packet
+**	@param size		size of PES packet
+**
+**	@return number of bytes used, 0 if internal buffer are full.
+*/
+int PlayVideo(const uint8_t * data, int size)
+{
+	return PlayVideo3(MyVideoStream, data, size);
+}
+
 
 /**
 **	Display the given I-frame as a still picture.
 **
+**	The frame is split into the packet ringbuffer and decoded by the
+**	active decoder, which is drained to output the frame at once. The
+**	drain ends the stream of the decoder, a v4l2m2m decoder restarts
+**	its stream with the next packet.
+**
+**	The frame is shown without a/v sync with trick speed 1. The trick
+**	speed of the stream is restored after the display took the frame or
+**	the wait timed out, a freezed stream is paused again.
+**
 **	@param data	pes frame data
 **	@param size	number of bytes in frame
 */
 void StillPicture(const uint8_t * data, int size)
 {
-	AVPacket avpkt;
-	uint8_t * pes;
-	const uint8_t * pos;
+	VideoStream *stream = MyVideoStream;
+	const uint8_t *pos;
 	int size_rest;
-	int codec = AV_CODEC_ID_NONE;
+	enum AVCodecID codec_id = AV_CODEC_ID_NONE;
 	int i;
 
-	pes = malloc(size);
-	av_init_packet(&avpkt);
-	avpkt.size = 0;
+	ClearVideo(stream);
+	stream->Still = 1;
+
 	pos = data;
 	size_rest = size;
-
-	avpkt.pts = AV_NOPTS_VALUE;
-
-	while (size_rest >= 6 ) {
-		int pes_length = PesHasLength(pos) ? PesLength(pos) : size;
+	while (size_rest >= 9) {
+		int pes_length = PesHasLength(pos) ? PesLength(pos) : size_rest;
 		int head_length = PesHeadLength(pos);
 
-		if (codec == AV_CODEC_ID_NONE) {
-			for (i = 0; (i < 2); i++) {
-				// ES start code 0x00 0x00 0x01
-				if (!pos[i + head_length] && !pos[i + head_length + 1] &&
-					pos[i + head_length + 2] == 0x01) {
-
-					// AV_CODEC_ID_MPEG2VIDEO 0x00 0x00 0x01 0xb3
-					if (pos[i + head_length + 3] == 0xb3) {
-						codec = AV_CODEC_ID_MPEG2VIDEO;
-						break;
-					}
-					// AV_CODEC_ID_H264 0x00 0x00 0x01 0x09
-					if (pos[i + head_length + 3] == 0x09) {
-						codec = AV_CODEC_ID_H264;
-						break;
-					}
-					// AV_CODEC_ID_HEVC 0x00 0x00 0x01 0x46
-					if (pos[i + head_length + 3] == 0x46) {
-						codec = AV_CODEC_ID_HEVC;
-						break;
-					}
-				}
+		if (pes_length > size_rest)
+			pes_length = size_rest;
+		if (head_length >= pes_length)
+			break;
+
+		if (codec_id == AV_CODEC_ID_NONE) {
+			codec_id = ParseDetectCodec(pos + head_length,
+				pes_length - head_length, &i);
+			if (codec_id != AV_CODEC_ID_NONE) {
+				head_length += i;
+				if (stream->CodecID != codec_id)
+					VideoNewCodec(stream, codec_id);
+				ParseStreamInfo(codec_id, pos + head_length,
+					pes_length - head_length, &stream->Info);
 			}
 		}
-
 #ifdef STILL_DEBUG
-		fprintf(stderr, "StillPicture: memcpy avpkt.size %d size %d size_rest %d peslength %d headlength %d I %d\n",
-			avpkt.size, size, size_rest, pes_length, head_length, i);
+		fprintf(stderr, "StillPicture: size %d size_rest %d peslength %d headlength %d\n",
+			size, size_rest, pes_length, head_length);
 #endif
+		// the payload is split into the packet ringbuffer, no copy needed
+		if (codec_id != AV_CODEC_ID_NONE)
+			VideoEnqueue(stream, AV_NOPTS_VALUE, AV_NOPTS_VALUE,
+				pos + head_length, pes_length - head_length);
 
-		memcpy(pes + avpkt.size, pos + head_length + i, pes_length - head_length - i);
-		avpkt.size += pes_length - head_length - i;
 		size_rest -= pes_length;
 		pos += pes_length;
-		i = 0;
 	}
 
-	avpkt.data = pes;
+	if (codec_id == AV_CODEC_ID_NONE) {
+		Debug(3, "video: still picture not detected\n");
+		stream->Still = 0;
+		return;
+	}
+	VideoNextPacket(stream, AV_NOPTS_VALUE, AV_NOPTS_VALUE);
 
-	CodecVideoOpen(MyVideoStream->Decoder, codec, NULL, NULL);
-	VideoSetTrickSpeed(MyVideoStream->Render, 1);
+	// show the frame without a/v sync as soon as it is decoded
+	VideoSetStill(stream->Render, 1);
+	VideoSetTrickSpeed(stream->Render, 1);
+	stream->Still = 2;
 
-send:
-	CodecVideoSendPacket(MyVideoStream->Decoder, &avpkt);
-	usleep(20000);
-	if (CodecVideoReceiveFrame(MyVideoStream->Decoder, 1))
-		goto send;
+	for (i = 0; (stream->Still || VideoIsStillPending(stream->Render)) &&
+		i < STILL_TIMEOUT; i++)
+		usleep(1000);
 #ifdef STILL_DEBUG
-	else fprintf(stderr, "StillPicture: Received Frame\n");
+	fprintf(stderr, "StillPicture: shown after %d ms\n", i);
 #endif
-	CodecVideoFlushBuffers(MyVideoStream->Decoder);
-	CodecVideoClose(MyVideoStream->Decoder);
-	MyVideoStream->CodecID = AV_CODEC_ID_NONE;
-	av_packet_unref(&avpkt);
-	free(pes);
+	// timeout: a late drain would hit the next empty packet ring
+	stream->Still = 0;
+	VideoSetStill(stream->Render, 0);
 
-	usleep(100000);
-	VideoSetTrickSpeed(MyVideoStream->Render, 0);
+	VideoSetTrickSpeed(stream->Render, stream->TrickSpeed);
+	if (StreamFreezed)
+		VideoPause(stream->Render);
 }
 
-
     /// call VDR support function
 extern uint8_t *CreateJpeg(uint8_t *, int *, int, int, int);
 
@@ -1395,31 +1595,45 @@ uint8_t *CreateJpeg(uint8_t * image, int raw_size, int *size, int quality,
 /**
 **	Grabs the currently visible screen image.
 **
+**	The screen is scaled to the requested size while it is converted.
+**
 **	@param size	size of the returned data
-**	@param jpeg	flag true, create JPEG data
+**	@param format	GRAB_IMAGE_PNM, GRAB_IMAGE_JPEG or GRAB_IMAGE_PNG
 **	@param quality	JPEG quality
 **	@param width	number of horizontal pixels in the frame
 **	@param height	number of vertical pixels in the frame
 */
-uint8_t *GrabImage(int *size, int jpeg, int quality, int width, int height)
+uint8_t *GrabImage(int *size, int format, int quality, int width, int height)
 {
-    if (jpeg) {
-	uint8_t *image;
-	int raw_size;
-
-	raw_size = 0;
-	image = VideoGrab(&raw_size, &width, &height, 0);
-	if (image) {			// can fail, suspended, ...
-	    uint8_t *jpg_image;
+    uint8_t *image;
+    uint8_t *data;
+    uint32_t tick;
+    int raw_size;
 
-	    jpg_image = CreateJpeg(image, size, quality, width, height);
+    if (format == GRAB_IMAGE_PNM) {
+	return VideoGrab(size, &width, &height, 1);
+    }
 
-	    free(image);
-	    return jpg_image;
-	}
+    tick = GetMsTicks();
+    raw_size = 0;
+    image = VideoGrab(&raw_size, &width, &height, 0);
+    if (!image) {			// can fail, suspended, ...
 	return NULL;
     }
-    return VideoGrab(size, &width, &height, 1);
+
+    data = CodecEncodeImage(image, width, height, format == GRAB_IMAGE_PNG ?
+	AV_CODEC_ID_PNG : AV_CODEC_ID_MJPEG, quality, size);
+    // fallback to the jpeg encoder of vdr
+    if (!data && format == GRAB_IMAGE_JPEG) {
+	data = CreateJpeg(image, size, quality, width, height);
+    }
+    free(image);
+
+    if (data) {
+	Info("grab: %dx%d %s %d bytes in %dms\n", width, height,
+	    format == GRAB_IMAGE_PNG ? "png" : "jpeg", *size, GetMsTicks() - tick);
+    }
+    return data;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1428,6 +1642,7 @@ uint8_t *GrabImage(int *size, int jpeg, int quality, int width, int height)
 
 void SetAudioCodec(int codec_id, AVCodecParameters * par, AVRational * timebase)
 {
+	CodecAudioClose(MyAudioDecoder);
 	CodecAudioOpen(MyAudioDecoder, codec_id, par, timebase);
 }
 
@@ -1474,10 +1689,36 @@ int PlayVideoPkts(AVPacket * pkt)
 
 	memcpy(avpkt->data, pkt->data, pkt->size);
 	avpkt->pts = pkt->pts;
+	avpkt->dts = pkt->dts;
 	avpkt->size = pkt->size;
+	avpkt->flags = pkt->flags;
 	return 1;
 }
 
+/**
+**	Clears all video and audio data for a seek of the mediaplayer.
+**
+**	Packets, decoders, filter and audio ring are cleared in one step.
+**	The last frame stays on screen until the first frame at the target,
+**	which is shown before a/v sync. The decoder starts with the next key
+**	frame and drops the frames before the target.
+**
+**	@param pts	first video pts to show, AV_NOPTS_VALUE shows the
+**			key frame
+*/
+void SeekClear(int64_t pts)
+{
+#ifdef DEBUG
+	fprintf(stderr, "SeekClear: pts %lld\n", (long long)pts);
+#endif
+	VideoSetSeek(MyVideoStream->Render, 1);
+	ClearVideo(MyVideoStream);
+	CodecVideoSkipTo(MyVideoStream->Decoder, pts);
+	MyVideoStream->SkipToKeyFrame = VIDEO_PACKET_MAX;
+	VideoSetClosing(MyVideoStream->Render);
+	ClearAudio();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -1486,14 +1727,29 @@ int PlayVideoPkts(AVPacket * pkt)
 **	Every single frame shall then be displayed the given number of
 **	times.
 **
+**	vdr uses 6, 3, 1 for fast forward/reverse, 8, 4, 2 for slow forward
+**	and 63, 48, 24 for slow reverse. The fast speeds decode only key
+**	frames at the highest speed and no non-reference frames else.
+**	In reverse the decoder buffers the frames of a gop and the render
+**	shows them newest first.
+**
 **	@param speed	trick speed
+**	@param forward	replay direction
 */
-void TrickSpeed(int speed)
+void TrickSpeed(int speed, int forward)
 {
 #ifdef DEBUG
-	fprintf(stderr, "TrickSpeed: speed %d\n", speed);
+	fprintf(stderr, "TrickSpeed: speed %d forward %d\n", speed, forward);
 #endif
+	if (speed == 1 || (!forward && speed <= 6)) {
+		MyVideoStream->TrickLevel = 2;
+	} else if (speed == 3 || speed == 6) {
+		MyVideoStream->TrickLevel = 1;
+	} else {
+		MyVideoStream->TrickLevel = 0;
+	}
 	MyVideoStream->TrickSpeed = speed;
+	MyVideoStream->Reverse = speed && !forward;
 	VideoSetTrickSpeed(MyVideoStream->Render, speed);
 
 	if (StreamFreezed) {
@@ -1514,6 +1770,7 @@ void Clear(void)
 	fprintf(stderr, "Clear(void)\n");
 #endif
 	ClearVideo(MyVideoStream);
+	VideoSetSeek(MyVideoStream->Render, 0);
 	VideoSetClosing(MyVideoStream->Render);		//This should more tested
 	ClearAudio();
 }
@@ -1528,6 +1785,9 @@ void Play(void)
 #endif
 	SkipAudio = 0;
 	StreamFreezed = 0;
+	MyVideoStream->TrickSpeed = 0;
+	MyVideoStream->TrickLevel = 0;
+	MyVideoStream->Reverse = 0;
 	AudioPlay();
 	VideoPlay(MyVideoStream->Render);
 }
@@ -1626,6 +1886,11 @@ void GetScreenSize(int *width, int *height, double *pixel_aspect)
 	VideoGetScreenSize(MyVideoStream->Render, width, height, pixel_aspect);
 }
 
+void GetOsdSize(int *width, int *height, double *pixel_aspect)
+{
+	VideoGetOsdSize(MyVideoStream->Render, width, height, pixel_aspect);
+}
+
 /**
 **	Set play mode, called on channel switch.
 **
@@ -1656,7 +1921,7 @@ int SetPlayMode(int play_mode)
 		//Play(); Play is a vdr command!!!
 		break;
 	case 2:			// audio only
-		VideoThreadExit();
+		VideoThreadExit(MyVideoStream->Render);
 		break;
 	case 3:			// audio only (black screen)
 		Debug(3, "softhddev: FIXME: audio only, silence video errors\n");
@@ -1676,6 +1941,117 @@ int SetPlayMode(int play_mode)
 	return 1;
 }
 
+//////////////////////////////////////////////////////////////////////////////
+//	PIP
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+**	Set PIP position.
+**
+**	@param x	pip window x-coordinate on screen
+**	@param y	pip window y-coordinate on screen
+**	@param width	pip window width
+**	@param height	pip window height
+*/
+void PipSetPosition(int x, int y, int width, int height)
+{
+	if (PipVideoStream->Render) {
+		VideoSetPipPosition(PipVideoStream->Render, x, y, width, height);
+	}
+}
+
+/**
+**	Start PIP stream.
+**
+**	The pip stream has its own decoder, packet ring buffer, threads
+**	and a free overlay plane of the main render.
+**
+**	@param x	pip window x-coordinate on screen
+**	@param y	pip window y-coordinate on screen
+**	@param width	pip window width
+**	@param height	pip window height
+**
+**	@retval 0	pip started
+**	@retval -1	pip not possible
+*/
+int PipStart(int x, int y, int width, int height)
+{
+	VideoStream *stream = PipVideoStream;
+
+	if (!MyVideoStream->Render) {
+		return -1;
+	}
+	if (stream->Render) {		// already running
+		PipSetPosition(x, y, width, height);
+		return 0;
+	}
+#ifdef DEBUG
+	fprintf(stderr, "PipStart: %dx%d%+d%+d\n", width, height, x, y);
+#endif
+
+	if (!(stream->Render = VideoNewRender(stream))) {
+		return -1;
+	}
+	if (VideoPipInit(stream->Render, MyVideoStream->Render)) {
+		VideoDelRender(stream->Render);
+		stream->Render = NULL;
+		return -1;
+	}
+	VideoSetPipPosition(stream->Render, x, y, width, height);
+
+	stream->CodecID = AV_CODEC_ID_NONE;
+	stream->NewStream = 0;
+	stream->ClosingStream = 0;
+	stream->Decoder = CodecVideoNewDecoder(stream->Render);
+	VideoPacketInit(stream);
+
+	VideoThreadWakeup(stream->Render);
+
+	return 0;
+}
+
+/**
+**	Stop PIP stream.
+*/
+void PipStop(void)
+{
+	VideoStream *stream = PipVideoStream;
+
+	if (!stream->Render) {
+		return;
+	}
+#ifdef DEBUG
+	fprintf(stderr, "PipStop:\n");
+#endif
+
+	VideoThreadExit(stream->Render);
+	VideoPipExit(stream->Render);
+
+	CodecVideoClose(stream->Decoder);
+	stream->CodecID = AV_CODEC_ID_NONE;
+	stream->NewStream = 0;
+	stream->ClosingStream = 0;
+
+	VideoStreamClose(stream);
+}
+
+/**
+**	Play PIP video packet.
+**
+**	@param data		data of exactly one complete PES packet
+**	@param size		size of PES packet
+**
+**	@return number of bytes used, 0 if internal buffer are full.
+*/
+int PipPlayVideo(const uint8_t * data, int size)
+{
+	if (!PipVideoStream->Render) {
+		return size;
+	}
+
+	return PlayVideo3(PipVideoStream, data, size);
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //	Init/Exit
 //////////////////////////////////////////////////////////////////////////////
@@ -1688,6 +2064,8 @@ void SoftHdDeviceExit(void)
 #ifdef DEBUG
 	fprintf(stderr, "SoftHdDeviceExit(void):\n");
 #endif
+    PipStop();
+
     AudioExit();
     if (MyAudioDecoder) {
 		CodecAudioClose(MyAudioDecoder);
@@ -1782,6 +2160,40 @@ void GetStats(int *duped, int *dropped, int *counter)
 	}
 }
 
+/**
+**	Get channel switch time.
+**
+**	@param[out] first_frame	ms until the first frame was shown
+**	@param[out] sync	ms until audio and video were in sync
+*/
+void GetZapTime(int *first_frame, int *sync)
+{
+	*first_frame = 0;
+	*sync = 0;
+	if (MyVideoStream->Render) {
+		VideoGetZapTime(MyVideoStream->Render, first_frame, sync);
+	}
+}
+
+/**
+**	Get filter statistics.
+**
+**	@param[out] name	deinterlacer or scaler, NULL without filter
+**	@param[out] threads	slice threads of the filter
+**	@param[out] us		average us per frame
+**	@param[out] load	% of the frame time
+*/
+void GetFilterStats(const char **name, int *threads, int *us, int *load)
+{
+	*name = NULL;
+	*threads = 0;
+	*us = 0;
+	*load = 0;
+	if (MyVideoStream->Render) {
+		VideoGetFilterStats(MyVideoStream->Render, name, threads, us, load);
+	}
+}
+
 
 //////////////////////////////////////////////////////////////////////////////
 //	OSD
@@ -45,6 +45,7 @@ extern "C"
     extern void SetVideoCodec(int, AVCodecParameters *, AVRational *);
     extern int PlayAudioPkts(AVPacket *);
     extern int PlayVideoPkts(AVPacket *);
+    extern void SeekClear(int64_t);
 
     /// C plugin play audio packet
     extern int PlayAudio(const uint8_t *, int, uint8_t);
@@ -55,17 +56,30 @@ extern "C"
 
     /// C plugin play video packet
     extern int PlayVideo(const uint8_t *, int);
+    /// C plugin start pip stream
+    extern int PipStart(int, int, int, int);
+    /// C plugin stop pip stream
+    extern void PipStop(void);
+    /// C plugin set pip window position
+    extern void PipSetPosition(int, int, int, int);
+    /// C plugin play pip video packet
+    extern int PipPlayVideo(const uint8_t *, int);
     /// Decode video input buffers.
     extern int VideoDecodeInput(VideoStream *);
     /// Get number of input buffers.
     extern int VideoGetPackets(const VideoStream *);
+    /// grab image formats
+#define GRAB_IMAGE_PNM	0		///< raw RGB with PNM header
+#define GRAB_IMAGE_JPEG	1		///< JPEG
+#define GRAB_IMAGE_PNG	2		///< PNG
+
     /// C plugin grab an image
     extern uint8_t *GrabImage(int *, int, int, int, int);
 
     /// C plugin set play mode
     extern int SetPlayMode(int);
     /// C plugin set trick speed
-    extern void TrickSpeed(int);
+    extern void TrickSpeed(int, int);
     /// C plugin clears all video and audio data from the device
     extern void Clear(void);
     /// C plugin sets the device into play mode
@@ -84,6 +98,8 @@ extern "C"
     extern int64_t GetSTC(void);
     /// C plugin get video stream size and aspect
     extern void GetScreenSize(int *, int *, double *);
+    /// C plugin get osd size and aspect
+    extern void GetOsdSize(int *, int *, double *);
     /// C plugin command line help
     extern const char *CommandLineHelp(void);
     /// C plugin process the command line arguments
@@ -99,8 +115,12 @@ extern "C"
 
     /// Get decoder statistics
     extern void GetStats(int *, int *, int *);
-    /// Get parsed width and height
-    extern void ParseResolutionH264(int *, int *);
+    /// Get channel switch time
+    extern void GetZapTime(int *, int *);
+    /// Get filter statistics
+    extern void GetFilterStats(const char **, int *, int *, int *);
+    /// Get parsed sequence header info
+    extern const struct _video_stream_info_ *GetVideoStreamInfo(VideoStream *);
 
 #ifdef __cplusplus
 }
@@ -27,10 +27,15 @@
 using std::string;
 #include <fstream>
 using std::ifstream;
+#include <deque>
+#include <vector>
 
 #include <vdr/player.h>
 #include <vdr/plugin.h>
 #include <vdr/dvbspu.h>
+#include <vdr/receiver.h>
+#include <vdr/recording.h>
+#include <vdr/remux.h>
 
 #include "softhddevice-drm.h"
 #include "softhddevice_service.h"
@@ -228,7 +233,7 @@ void cSoftOsd::Flush(void)
 		    }
 		    ys = 0;
 		}
-		::GetScreenSize(&width, &height, &video_aspect);
+		::GetOsdSize(&width, &height, &video_aspect);
 		if (w > width - xs - x1) {
 		    w = width - xs - x1;
 		    if (w <= 0) {
@@ -331,7 +336,7 @@ void cSoftOsd::Flush(void)
 		y = 0;
 	    }
 
-	    ::GetScreenSize(&width, &height, &video_aspect);
+	    ::GetOsdSize(&width, &height, &video_aspect);
 	    if (w > width - x) {
 		w = width - x;
 	    }
@@ -399,6 +404,290 @@ cSoftOsdProvider::~cSoftOsdProvider()
 }
 */
 
+//////////////////////////////////////////////////////////////////////////////
+//	PIP
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+**	Get the pip window in screen pixel.
+**
+**	@param x	pip x-position in % of the screen (0 = setup)
+**	@param y	pip y-position in % of the screen (0 = setup)
+**	@param width	pip width in % of the screen (0 = setup)
+**	@param height	pip height in % of the screen (0 = setup)
+*/
+static void PipGetWindow(int &x, int &y, int &width, int &height)
+{
+    int screen_width;
+    int screen_height;
+    double aspect;
+
+    ::GetScreenSize(&screen_width, &screen_height, &aspect);
+
+    x = (x ? x : ConfigPipX) * screen_width / 100;
+    y = (y ? y : ConfigPipY) * screen_height / 100;
+    width = (width ? width : ConfigPipWidth) * screen_width / 100;
+    height = (height ? height : ConfigPipHeight) * screen_height / 100;
+}
+
+/**
+**	Start the pip stream with the setup window.
+*/
+static int PipStartConfig(void)
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    PipGetWindow(x, y, width, height);
+
+    return ::PipStart(x, y, width, height);
+}
+
+/**
+**	Move the pip window to the setup position.
+*/
+static void PipSetPositionConfig(void)
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    PipGetWindow(x, y, width, height);
+    ::PipSetPosition(x, y, width, height);
+}
+
+/**
+**	Create a receiver for the pip channel.
+**
+**	@param channel	channel, we only want the video pid
+*/
+cSoftReceiver::cSoftReceiver(const cChannel * channel):cReceiver(NULL,
+    MINPRIORITY)
+{
+    // cReceiver::channelID isn't setup, we want video only
+    AddPid(channel->Vpid());
+}
+
+/**
+**	Receiver destructor.
+*/
+cSoftReceiver::~cSoftReceiver()
+{
+    Detach();
+}
+
+/**
+**	Called before the receiver gets attached or after it got detached.
+**
+**	@param on	flag attached, detached
+*/
+void cSoftReceiver::Activate(bool on)
+{
+    if (on) {
+	TsToPes.Reset();
+	if (PipStartConfig()) {
+	    esyslog(tr("[softhddev]pip: can't start pip\n"));
+	}
+    } else {
+	::PipStop();
+    }
+}
+
+/**
+**	Receive ts packets of the pip channel.
+**
+**	Called from the receiver thread, packets are dropped if the pip
+**	buffers are full.
+**
+**	@param data	ts packets
+**	@param size	number of bytes
+*/
+#if APIVERSNUM >= 20301
+void cSoftReceiver::Receive(const uchar * data, int size)
+#else
+void cSoftReceiver::Receive(uchar * data, int size)
+#endif
+{
+    for (; size >= TS_SIZE; data += TS_SIZE, size -= TS_SIZE) {
+	if (TsPayloadStart(data)) {
+	    const uchar *pes;
+	    int length;
+
+	    while ((pes = TsToPes.GetPes(length))) {
+		::PipPlayVideo(pes, length);
+	    }
+	    TsToPes.Reset();
+	}
+	TsToPes.PutTs(data, TS_SIZE);
+    }
+}
+
+/**
+**	Create a pip player of a recording.
+**
+**	@param file_name	recording directory
+*/
+cSoftPipPlayer::cSoftPipPlayer(const char *file_name):cThread("softhddev pip player")
+{
+    FileName = file_name;
+}
+
+/**
+**	Pip player destructor.
+*/
+cSoftPipPlayer::~cSoftPipPlayer()
+{
+    Cancel(3);
+    ::PipStop();
+}
+
+/**
+**	Read the recording and give the video pid to the pip stream.
+**
+**	The pip buffers throttle the reader, the pip display paces the
+**	frames by their pts.
+*/
+void cSoftPipPlayer::Action(void)
+{
+    cFileName file_name(FileName, false);
+    cUnbufferedFile *file;
+    cPatPmtParser parser;
+    uchar buf[TS_SIZE * 64];
+    int fill;
+    int vpid;
+
+    if (!(file = file_name.Open())) {
+	esyslog(tr("[softhddev]pip: can't open recording %s\n"), *FileName);
+	return;
+    }
+    if (PipStartConfig()) {
+	esyslog(tr("[softhddev]pip: can't start pip\n"));
+	return;
+    }
+
+    vpid = 0;
+    fill = 0;
+    TsToPes.Reset();
+    while (Running() && file) {
+	uchar *p;
+	int size;
+
+	size = file->Read(buf + fill, sizeof(buf) - fill);
+	if (size <= 0) {		// end of file, next file of the recording
+	    file = file_name.NextFile();
+	    continue;
+	}
+	size += fill;
+	for (p = buf; size >= TS_SIZE && Running();
+	    p += TS_SIZE, size -= TS_SIZE) {
+	    int pid;
+
+	    if (p[0] != TS_SYNC_BYTE) {
+		esyslog(tr("[softhddev]pip: recording out of sync\n"));
+		size = 0;
+		break;
+	    }
+	    pid = TsPid(p);
+	    if (pid == PATPID) {
+		parser.ParsePat(p, TS_SIZE);
+	    } else if (parser.IsPmtPid(pid)) {
+		parser.ParsePmt(p, TS_SIZE);
+		vpid = parser.Vpid();
+	    } else if (vpid && pid == vpid) {
+		if (TsPayloadStart(p)) {
+		    const uchar *pes;
+		    int length;
+
+		    while ((pes = TsToPes.GetPes(length))) {
+			while (!::PipPlayVideo(pes, length) && Running()) {
+			    cCondWait::SleepMs(10);
+			}
+		    }
+		    TsToPes.Reset();
+		}
+		TsToPes.PutTs(p, TS_SIZE);
+	    }
+	}
+	// keep a partial packet for the next read
+	fill = size > 0 ? size : 0;
+	memmove(buf, p, fill);
+    }
+    file_name.Close();
+}
+
+/**
+**	Stop the pip channel or recording.
+*/
+static void DelPip(void)
+{
+    delete PipReceiver;
+    PipReceiver = NULL;
+    delete PipPlayer;
+    PipPlayer = NULL;
+    PipChannelNr = 0;
+}
+
+/**
+**	Start the pip of a channel.
+**
+**	@param channel_nr	channel number (0 = current channel)
+**
+**	@returns true if a device receives the channel.
+*/
+static bool NewPip(int channel_nr)
+{
+    cChannel channel;
+    cDevice *device;
+    cSoftReceiver *receiver;
+
+    if (!channel_nr) {
+	channel_nr = cDevice::CurrentChannel();
+    }
+    // copy the channel, the switch and attach run without the channels lock
+    {
+#if APIVERSNUM >= 20301
+	LOCK_CHANNELS_READ;
+	const cChannel *found = Channels->GetByNumber(channel_nr);
+#else
+	const cChannel *found = Channels.GetByNumber(channel_nr);
+#endif
+
+	if (!found) {
+	    return false;
+	}
+	channel = *found;
+    }
+    if (!(device = cDevice::GetDevice(&channel, 0, false, false))) {
+	return false;
+    }
+
+    DelPip();
+
+    device->SwitchChannel(&channel, false);
+    receiver = new cSoftReceiver(&channel);
+    device->AttachReceiver(receiver);
+    PipReceiver = receiver;
+    PipChannelNr = channel_nr;
+
+    return true;
+}
+
+/**
+**	Start the pip of a recording.
+**
+**	@param file_name	recording directory
+*/
+static void NewPipRecording(const char *file_name)
+{
+    DelPip();
+
+    PipPlayer = new cSoftPipPlayer(file_name);
+    PipPlayer->Start();
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //	cMenuSetupPage
 //////////////////////////////////////////////////////////////////////////////
@@ -457,11 +746,66 @@ void cMenuSetupSoft::Create(void)
 		trVDR("no"), trVDR("yes")));
 	Add(new cMenuEditBoolItem(tr("Hide main menu entry"),
 		&HideMainMenuEntry, trVDR("no"), trVDR("yes")));
+	Add(new cMenuEditIntItem(tr("OSD width (0 = screen, restart)"),
+		&OsdWidth, 0, 7680));
+	Add(new cMenuEditIntItem(tr("OSD height (0 = screen, restart)"),
+		&OsdHeight, 0, 4320));
+	Add(new cMenuEditBoolItem(tr("OSD 16 bit color (restart)"),
+		&OsdFormat, trVDR("no"), trVDR("yes")));
+	static const char *display_modes[3];
+
+	display_modes[0] = tr("fixed HD");
+	display_modes[1] = tr("native");
+	display_modes[2] = tr("follow video");
+	Add(new cMenuEditStraItem(tr("Display mode (restart)"),
+		&DisplayMode, 3, display_modes));
+	static const char *deinterlacers[5];
+
+	deinterlacers[0] = tr("bwdif");
+	deinterlacers[1] = tr("yadif");
+	deinterlacers[2] = tr("yadif frame rate");
+	deinterlacers[3] = tr("bob");
+	deinterlacers[4] = tr("off");
+	Add(new cMenuEditStraItem(tr("Best software deinterlacer"),
+		&Deinterlacer, 5, deinterlacers));
+	Add(new cMenuEditIntItem(tr("Filter threads (0 = auto)"),
+		&FilterThreads, 0, 16));
+	Add(new cMenuEditIntItem(tr("Filter cpu mask (0 = any)"),
+		&FilterCpus, 0, 0xFFFF));
+	Add(new cMenuEditIntItem(tr("Decoder threads (0 = auto)"),
+		&DecoderThreads, 0, 16));
+	Add(new cMenuEditIntItem(tr("Decoder cpu mask (0 = any)"),
+		&DecodeCpus, 0, 0xFFFF));
+	Add(new cMenuEditIntItem(tr("Display cpu mask (0 = any, restart)"),
+		&DisplayCpus, 0, 0xFFFF));
+	Add(new cMenuEditIntItem(tr("Display priority (0 = normal, restart)"),
+		&DisplayPriority, -99, 99));
+	Add(new cMenuEditIntItem(tr("Audio cpu mask (0 = any, restart)"),
+		&AudioCpus, 0, 0xFFFF));
+	Add(new cMenuEditIntItem(tr("Audio priority (0 = normal, restart)"),
+		&AudioPriority, -99, 99));
+	Add(new cMenuEditBoolItem(tr("Fast channel switch"),
+		&FastSwitch, trVDR("no"), trVDR("yes")));
+	Add(new cMenuEditBoolItem(tr("Match refresh rate to the video"),
+		&AutoRefresh, trVDR("no"), trVDR("yes")));
+	Add(new cMenuEditIntItem(tr("Media player read buffer (KiB, 0 = auto)"),
+		&MediaBufferSize, 0, 16384));
 	//
 	//	osd
 	//
     }
     //
+    //	pip
+    //
+    Add(CollapsedItem(tr("Picture-In-Picture"), Pip));
+
+    if (Pip) {
+	Add(new cMenuEditIntItem(tr("Pip X (%)"), &PipX, 0, 100));
+	Add(new cMenuEditIntItem(tr("Pip Y (%)"), &PipY, 0, 100));
+	Add(new cMenuEditIntItem(tr("Pip width (%)"), &PipWidth, 0, 100));
+	Add(new cMenuEditIntItem(tr("Pip height (%)"), &PipHeight, 0, 100));
+    }
+    //
     //	audio
     //
     Add(CollapsedItem(tr("Audio"), Audio));
@@ -554,6 +898,7 @@ void cMenuSetupSoft::Create(void)
 eOSState cMenuSetupSoft::ProcessKey(eKeys key)
 {
     int old_General = General;
+    int old_Pip = Pip;
     int old_Audio = Audio;
     int old_AudioFilter = AudioFilter;
     int old_AudioEq = AudioEq;
@@ -565,7 +910,7 @@ eOSState cMenuSetupSoft::ProcessKey(eKeys key)
     if (key != kNone) {
 		// update menu only, if something on the structure has changed
 		// this is needed because VDR menus are evil slow
-		if (old_General != General ||
+		if (old_General != General || old_Pip != Pip ||
 			old_Audio != Audio || old_AudioFilter != AudioFilter ||
 			old_AudioEq != AudioEq || old_AudioNormalize != AudioNormalize ||
 			old_AudioCompression != AudioCompression ||
@@ -590,6 +935,30 @@ cMenuSetupSoft::cMenuSetupSoft(void)
     General = 0;
     MakePrimary = ConfigMakePrimary;
     HideMainMenuEntry = ConfigHideMainMenuEntry;
+    OsdWidth = ConfigOsdWidth;
+    OsdHeight = ConfigOsdHeight;
+    OsdFormat = ConfigOsdFormat;
+    FastSwitch = ConfigFastSwitch;
+    AutoRefresh = ConfigAutoRefresh;
+    DisplayMode = ConfigDisplayMode;
+    Deinterlacer = ConfigDeinterlacer;
+    FilterThreads = ConfigFilterThreads;
+    FilterCpus = ConfigFilterCpus;
+    DecoderThreads = ConfigDecoderThreads;
+    DecodeCpus = ConfigDecodeCpus;
+    DisplayCpus = ConfigDisplayCpus;
+    DisplayPriority = ConfigDisplayPriority;
+    AudioCpus = ConfigAudioCpus;
+    AudioPriority = ConfigAudioPriority;
+    MediaBufferSize = ConfigMediaBufferSize;
+    //
+    //	pip
+    //
+    Pip = 0;
+    PipX = ConfigPipX;
+    PipY = ConfigPipY;
+    PipWidth = ConfigPipWidth;
+    PipHeight = ConfigPipHeight;
     //
     //	audio
     //
@@ -627,6 +996,39 @@ void cMenuSetupSoft::Store(void)
 {
     SetupStore("MakePrimary", ConfigMakePrimary = MakePrimary);
     SetupStore("HideMainMenuEntry", ConfigHideMainMenuEntry = HideMainMenuEntry);
+    SetupStore("OsdWidth", ConfigOsdWidth = OsdWidth);
+    SetupStore("OsdHeight", ConfigOsdHeight = OsdHeight);
+    SetupStore("OsdFormat", ConfigOsdFormat = OsdFormat);
+    SetupStore("FastChannelSwitch", ConfigFastSwitch = FastSwitch);
+    VideoSetFastSwitch(ConfigFastSwitch);
+    SetupStore("AutoRefreshRate", ConfigAutoRefresh = AutoRefresh);
+    VideoSetAutoRefresh(ConfigAutoRefresh);
+    SetupStore("DisplayMode", ConfigDisplayMode = DisplayMode);
+    SetupStore("Deinterlacer", ConfigDeinterlacer = Deinterlacer);
+    VideoSetDeinterlacer(ConfigDeinterlacer);
+    SetupStore("FilterThreads", ConfigFilterThreads = FilterThreads);
+    VideoSetFilterThreads(ConfigFilterThreads);
+    SetupStore("FilterCpus", ConfigFilterCpus = FilterCpus);
+    VideoSetFilterCpus(ConfigFilterCpus);
+    SetupStore("DecoderThreads", ConfigDecoderThreads = DecoderThreads);
+    CodecSetVideoThreads(ConfigDecoderThreads);
+    SetupStore("DecodeCpus", ConfigDecodeCpus = DecodeCpus);
+    VideoSetDecodeCpus(ConfigDecodeCpus);
+    CodecSetVideoCpus(ConfigDecodeCpus);
+    SetupStore("DisplayCpus", ConfigDisplayCpus = DisplayCpus);
+    VideoSetDisplayCpus(ConfigDisplayCpus);
+    SetupStore("DisplayPriority", ConfigDisplayPriority = DisplayPriority);
+    VideoSetDisplayPriority(ConfigDisplayPriority);
+    SetupStore("AudioCpus", ConfigAudioCpus = AudioCpus);
+    AudioSetThreadCpus(ConfigAudioCpus);
+    SetupStore("AudioPriority", ConfigAudioPriority = AudioPriority);
+    AudioSetThreadPriority(ConfigAudioPriority);
+    SetupStore("MediaBufferSize", ConfigMediaBufferSize = MediaBufferSize);
+    SetupStore("PipX", ConfigPipX = PipX);
+    SetupStore("PipY", ConfigPipY = PipY);
+    SetupStore("PipWidth", ConfigPipWidth = PipWidth);
+    SetupStore("PipHeight", ConfigPipHeight = PipHeight);
+    PipSetPositionConfig();
     SetupStore("AudioDelay", ConfigVideoAudioDelay = AudioDelay);
     VideoSetAudioDelay(ConfigVideoAudioDelay);
 
@@ -814,7 +1216,7 @@ void cSoftHdDevice::TrickSpeed(int speed, bool forward)
 	fprintf(stderr, "[softhddev]TrickSpeed: speed %d %s\n",
 		speed, forward ? "forward" : "backward");
 #endif
-    ::TrickSpeed(speed);
+    ::TrickSpeed(speed, forward);
 }
 
 /**
@@ -972,7 +1374,7 @@ void cSoftHdDevice::GetVideoSize(int &width, int &height, double &video_aspect)
 */
 void cSoftHdDevice::GetOsdSize(int &width, int &height, double &pixel_aspect)
 {
-    ::GetScreenSize(&width, &height, &pixel_aspect);
+    ::GetOsdSize(&width, &height, &pixel_aspect);
 }
 
 // ----------------------------------------------------------------------------
@@ -1059,7 +1461,8 @@ uchar *cSoftHdDevice::GrabImage(int &size, bool jpeg, int quality, int width,
 	quality = 95;
     }
 
-    return::GrabImage(&size, jpeg, quality, width, height);
+    return::GrabImage(&size, jpeg ? GRAB_IMAGE_JPEG : GRAB_IMAGE_PNM, quality,
+	width, height);
 }
 
 /**
@@ -1183,6 +1586,7 @@ void cPluginSoftHdDevice::Stop(void)
 {
     //dsyslog("[softhddev]%s:\n", __FUNCTION__);
 
+    DelPip();
     ::Stop();
 }
 
@@ -1236,6 +1640,90 @@ bool cPluginSoftHdDevice::SetupParse(const char *name, const char *value)
 	ConfigHideMainMenuEntry = atoi(value);
 	return true;
     }
+    if (!strcasecmp(name, "OsdWidth")) {
+	ConfigOsdWidth = atoi(value);
+	VideoSetOsdSize(ConfigOsdWidth, ConfigOsdHeight);
+	return true;
+    }
+    if (!strcasecmp(name, "OsdHeight")) {
+	ConfigOsdHeight = atoi(value);
+	VideoSetOsdSize(ConfigOsdWidth, ConfigOsdHeight);
+	return true;
+    }
+    if (!strcasecmp(name, "FastChannelSwitch")) {
+	VideoSetFastSwitch(ConfigFastSwitch = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "DisplayMode")) {
+	VideoSetDisplayMode(ConfigDisplayMode = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "Deinterlacer")) {
+	VideoSetDeinterlacer(ConfigDeinterlacer = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "FilterThreads")) {
+	VideoSetFilterThreads(ConfigFilterThreads = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "FilterCpus")) {
+	VideoSetFilterCpus(ConfigFilterCpus = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "DecoderThreads")) {
+	CodecSetVideoThreads(ConfigDecoderThreads = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "DecodeCpus")) {
+	ConfigDecodeCpus = atoi(value);
+	VideoSetDecodeCpus(ConfigDecodeCpus);
+	CodecSetVideoCpus(ConfigDecodeCpus);
+	return true;
+    }
+    if (!strcasecmp(name, "DisplayCpus")) {
+	VideoSetDisplayCpus(ConfigDisplayCpus = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "DisplayPriority")) {
+	VideoSetDisplayPriority(ConfigDisplayPriority = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "AudioCpus")) {
+	AudioSetThreadCpus(ConfigAudioCpus = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "AudioPriority")) {
+	AudioSetThreadPriority(ConfigAudioPriority = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "AutoRefreshRate")) {
+	VideoSetAutoRefresh(ConfigAutoRefresh = atoi(value));
+	return true;
+    }
+    if (!strcasecmp(name, "MediaBufferSize")) {
+	ConfigMediaBufferSize = atoi(value);
+	return true;
+    }
+    if (!strcasecmp(name, "PipX")) {
+	ConfigPipX = atoi(value);
+	return true;
+    }
+    if (!strcasecmp(name, "PipY")) {
+	ConfigPipY = atoi(value);
+	return true;
+    }
+    if (!strcasecmp(name, "PipWidth")) {
+	ConfigPipWidth = atoi(value);
+	return true;
+    }
+    if (!strcasecmp(name, "PipHeight")) {
+	ConfigPipHeight = atoi(value);
+	return true;
+    }
+    if (!strcasecmp(name, "OsdFormat")) {
+	VideoSetOsdFormat(ConfigOsdFormat = atoi(value));
+	return true;
+    }
     if (!strcasecmp(name, "AudioDelay")) {
 	VideoSetAudioDelay(ConfigVideoAudioDelay = atoi(value));
 	return true;
@@ -1431,6 +1919,44 @@ bool cPluginSoftHdDevice::Service(const char *id, void *data)
 	return true;
     }
 
+    if (strcmp(id, PIP_SERVICE) == 0) {
+	SoftHDDevice_PipService_v1_0_t *r;
+
+	if (!data) {
+	    return true;
+	}
+
+	r = (SoftHDDevice_PipService_v1_0_t *) data;
+	switch (r->mode) {
+	    case 0:
+		DelPip();
+		return true;
+	    case 1:
+		if (!NewPip(r->channel)) {
+		    return false;
+		}
+		break;
+	    case 2:
+		if (!r->recording) {
+		    return false;
+		}
+		NewPipRecording(r->recording);
+		break;
+	    default:
+		return false;
+	}
+	if (r->x || r->y || r->width || r->height) {
+	    int x = r->x;
+	    int y = r->y;
+	    int width = r->width;
+	    int height = r->height;
+
+	    PipGetWindow(x, y, width, height);
+	    ::PipSetPosition(x, y, width, height);
+	}
+	return true;
+    }
+
     return false;
 }
 
@@ -1444,6 +1970,12 @@ bool cPluginSoftHdDevice::Service(const char *id, void *data)
 */
 static const char *SVDRPHelpText[] = {
 	"PLAY Url\n" "    Play the media from the given url.\n",
+	"PIP [channel]\n" "    Show the channel (default current channel) as picture-in-picture.\n",
+	"PIPR path\n" "    Show the recording in path as picture-in-picture.\n",
+	"PIPP x y width height\n" "    Move the picture-in-picture window (in % of the screen).\n",
+	"PIPS\n" "    Stop the picture-in-picture.\n",
+	"GRAB [jpeg|png|pnm] [quality] [width height]\n"
+	"    Grab the screen, the image is sent base64 encoded.\n",
 	NULL
 };
 
@@ -1466,8 +1998,7 @@ const char **cPluginSoftHdDevice::SVDRPHelpPages(void)
 **	@param reply_code	reply code
 */
 cString cPluginSoftHdDevice::SVDRPCommand(const char *command,
-		__attribute__ ((unused)) const char *option,
-		__attribute__ ((unused)) int &reply_code)
+		const char *option, int &reply_code)
 {
 	if (!strcasecmp(command, "PLAY")) {
 #ifdef MEDIA_DEBUG
@@ -1476,6 +2007,82 @@ cString cPluginSoftHdDevice::SVDRPCommand(const char *command,
 		cControl::Launch(new cSoftHdControl(option));
 		return "PLAY url";
 	}
+	if (!strcasecmp(command, "PIP")) {
+		if (!NewPip(option && *option ? atoi(option) : 0)) {
+			reply_code = 550;
+			return "no device for the pip channel";
+		}
+		return cString::sprintf("pip channel %d", PipChannelNr);
+	}
+	if (!strcasecmp(command, "PIPR")) {
+		if (!option || !*option) {
+			reply_code = 501;
+			return "missing recording path";
+		}
+		NewPipRecording(option);
+		return cString::sprintf("pip recording %s", option);
+	}
+	if (!strcasecmp(command, "PIPP")) {
+		int x;
+		int y;
+		int width;
+		int height;
+
+		if (!option || sscanf(option, "%d %d %d %d", &x, &y, &width, &height) != 4) {
+			reply_code = 501;
+			return "usage: PIPP x y width height";
+		}
+		ConfigPipX = x;
+		ConfigPipY = y;
+		ConfigPipWidth = width;
+		ConfigPipHeight = height;
+		PipSetPositionConfig();
+		return "pip moved";
+	}
+	if (!strcasecmp(command, "PIPS")) {
+		DelPip();
+		return "pip stopped";
+	}
+	if (!strcasecmp(command, "GRAB")) {
+		char type[8] = "jpeg";
+		int quality = -1;
+		int width = -1;
+		int height = -1;
+		int format;
+		int size;
+		uchar *image;
+
+		if (option && *option)
+			sscanf(option, "%7s %d %d %d", type, &quality, &width, &height);
+		if (!strcasecmp(type, "jpeg") || !strcasecmp(type, "jpg"))
+			format = GRAB_IMAGE_JPEG;
+		else if (!strcasecmp(type, "png"))
+			format = GRAB_IMAGE_PNG;
+		else if (!strcasecmp(type, "pnm"))
+			format = GRAB_IMAGE_PNM;
+		else {
+			reply_code = 501;
+			return "usage: GRAB [jpeg|png|pnm] [quality] [width height]";
+		}
+
+		if (!(image = ::GrabImage(&size, format, quality, width, height))) {
+			reply_code = 451;
+			return "grab image failed";
+		}
+
+		std::string reply;
+		cBase64Encoder base64(image, size);
+		const char *line;
+
+		while ((line = base64.NextLine())) {
+			reply += line;
+			reply += '\n';
+		}
+		free(image);
+
+		reply_code = 216;
+		return reply.c_str();
+	}
 
     return NULL;
 }
@@ -59,6 +59,28 @@ static int ConfigAudioAutoAES;		///< config automatic AES handling
 static int ConfigAudioEq;			///< config equalizer filter 
 static int SetupAudioEqBand[18];	///< config equalizer filter bands
 
+static int ConfigOsdWidth;		///< config osd width (0 = screen)
+static int ConfigOsdHeight;		///< config osd height (0 = screen)
+static int ConfigOsdFormat;		///< config osd format (1 = ARGB4444)
+int ConfigFastSwitch;			///< config fast channel switch
+static int ConfigAutoRefresh;		///< config match refresh rate to stream
+static int ConfigDisplayMode;		///< config display mode policy
+static int ConfigDeinterlacer;		///< config best software deinterlacer
+static int ConfigFilterThreads;		///< config filter slice threads
+static int ConfigFilterCpus;		///< config filter cpu mask
+static int ConfigDecoderThreads;	///< config video decoder threads
+static int ConfigDecodeCpus;		///< config decoder cpu mask
+static int ConfigDisplayCpus;		///< config display thread cpu mask
+static int ConfigDisplayPriority;	///< config display thread priority
+static int ConfigAudioCpus;		///< config audio thread cpu mask
+static int ConfigAudioPriority;		///< config audio thread priority
+int ConfigMediaBufferSize;		///< config media player io buffer (KiB)
+
+static int ConfigPipX = 65;		///< config pip x-position in % of screen
+static int ConfigPipY = 65;		///< config pip y-position in % of screen
+static int ConfigPipWidth = 30;		///< config pip width in % of screen
+static int ConfigPipHeight = 30;	///< config pip height in % of screen
+
 static volatile int DoMakePrimary;	///< switch primary device to this
 
 //////////////////////////////////////////////////////////////////////////////
@@ -124,6 +146,28 @@ class cMenuSetupSoft:public cMenuSetupPage
     int General;
     int MakePrimary;
     int HideMainMenuEntry;
+    int OsdWidth;
+    int OsdHeight;
+    int OsdFormat;
+    int FastSwitch;
+    int AutoRefresh;
+    int DisplayMode;
+    int Deinterlacer;
+    int FilterThreads;
+    int FilterCpus;
+    int DecoderThreads;
+    int DecodeCpus;
+    int DisplayCpus;
+    int DisplayPriority;
+    int AudioCpus;
+    int AudioPriority;
+    int MediaBufferSize;
+
+    int Pip;
+    int PipX;
+    int PipY;
+    int PipWidth;
+    int PipHeight;
 
     int Audio;
     int AudioDelay;
@@ -204,6 +248,48 @@ class cSoftHdDevice:public cDevice
     virtual void MakePrimaryDevice(bool);
 };
 
+//////////////////////////////////////////////////////////////////////////////
+//	PIP
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+**	Receiver of the pip channel.
+*/
+class cSoftReceiver:public cReceiver
+{
+  private:
+    cTsToPes TsToPes;			///< video pes assembler
+  protected:
+    virtual void Activate(bool);
+#if APIVERSNUM >= 20301
+    virtual void Receive(const uchar *, int);
+#else
+    virtual void Receive(uchar *, int);
+#endif
+  public:
+     cSoftReceiver(const cChannel *);	///< receiver constructor
+     virtual ~ cSoftReceiver();		///< receiver destructor
+};
+
+/**
+**	Player of the pip recording.
+*/
+class cSoftPipPlayer:public cThread
+{
+  private:
+    cString FileName;			///< recording directory
+    cTsToPes TsToPes;			///< video pes assembler
+  protected:
+    virtual void Action(void);
+  public:
+     cSoftPipPlayer(const char *);	///< recording player constructor
+     virtual ~ cSoftPipPlayer();	///< recording player destructor
+};
+
+static cSoftReceiver *PipReceiver;	///< pip channel receiver
+static cSoftPipPlayer *PipPlayer;	///< pip recording player
+static int PipChannelNr;		///< pip channel number
+
 //////////////////////////////////////////////////////////////////////////////
 //	cPlugin
 //////////////////////////////////////////////////////////////////////////////
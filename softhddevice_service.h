@@ -24,6 +24,7 @@
 
 #define ATMO_GRAB_SERVICE	"SoftHDDevice-AtmoGrabService-v1.0"
 #define ATMO1_GRAB_SERVICE	"SoftHDDevice-AtmoGrabService-v1.1"
+#define PIP_SERVICE		"SoftHDDevice-PipService-v1.0"
 
 enum
 { GRAB_IMG_RGBA_FORMAT_B8G8R8A8 };
@@ -62,3 +63,19 @@ typedef struct
 
     void *img;
 } SoftHDDevice_AtmoGrabService_v1_1_t;
+
+typedef struct
+{
+    // request data
+
+    int mode;			///< 0 = stop, 1 = channel, 2 = recording
+    int channel;		///< channel number (0 = current channel)
+    const char *recording;	///< recording directory
+
+    // pip window in % of the screen, all 0 = setup position
+
+    int x;
+    int y;
+    int width;
+    int height;
+} SoftHDDevice_PipService_v1_0_t;
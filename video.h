@@ -27,6 +27,7 @@
 #ifndef __VIDEO_H
 #define __VIDEO_H
 
+#include <pthread.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 #include <libavfilter/avfilter.h>
@@ -39,6 +40,36 @@
 //----------------------------------------------------------------------------
 
 #define VIDEO_SURFACES_MAX	3	///< video output surfaces for queue
+#define VIDEO_REVERSE_MAX	16	///< max frames of a reverse gop
+#define VIDEO_REVERSE_HW_MAX	4	///< max hardware frames of a reverse gop
+#define VIDEO_REVERSE_BYTES	(64 * 1024 * 1024)	///< max frame data of a reverse gop
+#define VIDEO_MODES_MAX		32	///< max display modes of the connector
+
+///
+///	Get the max. frames of a reverse gop.
+///
+///	The buffer holds max. VIDEO_REVERSE_BYTES of frame data. Hardware
+///	frames are surfaces of the decoder pool, only VIDEO_REVERSE_HW_MAX
+///	of them are held, so the decoder can't starve while it drains a long
+///	gop.
+///
+///	@param frame	decoded frame
+///
+static inline int VideoReverseLimit(const AVFrame * frame)
+{
+	int max;
+
+	max = VIDEO_REVERSE_BYTES / (frame->width * frame->height * 3 / 2 + 1);
+	if (max > VIDEO_REVERSE_MAX)
+		max = VIDEO_REVERSE_MAX;
+	if ((frame->format == AV_PIX_FMT_DRM_PRIME || frame->hw_frames_ctx) &&
+		max > VIDEO_REVERSE_HW_MAX)
+		max = VIDEO_REVERSE_HW_MAX;
+	if (max < 1)
+		max = 1;
+
+	return max;
+}
 
 //----------------------------------------------------------------------------
 //	Typedefs
@@ -46,14 +77,36 @@
 #ifdef MMAL
     /// Video hardware decoder typedef
 typedef struct _Mmal_Render_ VideoRender;
+#elif defined(VIDEO_NULL)
+    /// Null video render typedef
+typedef struct _Null_Render_ VideoRender;
 #else
 struct drm_buf {
 	uint32_t width, height, size, pitch[4], handle[4], offset[4], fb_id;
 	uint32_t draw_width, draw_height, draw_x, draw_y;
 	uint8_t *plane[4];
 	uint32_t pix_fmt;
+	uint64_t modifier;
 	int fd_prime;
 	AVFrame *frame;
+	uint8_t *map;			///< read mapping of a prime buffer
+	size_t map_size;
+};
+
+///
+///	Ambilight sampler, the display thread samples the shown frame
+///	into a double buffer, the grab service reads it without locks.
+///
+struct drm_sample {
+	int ReqWidth, ReqHeight;	///< size request of the grab service
+	uint32_t Tick;			///< ms ticks of the last request
+	volatile int Index;		///< published buffer
+	volatile unsigned Seq;		///< publish counter
+	struct {
+		int ReqWidth, ReqHeight;	///< request of the image
+		int Width, Height;		///< image size
+		uint8_t *Image;			///< BGRA image
+	} Buf[2];
 };
 
 struct _Drm_Render_
@@ -71,6 +124,14 @@ struct _Drm_Render_
 	VideoStream *Stream;		///< video stream
 	int TrickSpeed;			///< current trick speed
 //	int TrickCounter;			///< current trick speed counter
+	uint32_t TrickTick;		///< ms ticks of the last trick frame
+	volatile int StillPending;	///< still picture not yet shown
+
+	int Reverse;			///< reverse playback, buffer gop frames
+	AVFrame *ReverseRb[VIDEO_REVERSE_MAX];	///< decoded frames of a reverse gop
+	int ReverseFirst;		///< oldest frame of the reverse buffer
+	int ReverseFilled;		///< frames in the reverse buffer
+	AVCodecContext *ReverseCtx;	///< codec context of the reverse frames
 	int VideoPaused;
 	int Closing;			///< flag about closing current stream
 	int Filter_Close;
@@ -84,26 +145,78 @@ struct _Drm_Render_
 	int CodecMode;			/// 0: find codec by id, 1: set _mmal, 2: no mpeg hw,
 							/// 3: set _v4l2m2m for H264
 	int NoHwDeint;			/// set if no hw deinterlacer
+	uint32_t Format10;		///< plane format of 10 bit software frames
 
 	AVFilterGraph *filter_graph;
 	AVFilterContext *buffersrc_ctx, *buffersink_ctx;
+	AVRational FilterTimeBase;	///< time base of the filter input
+	int FilterHeight;		///< picture height of the filter input
+	const char *FilterName;		///< name of the main filter
+	int FilterThreads;		///< slice threads of the graph
+	int FilterAvg;			///< us per input frame at the last check
+	int DeintTier;			///< software deinterlacer tier (-1 = none)
+	int DeintSwitch;		///< rebuild the filter with the next frame
+	int DeintPeriod;		///< us per filter input frame
+	int DeintFrames;		///< input frames since the last filter check
+	int DeintDropped;		///< frames dropped at the last filter check
+	uint64_t DeintTime;		///< us the filter needed since the last check
 
 	int fd_drm;
 	drmModeModeInfo mode;
+	drmModeModeInfo Modes[VIDEO_MODES_MAX];	///< progressive modes up to the start size
+	int ModesCount;			///< number of modes
+	int ModeBase;			///< mode at start, restored on stop
+	int ModeCur;			///< mode shown
+	int ModeWant;			///< mode wanted by the stream (-1 none)
+	uint32_t ModeWantTick;		///< ms ticks of the mode request
+	int StreamRate;			///< frame rate of the stream in mHz
+	int StreamWidth;		///< picture width of the stream
+	int StreamHeight;		///< picture height of the stream
 	drmModeCrtc *saved_crtc;
 	drmEventContext ev;
 	struct drm_buf *act_buf;
 	struct drm_buf bufs[36];
 	struct drm_buf buf_osd;
 	struct drm_buf buf_black;
+	struct drm_buf buf_hold;		///< last frame held on channel switch
 	int use_zpos;
 	uint64_t zpos_overlay;
 	uint64_t zpos_primary;
 	uint32_t connector_id, crtc_id, video_plane, osd_plane;
+	int HdrSupport;			///< connector has hdr output metadata
+	struct hdr_output_metadata HdrMeta;	///< hdr metadata of the connector
+	uint32_t HdrBlob;		///< property blob of the hdr metadata
+	int Colorspace;			///< connector colorspace (-1 unset)
+	int ColorEncoding;		///< video plane color encoding (-1 unset)
+	int ColorRange;			///< video plane color range (-1 unset)
 	AVFrame *lastframe;
 	int buffers;
 	int enqueue_buffer;
 	int OsdShown;
+	int ReleaseBuffers;		///< request to free buffers of other size
+	int EarlyFrame;			///< first frame shown before a/v sync
+	int Seek;			///< closing for a seek, hold the last frame
+
+	uint32_t ZapStartTick;		///< ms ticks of the channel switch start
+	int ZapFirstFrame;		///< ms until the first frame was shown
+	int ZapSync;			///< ms until a/v sync
+
+	pthread_t DecodeThread;		///< video decode thread
+	pthread_t DisplayThread;	///< video display thread
+	pthread_t FilterThread;		///< video deinterlace/scale thread
+	pthread_cond_t PauseCondition;
+	pthread_mutex_t PauseMutex;
+	pthread_cond_t WaitCleanCondition;
+	pthread_mutex_t WaitCleanMutex;
+	pthread_mutex_t GrabMutex;	///< shown buffer lock for the grab
+	struct drm_sample Sample;	///< ambilight sampler
+
+	struct _Drm_Render_ *Main;	///< main render of a pip render
+	uint32_t pip_x, pip_y, pip_width, pip_height;	///< pip window on screen
+	uint32_t pip_plane_x, pip_plane_y, pip_plane_width, pip_plane_height;
+	uint32_t pip_src_width, pip_src_height;	///< current pip plane setup
+	uint32_t pip_start_tick;	///< ms ticks of the pip pts base
+	int64_t pip_start_pts;		///< ms pts of the pip pts base
 };
 
     /// Video hardware decoder typedef
@@ -149,9 +262,24 @@ extern void VideoOsdDrawARGB(VideoRender *, int, int, int,
     /// Set closing flag.
 extern void VideoSetClosing(VideoRender *);
 
+    /// Set seek flag for the next closing.
+extern void VideoSetSeek(VideoRender *, int);
+
     /// Set trick play speed.
 extern void VideoSetTrickSpeed(VideoRender *, int);
 
+    /// Set reverse playback.
+extern void VideoSetReverse(VideoRender *, int);
+
+    /// Wait for the frame of a still picture.
+extern void VideoSetStill(VideoRender *, int);
+
+    /// Check if the frame of a still picture isn't shown yet.
+extern int VideoIsStillPending(const VideoRender *);
+
+    /// Queue the newest frame of a reverse gop.
+extern int VideoReverseOutput(VideoRender *);
+
 extern void VideoFlushBuffers(VideoRender *);
 
 extern void VideoPause(VideoRender *);
@@ -167,15 +295,70 @@ extern uint8_t *VideoGrabService(int *, int *, int *);
     /// Get decoder statistics.
 extern void VideoGetStats(VideoRender *, int *, int *, int *);
 
+    /// Get channel switch time.
+extern void VideoGetZapTime(VideoRender *, int *, int *);
+
+    /// Get filter statistics.
+extern void VideoGetFilterStats(VideoRender *, const char **, int *, int *,
+    int *);
+
     /// Get screen size
 extern void VideoGetScreenSize(VideoRender *, int *, int *, double *);
 
+    /// Get osd size
+extern void VideoGetOsdSize(VideoRender *, int *, int *, double *);
+
+    /// Set osd size.
+extern void VideoSetOsdSize(int, int);
+
+    /// Set osd pixel format.
+extern void VideoSetOsdFormat(int);
+
+    /// Set automatic refresh rate.
+extern void VideoSetAutoRefresh(int);
+
+    /// Set display mode policy.
+extern void VideoSetDisplayMode(int);
+
+    /// Set best software deinterlacer.
+extern void VideoSetDeinterlacer(int);
+
+    /// Set filter slice threads.
+extern void VideoSetFilterThreads(int);
+
+    /// Set filter cpu mask.
+extern void VideoSetFilterCpus(int);
+
+    /// Set decode thread cpu mask.
+extern void VideoSetDecodeCpus(int);
+
+    /// Set display thread cpu mask.
+extern void VideoSetDisplayCpus(int);
+
+    /// Set display thread realtime priority.
+extern void VideoSetDisplayPriority(int);
+
+    /// Set fast channel switch.
+extern void VideoSetFastSwitch(int);
+
+    /// Setup a pip render on a free plane of the main render.
+extern int VideoPipInit(VideoRender *, VideoRender *);
+
+    /// Release the plane of a pip render.
+extern void VideoPipExit(VideoRender *);
+
+    /// Set pip window position.
+extern void VideoSetPipPosition(VideoRender *, int, int, int, int);
+
+    /// Get the video stream of a render.
+extern VideoStream *VideoGetStream(const VideoRender *);
+
     /// Get video clock.
 extern int64_t VideoGetClock(const VideoRender *);
 
     /// Display handler.
 extern void VideoThreadWakeup(VideoRender *);
-extern void VideoThreadExit(void);
+extern void VideoThreadExit(VideoRender *);
 
 extern void VideoInit(VideoRender *);	///< Setup video module.
 extern void VideoExit(VideoRender *);		///< Cleanup and exit video module.
@@ -184,5 +367,15 @@ extern int VideoCodecMode(VideoRender *);
 
 extern const char * VideoGetDecoderName(const char *);
 
+#ifdef VIDEO_NULL
+#define VIDEO_NULL_QUEUED	0	///< null render frame decoded
+#define VIDEO_NULL_SHOWN	1	///< null render frame shown
+#define VIDEO_NULL_DROPPED	2	///< null render frame dropped
+#define VIDEO_NULL_DUPED	3	///< null render frame repeated
+
+    /// Frame event hook of the null render (event, frame pts)
+extern void (*VideoNullHook)(int, int64_t);
+#endif
+
 /// @}
 #endif
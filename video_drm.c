@@ -44,11 +44,14 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 //#include <sys/utsname.h>
+#include <linux/dma-buf.h>
 #include <drm_fourcc.h>
 #include <libavcodec/avcodec.h>
 #include <libavutil/hwcontext_drm.h>
+#include <libavutil/mastering_display_metadata.h>
 #include <libavutil/pixdesc.h>
 //#include <libavutil/time.h>
 #include <libavfilter/buffersink.h>
@@ -58,23 +61,52 @@
 #include "misc.h"
 #include "video.h"
 #include "audio.h"
+#include "grab.h"
 
 //----------------------------------------------------------------------------
 //	Variables
 //----------------------------------------------------------------------------
 int VideoAudioDelay;
 
-static pthread_cond_t PauseCondition;
-static pthread_mutex_t PauseMutex;
-
-static pthread_cond_t WaitCleanCondition;
-static pthread_mutex_t WaitCleanMutex;
-
-static pthread_t DecodeThread;		///< video decode thread
-
-static pthread_t DisplayThread;
-
-static pthread_t FilterThread;
+static int VideoOsdWidth;		///< config osd width (0 = screen width)
+static int VideoOsdHeight;		///< config osd height (0 = screen height)
+static int VideoOsdFormat;		///< config osd format (0 = ARGB8888, 1 = ARGB4444)
+static int VideoFastSwitch;		///< config fast channel switch
+static int VideoAutoRefresh;		///< config match refresh rate to stream
+static int VideoDisplayMode;		///< config display mode policy
+static int VideoDeinterlacer;		///< config best software deinterlacer tier
+static int VideoFilterThreads;		///< config filter slice threads (0 = auto)
+static int VideoFilterCpus;		///< config cpu mask of the filter (0 = any)
+static int VideoDecodeCpus;		///< config cpu mask of the decode thread
+static int VideoDisplayCpus;		///< config cpu mask of the display thread
+static int VideoDisplayPriority;	///< config realtime priority of the display
+static VideoRender *GrabRender;		///< main render for the screen grab
+static pthread_mutex_t VideoCommitMutex = PTHREAD_MUTEX_INITIALIZER;	///< drm commit lock
+
+#define VIDEO_HOLD_TIMEOUT 3000		///< ms to hold the last frame without a new stream
+#define VIDEO_TRICK_FRAME_MS 20		///< ms of a trick speed 1 frame
+#define VIDEO_SAMPLE_MAX (256 * 256)	///< max pixels of a sampler image
+#define VIDEO_SAMPLE_TIMEOUT 2000	///< ms to sample without requests
+#define VIDEO_MODE_DELAY 1500		///< ms a stream plays before the mode switch
+#define VIDEO_MODE_RESTORE 10000	///< ms without stream to restore the mode
+#define VIDEO_MODE_TOLERANCE 10		///< max refresh error in 1/1000
+#define VIDEO_COMMIT_RETRY 25		///< tries of a busy nonblocking commit
+#define VIDEO_COMMIT_WAIT 2		///< ms between the busy commit tries
+
+#define VIDEO_DEINT_TIERS 5		///< software deinterlacer tiers
+#define VIDEO_DEINT_LOAD 60		///< % of the frame period a tier may cost
+#define VIDEO_DEINT_OVERLOAD 90		///< % of the frame period to step down
+#define VIDEO_DEINT_CHECK 50		///< frames between the load checks
+#define VIDEO_DEINT_BENCH_FRAMES 8	///< frames to measure a tier
+#define VIDEO_DEINT_BENCH_PAUSE 100	///< ms pause between the measurements
+
+#define VIDEO_DISPLAY_FIXED 0		///< 1920x1080 or 1280x720 mode
+#define VIDEO_DISPLAY_NATIVE 1		///< preferred mode of the panel
+#define VIDEO_DISPLAY_VIDEO 2		///< mode size follows the video
+
+#define VIDEO_EOTF_SDR 0		///< hdmi eotf traditional gamma sdr
+#define VIDEO_EOTF_PQ 2			///< hdmi eotf smpte st 2084
+#define VIDEO_EOTF_HLG 3		///< hdmi eotf bt.2100 hlg
 
 //----------------------------------------------------------------------------
 //	Helper functions
@@ -87,12 +119,70 @@ static void ReleaseFrame( __attribute__ ((unused)) void *opaque, uint8_t *data)
 	av_free(primedata);
 }
 
+///
+///	Commit an atomic request.
+///
+///	The main display, the pip and the mode switch share the drm fd and
+///	the crtc, their commits are serialized. A nonblocking commit is
+///	retried while the commit of the other thread is pending.
+///
+///	@returns 0 on success, errno is set on failure.
+///
+static int DrmAtomicCommit(int fd_drm, drmModeAtomicReqPtr ModeReq, uint32_t flags)
+{
+	int ret;
+	int err;
+	int i;
+
+	for (i = 0; i < VIDEO_COMMIT_RETRY; ++i) {
+		pthread_mutex_lock(&VideoCommitMutex);
+		ret = drmModeAtomicCommit(fd_drm, ModeReq, flags, NULL);
+		err = errno;
+		pthread_mutex_unlock(&VideoCommitMutex);
+
+		if (!ret || err != EBUSY || !(flags & DRM_MODE_ATOMIC_NONBLOCK))
+			break;
+		usleep(VIDEO_COMMIT_WAIT * 1000);
+	}
+	errno = err;
+
+	return ret;
+}
+
 static void ThreadExitHandler(void * arg)
 {
 	VideoRender * render = (VideoRender *)arg;
 
 	avfilter_graph_free(&render->filter_graph);
-	FilterThread = 0;
+	render->FilterThread = 0;
+}
+
+///
+///	Find a property of a drm object.
+///
+///	@returns property, NULL if the object hasn't it. Free it with
+///	drmModeFreeProperty().
+///
+static drmModePropertyPtr FindProperty(int fd_drm, uint32_t objectID,
+						uint32_t objectType, const char *propName)
+{
+	uint32_t i;
+	drmModePropertyPtr Prop = NULL;
+	drmModeObjectPropertiesPtr objectProps =
+		drmModeObjectGetProperties(fd_drm, objectID, objectType);
+
+	if (!objectProps)
+		return NULL;
+	for (i = 0; i < objectProps->count_props; i++) {
+		if ((Prop = drmModeGetProperty(fd_drm, objectProps->props[i])) &&
+			!strcmp(propName, Prop->name))
+			break;
+		drmModeFreeProperty(Prop);
+		Prop = NULL;
+	}
+	drmModeFreeObjectProperties(objectProps);
+
+	return Prop;
 }
 
 static uint64_t GetPropertyValue(int fd_drm, uint32_t objectID,
@@ -302,6 +392,29 @@ void ReadHWPlatform(VideoRender * render)
 	free((void *)txt_buf);
 }
 
+///
+/// Test if a plane supports the given pixel format.
+///
+static int PlaneHasFormat(int fd_drm, uint32_t plane_id, uint32_t format)
+{
+	drmModePlane *plane;
+	uint32_t k;
+	int found = 0;
+
+	if (!plane_id || !(plane = drmModeGetPlane(fd_drm, plane_id)))
+		return 0;
+
+	for (k = 0; k < plane->count_formats; k++) {
+		if (plane->formats[k] == format) {
+			found = 1;
+			break;
+		}
+	}
+	drmModeFreePlane(plane);
+
+	return found;
+}
+
 static int TestCaps(int fd)
 {
 	uint64_t test;
@@ -327,16 +440,603 @@ static int TestCaps(int fd)
 	return 0;
 }
 
+//----------------------------------------------------------------------------
+//	Display modes
+//----------------------------------------------------------------------------
+
+///
+///	Get the exact refresh rate of a mode.
+///
+///	@returns refresh rate in mHz.
+///
+static int VideoModeRefresh(const drmModeModeInfo * mode)
+{
+	if (!mode->htotal || !mode->vtotal)
+		return mode->vrefresh * 1000;
+	return (uint64_t)mode->clock * 1000000 / (mode->htotal * mode->vtotal);
+}
+
+///
+///	Check if the display mode follows the stream.
+///
+static inline int VideoModeAuto(void)
+{
+	return VideoAutoRefresh || VideoDisplayMode == VIDEO_DISPLAY_VIDEO;
+}
+
+///
+///	Select the start mode of the connector.
+///
+///	Fixed takes 1920x1080, else 1280x720. Native and video take the
+///	preferred mode of the panel, else its largest progressive mode.
+///	50Hz wins before 60Hz and the other rates.
+///
+///	@param render		video render
+///	@param connector	connected connector
+///
+///	@retval 0	render->mode is set
+///	@retval -1	no usable mode
+///
+static int VideoModeSelect(VideoRender * render,
+	const drmModeConnector * connector)
+{
+	static const int fixed[][2] = { { 1920, 1080 }, { 1280, 720 } };
+	static const uint32_t rates[] = { 50, 60, 0 };
+	const drmModeModeInfo *found;
+	int width;
+	int height;
+	int i;
+	int r;
+	int s;
+
+	found = NULL;
+	width = height = 0;
+	if (VideoDisplayMode != VIDEO_DISPLAY_FIXED) {
+		for (i = 0; i < connector->count_modes; i++) {
+			const drmModeModeInfo *mode = &connector->modes[i];
+
+			if (mode->flags & DRM_MODE_FLAG_INTERLACE)
+				continue;
+			if (mode->type & DRM_MODE_TYPE_PREFERRED) {
+				width = mode->hdisplay;
+				height = mode->vdisplay;
+				break;
+			}
+			if (mode->hdisplay * mode->vdisplay > width * height) {
+				width = mode->hdisplay;
+				height = mode->vdisplay;
+			}
+		}
+	}
+	for (s = width ? -1 : 0; s < (int)FF_ARRAY_ELEMS(fixed) && !found; s++) {
+		if (s >= 0) {
+			width = fixed[s][0];
+			height = fixed[s][1];
+		}
+		for (r = 0; r < (int)FF_ARRAY_ELEMS(rates) && !found; r++) {
+			for (i = 0; i < connector->count_modes; i++) {
+				const drmModeModeInfo *mode = &connector->modes[i];
+
+				if (mode->hdisplay == width && mode->vdisplay == height &&
+					(!rates[r] || mode->vrefresh == rates[r]) &&
+					!(mode->flags & DRM_MODE_FLAG_INTERLACE)) {
+					found = mode;
+					break;
+				}
+			}
+		}
+	}
+	if (!found)
+		return -1;
+
+	render->mode = *found;
+	return 0;
+}
+
+///
+///	Keep the progressive modes for the mode switch.
+///
+///	These are the modes of the start size for the refresh rate
+///	matching, with the video policy also the smaller sizes.
+///
+///	@param render		video render with the start mode
+///	@param connector	connector of the mode
+///
+static void VideoModeList(VideoRender * render,
+	const drmModeConnector * connector)
+{
+	int i;
+	int n;
+
+	n = 0;
+	render->ModeBase = -1;
+	for (i = 0; i < connector->count_modes && n < VIDEO_MODES_MAX; i++) {
+		const drmModeModeInfo *mode = &connector->modes[i];
+
+		if (mode->flags & DRM_MODE_FLAG_INTERLACE ||
+			mode->hdisplay > render->mode.hdisplay ||
+			mode->vdisplay > render->mode.vdisplay)
+			continue;
+		if (VideoDisplayMode != VIDEO_DISPLAY_VIDEO &&
+			(mode->hdisplay != render->mode.hdisplay ||
+			mode->vdisplay != render->mode.vdisplay))
+			continue;
+		if (!memcmp(mode, &render->mode, sizeof(*mode)))
+			render->ModeBase = n;
+		render->Modes[n++] = *mode;
+	}
+	render->ModesCount = render->ModeBase < 0 ? 0 : n;
+	render->ModeCur = render->ModeBase;
+	render->ModeWant = -1;
+}
+
+///
+///	Get the error of a mode for a size and frame rate.
+///
+///	The refresh of the mode must be an integer multiple of the frame
+///	rate, so every frame is shown equally often. Without a frame rate
+///	the refresh of the start mode is kept.
+///
+///	@param render	video render
+///	@param index	mode index
+///	@param width	screen width
+///	@param height	screen height
+///	@param rate	frame rate in mHz, 0 = refresh of the start mode
+///
+///	@returns refresh error in mHz, INT_MAX if the mode doesn't fit.
+///
+static int VideoModeError(const VideoRender * render, int index, int width,
+	int height, int rate)
+{
+	const drmModeModeInfo *mode = &render->Modes[index];
+	int refresh;
+	int k;
+
+	if (mode->hdisplay != width || mode->vdisplay != height)
+		return INT_MAX;
+
+	refresh = VideoModeRefresh(mode);
+	if (!rate)
+		return abs(refresh - VideoModeRefresh(&render->Modes[render->ModeBase]));
+	k = (refresh + rate / 2) / rate;
+	if (!k || abs(refresh - k * rate) > refresh / 1000 * VIDEO_MODE_TOLERANCE)
+		return INT_MAX;
+	return abs(refresh - k * rate);
+}
+
+///
+///	Find the mode for a stream.
+///
+///	The video policy takes the smallest size, which holds the picture.
+///	The refresh follows the frame rate, if enabled and possible. The
+///	shown and the start mode win a tie to avoid a switch.
+///
+///	@param render	video render
+///	@param width	picture width
+///	@param height	picture height
+///	@param rate	frame rate in mHz, 0 = unknown
+///
+///	@returns mode index, -1 if no mode matches.
+///
+static int VideoModeFind(const VideoRender * render, int width, int height,
+	int rate)
+{
+	int best;
+	int best_err;
+	int err[VIDEO_MODES_MAX];
+	int w;
+	int h;
+	int i;
+
+	w = render->Modes[render->ModeBase].hdisplay;
+	h = render->Modes[render->ModeBase].vdisplay;
+	if (VideoDisplayMode == VIDEO_DISPLAY_VIDEO && width > 0 && height > 0) {
+		for (i = 0; i < render->ModesCount; i++) {
+			const drmModeModeInfo *mode = &render->Modes[i];
+
+			if (mode->hdisplay >= width && mode->vdisplay >= height &&
+				mode->hdisplay * mode->vdisplay < w * h) {
+				w = mode->hdisplay;
+				h = mode->vdisplay;
+			}
+		}
+	}
+	if (!VideoAutoRefresh || rate < 0)
+		rate = 0;
+
+search:
+	best = -1;
+	best_err = INT_MAX;
+	for (i = 0; i < render->ModesCount; i++) {
+		err[i] = VideoModeError(render, i, w, h, rate);
+		if (err[i] < best_err) {
+			best_err = err[i];
+			best = i;
+		}
+	}
+	if (best < 0) {
+		if (rate) {			// no multiple of the frame rate
+			rate = 0;
+			goto search;
+		}
+		return -1;
+	}
+	// a difference below 1 mHz is a rounding error
+	if (render->ModeCur >= 0 && err[render->ModeCur] <= best_err + 1)
+		return render->ModeCur;
+	if (err[render->ModeBase] <= best_err + 1)
+		return render->ModeBase;
+	return best;
+}
+
+///
+///	Switch the display mode with an atomic modeset.
+///
+///	A new size moves the planes to the full screen, the next page
+///	flip places the picture and the osd.
+///
+static int VideoModeSet(VideoRender * render, int index)
+{
+	const drmModeModeInfo *mode = &render->Modes[index];
+	drmModeAtomicReqPtr ModeReq;
+	uint32_t blob;
+	int ret;
+
+	if (drmModeCreatePropertyBlob(render->fd_drm, mode, sizeof(*mode), &blob)) {
+		Error(_("video: can't create mode property blob\n"));
+		return -1;
+	}
+	if (!(ModeReq = drmModeAtomicAlloc())) {
+		drmModeDestroyPropertyBlob(render->fd_drm, blob);
+		return -1;
+	}
+	SetPropertyRequest(ModeReq, render->fd_drm, render->crtc_id,
+		DRM_MODE_OBJECT_CRTC, "MODE_ID", blob);
+	if (mode->hdisplay != render->mode.hdisplay ||
+		mode->vdisplay != render->mode.vdisplay) {
+		SetPlaneCrtc(render, ModeReq, render->video_plane, 0, 0,
+			mode->hdisplay, mode->vdisplay);
+		SetPlaneCrtc(render, ModeReq, render->osd_plane, 0, 0,
+			mode->hdisplay, mode->vdisplay);
+	}
+	ret = DrmAtomicCommit(render->fd_drm, ModeReq,
+		DRM_MODE_ATOMIC_ALLOW_MODESET);
+	drmModeAtomicFree(ModeReq);
+	// the crtc holds its own reference of the blob
+	drmModeDestroyPropertyBlob(render->fd_drm, blob);
+
+	if (ret) {
+		Error(_("video: can't set display mode %s (%d): %m\n"),
+			mode->name, errno);
+		return -1;
+	}
+	render->mode = *mode;
+	render->ModeCur = index;
+	Info(_("video: display mode %dx%d %d.%03dHz\n"), render->mode.hdisplay,
+		render->mode.vdisplay, VideoModeRefresh(&render->mode) / 1000,
+		VideoModeRefresh(&render->mode) % 1000);
+
+	return 0;
+}
+
+///
+///	Request the display mode of the started stream.
+///
+static void VideoModeStream(VideoRender * render)
+{
+	int index;
+
+	if (!VideoModeAuto() || !render->ModesCount)
+		return;
+	if ((index = VideoModeFind(render, render->StreamWidth,
+		render->StreamHeight, render->StreamRate)) < 0)
+		index = render->ModeBase;
+	if (index != render->ModeWant) {
+		render->ModeWant = index;
+		render->ModeWantTick = GetMsTicks();
+	}
+}
+
+///
+///	Switch the display mode after the hysteresis.
+///
+///	A new stream must play for VIDEO_MODE_DELAY, so zapping doesn't
+///	switch. The start mode comes back VIDEO_MODE_RESTORE after the
+///	stream stopped, unless the next stream wants the shown mode.
+///
+static void VideoModeCheck(VideoRender * render)
+{
+	int want;
+	uint32_t delay;
+
+	if (!render->ModesCount)
+		return;
+	want = VideoModeAuto() ? render->ModeWant : render->ModeBase;
+	if (want < 0 || want == render->ModeCur)
+		return;
+
+	delay = want == render->ModeBase ? VIDEO_MODE_RESTORE : VIDEO_MODE_DELAY;
+	if (VideoModeAuto() && GetMsTicks() - render->ModeWantTick < delay)
+		return;
+	if (VideoModeSet(render, want))
+		render->ModeWant = render->ModeCur;	// don't retry
+}
+
+///
+///	Get the rectangle of a picture on the screen.
+///
+///	The picture keeps its aspect ratio, it is pillarboxed or
+///	letterboxed. The screen has square pixels, only the 720 pixel SD
+///	modes show 16:9.
+///
+///	@param mode		display mode
+///	@param width		picture width
+///	@param height		picture height
+///	@param sar		sample aspect ratio of the picture
+///	@param rect[out]	x, y, width and height on the screen
+///
+static void VideoPicRect(const drmModeModeInfo * mode, int width, int height,
+	AVRational sar, uint32_t * rect)
+{
+	AVRational dar;
+
+	rect[0] = rect[1] = 0;
+	rect[2] = mode->hdisplay;
+	rect[3] = mode->vdisplay;
+	if (width <= 0 || height <= 0)
+		return;
+	if (sar.num <= 0 || sar.den <= 0)
+		sar = av_make_q(1, 1);
+
+	// aspect ratio in screen pixels
+	dar = av_mul_q(sar, av_make_q(width, height));
+	if (mode->hdisplay == 720 && (mode->vdisplay == 576 || mode->vdisplay == 480))
+		dar = av_div_q(dar, av_make_q(16 * mode->vdisplay, 9 * mode->hdisplay));
+	if (dar.num <= 0 || dar.den <= 0)
+		return;
+
+	rect[2] = av_rescale(mode->vdisplay, dar.num, dar.den);
+	if (!rect[2] || rect[2] > mode->hdisplay) {
+		rect[2] = mode->hdisplay;
+		rect[3] = av_rescale(mode->hdisplay, dar.den, dar.num);
+		if (!rect[3] || rect[3] > mode->vdisplay)
+			rect[3] = mode->vdisplay;
+	}
+	rect[0] = (mode->hdisplay - rect[2]) / 2;
+	rect[1] = (mode->vdisplay - rect[3]) / 2;
+}
+
+//----------------------------------------------------------------------------
+//	Colorimetry
+//----------------------------------------------------------------------------
+
+    /// plane COLOR_ENCODING enum names
+static const char *const VideoColorEncodings[] = {
+	"ITU-R BT.601 YCbCr", "ITU-R BT.709 YCbCr", "ITU-R BT.2020 YCbCr"
+};
+
+    /// plane COLOR_RANGE enum names
+static const char *const VideoColorRanges[] = {
+	"YCbCr limited range", "YCbCr full range"
+};
+
+    /// connector Colorspace enum names
+static const char *const VideoColorspaces[] = {
+	"Default", "BT2020_RGB"
+};
+
+///
+///	Add an enum property by its name to a request.
+///
+///	@retval 0	property added
+///	@retval -1	the object hasn't the property or the enum
+///
+static int SetPropertyEnum(drmModeAtomicReqPtr ModeReq, int fd_drm,
+	uint32_t objectID, uint32_t objectType, const char *propName,
+	const char *enumName)
+{
+	drmModePropertyPtr Prop;
+	int ret;
+	int i;
+
+	if (!(Prop = FindProperty(fd_drm, objectID, objectType, propName)))
+		return -1;
+	ret = -1;
+	for (i = 0; i < Prop->count_enums; i++) {
+		if (!strcmp(Prop->enums[i].name, enumName)) {
+			ret = drmModeAtomicAddProperty(ModeReq, objectID,
+				Prop->prop_id, Prop->enums[i].value) < 0 ? -1 : 0;
+			break;
+		}
+	}
+	drmModeFreeProperty(Prop);
+#ifdef DRM_DEBUG
+	if (ret)
+		fprintf(stderr, "SetPropertyEnum: no %s \'%s\'\n", propName, enumName);
+#endif
+
+	return ret;
+}
+
+///
+///	Convert a metadata value to the infoframe unit.
+///
+static uint16_t VideoHdrValue(AVRational value, int scale)
+{
+	int64_t v;
+
+	if (value.num <= 0 || value.den <= 0)
+		return 0;
+	v = av_rescale(scale, value.num, value.den);
+	return v > 0xFFFF ? 0xFFFF : v;
+}
+
+///
+///	Fill the hdr output metadata of a frame.
+///
+///	The primaries are in 0.00002, the max luminance in 1 cd/m2, the
+///	min luminance in 0.0001 cd/m2. A SDR frame gets zeroed metadata.
+///
+///	@param frame	video frame, NULL for black
+///	@param meta[out]	hdr output metadata
+///
+static void VideoHdrMetadata(const AVFrame * frame,
+	struct hdr_output_metadata *meta)
+{
+	struct hdr_metadata_infoframe *info = &meta->hdmi_metadata_type1;
+	const AVFrameSideData *sd;
+	int i;
+
+	memset(meta, 0, sizeof(*meta));
+	if (!frame)
+		return;
+	switch (frame->color_trc) {
+		case AVCOL_TRC_SMPTE2084:
+			info->eotf = VIDEO_EOTF_PQ;
+			break;
+		case AVCOL_TRC_ARIB_STD_B67:
+			info->eotf = VIDEO_EOTF_HLG;
+			break;
+		default:
+			return;
+	}
+
+	if ((sd = av_frame_get_side_data(frame,
+		AV_FRAME_DATA_MASTERING_DISPLAY_METADATA))) {
+		const AVMasteringDisplayMetadata *mdm =
+			(const AVMasteringDisplayMetadata *)sd->data;
+
+		if (mdm->has_primaries) {
+			// ffmpeg has red, green, blue, the infoframe green, blue, red
+			for (i = 0; i < 3; i++) {
+				info->display_primaries[i].x =
+					VideoHdrValue(mdm->display_primaries[(i + 1) % 3][0], 50000);
+				info->display_primaries[i].y =
+					VideoHdrValue(mdm->display_primaries[(i + 1) % 3][1], 50000);
+			}
+			info->white_point.x = VideoHdrValue(mdm->white_point[0], 50000);
+			info->white_point.y = VideoHdrValue(mdm->white_point[1], 50000);
+		}
+		if (mdm->has_luminance) {
+			info->max_display_mastering_luminance =
+				VideoHdrValue(mdm->max_luminance, 1);
+			info->min_display_mastering_luminance =
+				VideoHdrValue(mdm->min_luminance, 10000);
+		}
+	}
+	if ((sd = av_frame_get_side_data(frame,
+		AV_FRAME_DATA_CONTENT_LIGHT_LEVEL))) {
+		const AVContentLightMetadata *clm =
+			(const AVContentLightMetadata *)sd->data;
+
+		info->max_cll = FFMIN(clm->MaxCLL, 0xFFFF);
+		info->max_fall = FFMIN(clm->MaxFALL, 0xFFFF);
+	}
+}
+
+///
+///	Set the colorimetry of a frame.
+///
+///	The video plane gets the color encoding and range, the connector
+///	the colorspace and the hdr output metadata. Only changes are added
+///	to the request, the metadata blob is kept until it changes.
+///
+///	@param render	video render
+///	@param ModeReq	atomic request of the page flip
+///	@param frame	shown frame, NULL for black
+///
+///	@returns the commit flags needed for the changes.
+///
+static uint32_t VideoColorSetup(VideoRender * render,
+	drmModeAtomicReqPtr ModeReq, const AVFrame * frame)
+{
+	struct hdr_output_metadata meta;
+	uint32_t flags;
+	int encoding;
+	int range;
+	int colorspace;
+
+	encoding = 1;
+	range = 0;
+	colorspace = 0;
+	if (frame) {
+		switch (frame->colorspace) {
+			case AVCOL_SPC_BT2020_NCL:
+			case AVCOL_SPC_BT2020_CL:
+				encoding = 2;
+				break;
+			case AVCOL_SPC_BT470BG:
+			case AVCOL_SPC_SMPTE170M:
+				encoding = 0;
+				break;
+			case AVCOL_SPC_BT709:
+				break;
+			default:
+				encoding = frame->height > 576 ? 1 : 0;
+				break;
+		}
+		range = frame->color_range == AVCOL_RANGE_JPEG;
+		colorspace = frame->color_primaries == AVCOL_PRI_BT2020;
+	}
+
+	if (encoding != render->ColorEncoding) {
+		SetPropertyEnum(ModeReq, render->fd_drm, render->video_plane,
+			DRM_MODE_OBJECT_PLANE, "COLOR_ENCODING",
+			VideoColorEncodings[encoding]);
+		render->ColorEncoding = encoding;
+	}
+	if (range != render->ColorRange) {
+		SetPropertyEnum(ModeReq, render->fd_drm, render->video_plane,
+			DRM_MODE_OBJECT_PLANE, "COLOR_RANGE", VideoColorRanges[range]);
+		render->ColorRange = range;
+	}
+	if (!render->HdrSupport)
+		return 0;
+
+	flags = 0;
+	if (colorspace != render->Colorspace) {
+		SetPropertyEnum(ModeReq, render->fd_drm, render->connector_id,
+			DRM_MODE_OBJECT_CONNECTOR, "Colorspace",
+			VideoColorspaces[colorspace]);
+		render->Colorspace = colorspace;
+		flags = DRM_MODE_ATOMIC_ALLOW_MODESET;
+	}
+
+	VideoHdrMetadata(frame, &meta);
+	if (memcmp(&meta, &render->HdrMeta, sizeof(meta))) {
+		uint32_t blob = 0;
+
+		if (meta.hdmi_metadata_type1.eotf != VIDEO_EOTF_SDR &&
+			drmModeCreatePropertyBlob(render->fd_drm, &meta, sizeof(meta), &blob)) {
+			Error(_("video: can't create hdr metadata blob\n"));
+			blob = 0;
+		}
+		SetPropertyRequest(ModeReq, render->fd_drm, render->connector_id,
+			DRM_MODE_OBJECT_CONNECTOR, "HDR_OUTPUT_METADATA", blob);
+		// the connector holds its own reference of the shown blob
+		if (render->HdrBlob)
+			drmModeDestroyPropertyBlob(render->fd_drm, render->HdrBlob);
+		render->HdrBlob = blob;
+		render->HdrMeta = meta;
+		flags = DRM_MODE_ATOMIC_ALLOW_MODESET;
+
+		Info(_("video: hdr eotf %d max %d cd/m2 cll %d fall %d\n"),
+			meta.hdmi_metadata_type1.eotf,
+			meta.hdmi_metadata_type1.max_display_mastering_luminance,
+			meta.hdmi_metadata_type1.max_cll, meta.hdmi_metadata_type1.max_fall);
+	}
+
+	return flags;
+}
+
 static int FindDevice(VideoRender * render)
 {
 	drmModeRes *resources;
 	drmModeConnector *connector;
 	drmModeEncoder *encoder = 0;
-	drmModeModeInfo *mode;
 	drmModePlane *plane;
 	drmModePlaneRes *plane_res;
-	int hdr;
-	uint32_t vrefresh;
+	drmModePropertyPtr prop;
 	uint32_t j, k;
 	int i;
 
@@ -374,8 +1074,6 @@ static int FindDevice(VideoRender * render)
 
 	// find all available connectors
 	for (i = 0; i < resources->count_connectors; i++) {
-		hdr = 0;
-		vrefresh = 50;
 		connector = drmModeGetConnector(render->fd_drm, resources->connectors[i]);
 		if (!connector) {
 			fprintf(stderr, "FindDevice: cannot retrieve DRM connector (%d): %m\n", errno);
@@ -391,34 +1089,17 @@ static int FindDevice(VideoRender * render)
 				return -errno;
 			}
 			render->crtc_id = encoder->crtc_id;
-		}
-		// search Modes
-search_mode:
-		for (i = 0; i < connector->count_modes; i++) {
-			mode = &connector->modes[i];
-			// Mode HD
-			if(mode->hdisplay == 1920 && mode->vdisplay == 1080 &&
-				mode->vrefresh == vrefresh &&
-				!(mode->flags & DRM_MODE_FLAG_INTERLACE) && !hdr) {
-				memcpy(&render->mode, &connector->modes[i], sizeof(drmModeModeInfo));
-			}
-			// Mode HDready
-			if(mode->hdisplay == 1280 && mode->vdisplay == 720 &&
-				mode->vrefresh == vrefresh &&
-				!(mode->flags & DRM_MODE_FLAG_INTERLACE) && hdr) {
-				memcpy(&render->mode, &connector->modes[i], sizeof(drmModeModeInfo));
-			}
-		}
-		if (!render->mode.hdisplay || !render->mode.vdisplay) {
-			if (!hdr) {
-				hdr = 1;
-				goto search_mode;
-			}
-			if (vrefresh == 50) {
-				vrefresh = 60;
-				hdr = 0;
-				goto search_mode;
+
+			if ((prop = FindProperty(render->fd_drm, render->connector_id,
+				DRM_MODE_OBJECT_CONNECTOR, "HDR_OUTPUT_METADATA"))) {
+				render->HdrSupport = 1;
+				drmModeFreeProperty(prop);
+			} else {
+				render->HdrSupport = 0;
 			}
+
+			if (!VideoModeSelect(render, connector))
+				VideoModeList(render, connector);
 		}
 		drmModeFreeConnector(connector);
 	}
@@ -496,6 +1177,18 @@ search_mode:
 	drmModeFreeEncoder(encoder);
 	drmModeFreeResources(resources);
 
+	// 10 bit software frames: P010 keeps all bits, NV15 packs them,
+	// NV12 drops two bits
+	render->Format10 = DRM_FORMAT_NV12;
+	if (PlaneHasFormat(render->fd_drm, render->video_plane, DRM_FORMAT_P010))
+		render->Format10 = DRM_FORMAT_P010;
+#ifdef DRM_FORMAT_NV15
+	else if (PlaneHasFormat(render->fd_drm, render->video_plane, DRM_FORMAT_NV15))
+		render->Format10 = DRM_FORMAT_NV15;
+#endif
+	Info(_("video: 10 bit software frames as %4.4s\n"),
+		(char *)&render->Format10);
+
 #ifdef DRM_DEBUG
 	Info(_("FindDevice: DRM setup CRTC: %i video_plane: %i osd_plane %i use_zpos %d\n"),
 		render->crtc_id, render->video_plane, render->osd_plane, render->use_zpos);
@@ -513,16 +1206,19 @@ static int SetupFB(VideoRender * render, struct drm_buf *buf,
 	uint32_t mod_flags = 0;
 
 	if (primedata) {
-		uint32_t prime_handle;
+		uint32_t prime_handle[AV_DRM_MAX_PLANES] = { 0 };
 		buf->handle[0] = buf->handle[1] = buf->handle[2] = buf->handle[3] = 0;
 		buf->pitch[0] = buf->pitch[1] = buf->pitch[2] = buf->pitch[3] = 0;
 		buf->offset[0] = buf->offset[1] = buf->offset[2] = buf->offset[3] = 0;
 
 		buf->pix_fmt = primedata->layers[0].format;
 
-		if (drmPrimeFDToHandle(render->fd_drm, primedata->objects[0].fd, &prime_handle))
-			fprintf(stderr, "SetupFB: Failed to retrieve the Prime Handle %i size %zu (%d): %m\n",
-				primedata->objects[0].fd, primedata->objects[0].size, errno);
+		for (int object = 0; object < primedata->nb_objects; object++) {
+			if (drmPrimeFDToHandle(render->fd_drm, primedata->objects[object].fd,
+				&prime_handle[object]))
+				fprintf(stderr, "SetupFB: Failed to retrieve the Prime Handle %i size %zu (%d): %m\n",
+					primedata->objects[object].fd, primedata->objects[object].size, errno);
+		}
 #ifdef DRM_DEBUG
 		if (!render->buffers)
 			fprintf(stderr, "SetupFB: %d x %d nb_objects %d nb_layers %d nb_planes %d size %zu pix_fmt %4.4s modifier %" PRIx64 "\n",
@@ -531,12 +1227,13 @@ static int SetupFB(VideoRender * render, struct drm_buf *buf,
 				(char *)&buf->pix_fmt, primedata->objects[0].format_modifier);
 #endif
 		for (int plane = 0; plane < primedata->layers[0].nb_planes; plane++) {
-			buf->handle[plane] = prime_handle;
+			int object = primedata->layers[0].planes[plane].object_index;
+
+			buf->handle[plane] = prime_handle[object];
 			buf->pitch[plane] = primedata->layers[0].planes[plane].pitch;
 			buf->offset[plane] = primedata->layers[0].planes[plane].offset;
 			if (primedata->objects[0].format_modifier) {
-				modifier[plane] =
-					primedata->objects[primedata->layers[0].planes[plane].object_index].format_modifier;
+				modifier[plane] = primedata->objects[object].format_modifier;
 				mod_flags = DRM_MODE_FB_MODIFIERS;
 			}
 #ifdef DRM_DEBUG
@@ -549,9 +1246,18 @@ static int SetupFB(VideoRender * render, struct drm_buf *buf,
 		memset(&creq, 0, sizeof(struct drm_mode_create_dumb));
 		creq.width = buf->width;
 		creq.height = buf->height;
-		// 32 bpp for ARGB, 8 bpp for YUV420 and NV12
+		// 32 bpp for ARGB, 16 bpp for ARGB4444, 12 bpp for YUV420 and NV12,
+		// 24 bpp for P010, NV15 (15 bpp) rounds the 5 byte groups up
 		if (buf->pix_fmt == DRM_FORMAT_ARGB8888)
 			creq.bpp = 32;
+		else if (buf->pix_fmt == DRM_FORMAT_ARGB4444)
+			creq.bpp = 16;
+		else if (buf->pix_fmt == DRM_FORMAT_P010)
+			creq.bpp = 24;
+#ifdef DRM_FORMAT_NV15
+		else if (buf->pix_fmt == DRM_FORMAT_NV15)
+			creq.bpp = 16;
+#endif
 		else
 			creq.bpp = 12;
 
@@ -581,13 +1287,30 @@ static int SetupFB(VideoRender * render, struct drm_buf *buf,
 			buf->offset[1] = buf->pitch[0] * buf->height;
 		}
 
-		if (buf->pix_fmt == DRM_FORMAT_ARGB8888) {
+		if (buf->pix_fmt == DRM_FORMAT_P010) {
+			buf->pitch[1] = buf->pitch[0] = buf->width * 2;
+
+			buf->offset[0] = 0;
+			buf->offset[1] = buf->pitch[0] * buf->height;
+		}
+#ifdef DRM_FORMAT_NV15
+		if (buf->pix_fmt == DRM_FORMAT_NV15) {
+			buf->pitch[1] = buf->pitch[0] = (buf->width + 3) / 4 * 5;
+
+			buf->offset[0] = 0;
+			buf->offset[1] = buf->pitch[0] * buf->height;
+		}
+#endif
+
+		if (buf->pix_fmt == DRM_FORMAT_ARGB8888 ||
+			buf->pix_fmt == DRM_FORMAT_ARGB4444) {
 			buf->pitch[0] = creq.pitch;
 
 			buf->offset[0] = 0;
 		}
 	}
 
+	buf->modifier = modifier[0];
 	if (drmModeAddFB2WithModifiers(render->fd_drm, buf->width, buf->height, buf->pix_fmt,
 			buf->handle, buf->pitch, buf->offset, modifier, &buf->fb_id, mod_flags)) {
 
@@ -629,6 +1352,7 @@ static int SetupFB(VideoRender * render, struct drm_buf *buf,
 static void DestroyFB(int fd_drm, struct drm_buf *buf)
 {
 	struct drm_mode_destroy_dumb dreq;
+	int i;
 
 //	fprintf(stderr, "DestroyFB: destroy FB %d\n", buf->fb_id);
 
@@ -636,6 +1360,10 @@ static void DestroyFB(int fd_drm, struct drm_buf *buf)
 		if (munmap(buf->plane[0], buf->size))
 				fprintf(stderr, "DestroyFB: failed unmap FB (%d): %m\n", errno);
 	}
+	if (buf->map) {
+		munmap(buf->map, buf->map_size);
+		buf->map = NULL;
+	}
 
 	if (drmModeRmFB(fd_drm, buf->fb_id) < 0)
 		fprintf(stderr, "DestroyFB: cannot remake FB (%d): %m\n", errno);
@@ -646,7 +1374,7 @@ static void DestroyFB(int fd_drm, struct drm_buf *buf)
 
 		if (drmIoctl(fd_drm, DRM_IOCTL_MODE_DESTROY_DUMB, &dreq) < 0)
 			fprintf(stderr, "DestroyFB: cannot destroy dumb buffer (%d): %m\n", errno);
-		buf->handle[0] = 0;
+		memset(buf->handle, 0, sizeof(buf->handle));
 
 		if (buf->fd_prime) {
 			if (close(buf->fd_prime))
@@ -654,10 +1382,19 @@ static void DestroyFB(int fd_drm, struct drm_buf *buf)
 		}
 	}
 
-	if (buf->handle[0]) {
-		if (drmIoctl(fd_drm, DRM_IOCTL_GEM_CLOSE, &buf->handle[0]) < 0)
+	// the planes of a prime buffer can share an object
+	for (i = 0; i < 4; i++) {
+		struct drm_gem_close creq;
+
+		if (!buf->handle[i] || (i && buf->handle[i] == buf->handle[0]) ||
+			(i > 1 && buf->handle[i] == buf->handle[i - 1]))
+			continue;
+		memset(&creq, 0, sizeof(creq));
+		creq.handle = buf->handle[i];
+		if (drmIoctl(fd_drm, DRM_IOCTL_GEM_CLOSE, &creq) < 0)
 			fprintf(stderr, "DestroyFB: cannot close GEM (%d): %m\n", errno);
 	}
+	memset(buf->handle, 0, sizeof(buf->handle));
 
 	buf->width = 0;
 	buf->height = 0;
@@ -667,15 +1404,80 @@ static void DestroyFB(int fd_drm, struct drm_buf *buf)
 	buf->fd_prime = 0;
 }
 
+///
+///	Release the held frame of the last stream.
+///
+static void ReleaseHold(VideoRender * render)
+{
+	if (render->buf_hold.fb_id)
+		DestroyFB(render->fd_drm, &render->buf_hold);
+	if (render->buf_hold.frame)
+		av_frame_free(&render->buf_hold.frame);
+	memset(&render->buf_hold, 0, sizeof(render->buf_hold));
+}
+
+///
+///	Hold the FB on screen and destroy all other FBs.
+///
+///	The held FB takes the last frame, so a prime buffer stays valid
+///	until the next frame is shown.
+///
+static void HoldActBuf(VideoRender * render)
+{
+	int i;
+
+	if (render->act_buf != &render->buf_hold) {
+		for (i = 0; i < render->buffers; ++i) {
+			if (render->act_buf == &render->bufs[i]) {
+				ReleaseHold(render);
+				render->buf_hold = render->bufs[i];
+				render->buf_hold.frame = render->lastframe;
+				render->lastframe = NULL;
+				memset(&render->bufs[i], 0, sizeof(render->bufs[i]));
+				render->act_buf = &render->buf_hold;
+				break;
+			}
+		}
+	}
+
+	for (i = 0; i < render->buffers; ++i) {
+		if (render->bufs[i].fb_id)
+			DestroyFB(render->fd_drm, &render->bufs[i]);
+	}
+	render->buffers = 0;
+	render->enqueue_buffer = 0;
+	render->ReleaseBuffers = 0;
+}
+
+///
+///	Check if the last frame stays on screen while closing.
+///
+///	Fast channel switch and seeks hold it until the first frame of
+///	the next stream.
+///
+static inline int VideoHoldLast(const VideoRender * render)
+{
+	return VideoFastSwitch || render->Seek;
+}
+
 ///
 /// Clean DRM
 ///
+///	With fast channel switch the last frame stays on screen. Dumb
+///	buffers are kept for the next stream, prime buffers belong to the
+///	closed decoder and are destroyed except the shown one.
+///
 static void CleanDisplayThread(VideoRender * render)
 {
 	AVFrame *frame;
+	int hold;
 	int i;
 
-	if (render->lastframe) {
+	pthread_mutex_lock(&render->GrabMutex);
+	hold = VideoHoldLast(render) && !render->Main && render->act_buf &&
+		render->act_buf != &render->buf_black;
+
+	if (render->lastframe && !hold) {
 		av_frame_free(&render->lastframe);
 	}
 
@@ -692,15 +1494,27 @@ dequeue:
 	}
 
 	// Destroy FBs
-	if (render->buffers) {
+	if (hold) {
+		if (!render->buffers || !render->bufs[0].plane[0])
+			HoldActBuf(render);
+	} else {
+		ReleaseHold(render);
 		for (i = 0; i < render->buffers; ++i) {
 			DestroyFB(render->fd_drm, &render->bufs[i]);
 		}
 		render->buffers = 0;
 		render->enqueue_buffer = 0;
 	}
+	render->ReleaseBuffers = 0;
+	pthread_mutex_unlock(&render->GrabMutex);
+
+	// stream stopped, restore the start mode after the hysteresis
+	if (render->ModeWant >= 0 && render->ModeWant != render->ModeBase) {
+		render->ModeWant = render->ModeBase;
+		render->ModeWantTick = GetMsTicks();
+	}
 
-	pthread_cond_signal(&WaitCleanCondition);
+	pthread_cond_signal(&render->WaitCleanCondition);
 
 	render->Closing = 0;
 #ifdef DEBUG
@@ -708,20 +1522,453 @@ dequeue:
 #endif
 }
 
+///
+///	Search or make the fd / FB combination of a prime frame.
+///
+static struct drm_buf *GetFrameFB(VideoRender * render, AVFrame * frame)
+{
+	AVDRMFrameDescriptor *primedata = (AVDRMFrameDescriptor *)frame->data[0];
+	struct drm_buf *buf;
+	int i;
+
+	for (i = 0; i < render->buffers; i++) {
+		if (render->bufs[i].fd_prime == primedata->objects[0].fd)
+			return &render->bufs[i];
+	}
+
+	buf = &render->bufs[render->buffers];
+	buf->width = (uint32_t)frame->width;
+	buf->height = (uint32_t)frame->height;
+	buf->fd_prime = primedata->objects[0].fd;
+
+	SetupFB(render, buf, primedata);
+	if (!render->buffers)
+		Info(_("video: prime frames %4.4s modifier %" PRIx64 " %dx%d\n"),
+			(char *)&buf->pix_fmt, buf->modifier, frame->width, frame->height);
+	render->buffers++;
+
+	return buf;
+}
+
+//----------------------------------------------------------------------------
+//	Grab
+//----------------------------------------------------------------------------
+
+///
+///	Map the shown video buffer for reading.
+///
+///	The fd of the buffer is duplicated under the grab lock, so the
+///	buffer stays valid even if the display thread releases it.
+///
+///	@param render		video render
+///	@param buf[out]		copy of the shown buffer
+///	@param src[out]		mapped picture
+///	@param map_size[out]	size of the mapping
+///	@param pic_rect[out]	rectangle of the picture on screen
+///
+///	@returns mapping or NULL if no video is shown.
+///
+static uint8_t *VideoGrabMap(VideoRender * render, struct drm_buf *buf,
+	GrabSource * src, size_t * map_size, uint32_t * pic_rect)
+{
+	struct dma_buf_sync sync;
+	AVRational sar = { 0, 1 };
+	uint8_t *map;
+	off_t size;
+
+	pthread_mutex_lock(&render->GrabMutex);
+	if (!render->act_buf || render->act_buf == &render->buf_black ||
+		!render->act_buf->fd_prime) {
+		pthread_mutex_unlock(&render->GrabMutex);
+		return NULL;
+	}
+	*buf = *render->act_buf;
+	if (buf->frame)
+		sar = buf->frame->sample_aspect_ratio;
+	buf->fd_prime = dup(buf->fd_prime);
+	pthread_mutex_unlock(&render->GrabMutex);
+
+	if (buf->fd_prime < 0) {
+		fprintf(stderr, "VideoGrabMap: cannot dup prime fd (%d): %m\n", errno);
+		return NULL;
+	}
+	if ((buf->pix_fmt != DRM_FORMAT_NV12 && buf->pix_fmt != DRM_FORMAT_YUV420) ||
+		(buf->modifier && buf->modifier != DRM_FORMAT_MOD_LINEAR)) {
+		Warning(_("video: can't grab format %4.4s modifier %" PRIx64 "\n"),
+			(char *)&buf->pix_fmt, buf->modifier);
+		close(buf->fd_prime);
+		return NULL;
+	}
+
+	size = lseek(buf->fd_prime, 0, SEEK_END);
+	if (size <= 0)
+		size = buf->offset[1] + buf->pitch[1] * buf->height;
+	map = mmap(NULL, size, PROT_READ, MAP_SHARED, buf->fd_prime, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "VideoGrabMap: cannot mmap prime fd (%d): %m\n", errno);
+		close(buf->fd_prime);
+		return NULL;
+	}
+	sync.flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ;
+	ioctl(buf->fd_prime, DMA_BUF_IOCTL_SYNC, &sync);
+
+	src->Plane[0] = map + buf->offset[0];
+	src->Plane[1] = map + buf->offset[1];
+	src->Plane[2] = map + buf->offset[2];
+	src->Pitch[0] = buf->pitch[0];
+	src->Pitch[1] = buf->pitch[1];
+	src->Pitch[2] = buf->pitch[2];
+	src->Width = buf->width;
+	src->Height = buf->height;
+	src->Nv12 = buf->pix_fmt == DRM_FORMAT_NV12;
+
+	VideoPicRect(&render->mode, buf->width, buf->height, sar, pic_rect);
+
+	*map_size = size;
+	return map;
+}
+
+///
+///	Unmap a grabbed video buffer.
+///
+static void VideoGrabUnmap(struct drm_buf *buf, uint8_t * map, size_t map_size)
+{
+	struct dma_buf_sync sync;
+
+	sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ;
+	ioctl(buf->fd_prime, DMA_BUF_IOCTL_SYNC, &sync);
+	munmap(map, map_size);
+	close(buf->fd_prime);
+}
+
+///
+///	Grab full screen image.
+///
+///	The shown video frame is converted and scaled with the osd to
+///	the requested size, max. the screen size.
+///
+///	@param size[out]	size of allocated image
+///	@param width[in,out]	width of image
+///	@param height[in,out]	height of image
+///	@param write_header	write a PNM header
+///
+///	@returns allocated RGB image, PNM with header.
+///
+uint8_t *VideoGrab(int *size, int *width, int *height, int write_header)
+{
+	VideoRender *render = GrabRender;
+	struct drm_buf buf;
+	GrabSource src;
+	uint8_t *image;
+	uint8_t *rgb;
+	uint8_t *map;
+	size_t map_size;
+#ifdef DEBUG
+	uint32_t tick = GetMsTicks();
+#endif
+	uint32_t pic_rect[4];
+	int w;
+	int h;
+	int n;
+
+	if (!render || !render->mode.hdisplay) {
+		Debug(3, "video: no grab service\n");
+		return NULL;
+	}
+
+	w = render->mode.hdisplay;
+	h = render->mode.vdisplay;
+	if (*width > 0 && *width < w)
+		w = *width;
+	if (*height > 0 && *height < h)
+		h = *height;
+
+	n = write_header ? snprintf(NULL, 0, "P6\n%d\n%d\n255\n", w, h) : 0;
+	if (!(image = malloc(n + 1 + w * h * 3))) {
+		Error(_("video: out of memory\n"));
+		return NULL;
+	}
+	if (write_header)
+		snprintf((char *)image, n + 1, "P6\n%d\n%d\n255\n", w, h);
+	rgb = image + n;
+	memset(rgb, 0, w * h * 3);
+
+	if ((map = VideoGrabMap(render, &buf, &src, &map_size, pic_rect))) {
+		int pw = pic_rect[2] * w / render->mode.hdisplay;
+		int ph = pic_rect[3] * h / render->mode.vdisplay;
+
+		GrabConvert(&src, 0, 0, src.Width, src.Height,
+			rgb + ((h - ph) / 2 * w + (w - pw) / 2) * 3, w * 3, pw, ph,
+			GRAB_RGB24);
+		VideoGrabUnmap(&buf, map, map_size);
+	}
+
+	if (render->OsdShown && render->buf_osd.plane[0]) {
+		GrabBlendOsd(rgb, w * 3, w, h, GRAB_RGB24, render->buf_osd.plane[0],
+			render->buf_osd.pitch[0], render->buf_osd.width,
+			render->buf_osd.height,
+			render->buf_osd.pix_fmt == DRM_FORMAT_ARGB4444);
+	}
+
+#ifdef DEBUG
+	fprintf(stderr, "VideoGrab: %dx%d in %dms\n", w, h, GetMsTicks() - tick);
+#endif
+
+	*size = n + w * h * 3;
+	*width = w;
+	*height = h;
+	return image;
+}
+
+///
+///	Get the size of a grab service image.
+///
+///	A width <= -64 is an Atmo request: the analyse size is -width,
+///	height is the clipped overscan in 1/1000.
+///
+///	@param src		grabbed picture
+///	@param pic_rect		rectangle of the picture on screen
+///	@param req_width	requested width
+///	@param req_height	requested height
+///	@param rect[out]	source rectangle x, y, width, height
+///	@param width[out]	image width
+///	@param height[out]	image height
+///
+static void VideoGrabSize(const GrabSource * src, const uint32_t * pic_rect,
+	int req_width, int req_height, int *rect, int *width, int *height)
+{
+	rect[0] = rect[1] = 0;
+	rect[2] = src->Width;
+	rect[3] = src->Height;
+	if (req_width <= -64) {
+		int overscan = req_height;
+
+		*width = -req_width;
+		*height = *width * pic_rect[3] / pic_rect[2];
+		if (overscan > 0 && overscan <= 200) {
+			rect[0] = rect[2] * overscan / 1000;
+			rect[1] = rect[3] * overscan / 1000;
+			rect[2] -= 2 * rect[0];
+			rect[3] -= 2 * rect[1];
+		}
+	} else {
+		*width = pic_rect[2];
+		*height = pic_rect[3];
+		if (req_width > 0 && req_width < *width)
+			*width = req_width;
+		if (req_height > 0 && req_height < *height)
+			*height = req_height;
+	}
+}
+
+///
+///	Sample the shown frame for the grab service.
+///
+///	Called by the display thread after a page flip, while the grab
+///	service polls. The mapping of a prime buffer is kept until the
+///	buffer is destroyed.
+///
+///	@param render	video render
+///
+static void VideoSample(VideoRender * render)
+{
+	struct drm_sample *sample = &render->Sample;
+	struct drm_buf *buf = render->act_buf;
+	struct dma_buf_sync sync;
+	GrabSource src;
+	AVRational sar = { 0, 1 };
+	const uint8_t *base;
+	int req_width;
+	int req_height;
+	uint32_t pic_rect[4];
+	int rect[4];
+	int w;
+	int h;
+	int i;
+
+	if (!sample->Tick || GetMsTicks() - sample->Tick > VIDEO_SAMPLE_TIMEOUT)
+		return;
+	if (!buf || buf == &render->buf_black || !buf->fd_prime ||
+		(buf->pix_fmt != DRM_FORMAT_NV12 && buf->pix_fmt != DRM_FORMAT_YUV420) ||
+		(buf->modifier && buf->modifier != DRM_FORMAT_MOD_LINEAR))
+		return;
+
+	if (buf->plane[0]) {		// dumb buffer
+		base = buf->plane[0];
+	} else {
+		if (!buf->map) {
+			off_t size = lseek(buf->fd_prime, 0, SEEK_END);
+
+			if (size <= 0)
+				return;
+			buf->map = mmap(NULL, size, PROT_READ, MAP_SHARED, buf->fd_prime, 0);
+			if (buf->map == MAP_FAILED) {
+				buf->map = NULL;
+				return;
+			}
+			buf->map_size = size;
+		}
+		base = buf->map;
+	}
+
+	src.Plane[0] = base + buf->offset[0];
+	src.Plane[1] = base + buf->offset[1];
+	src.Plane[2] = base + buf->offset[2];
+	src.Pitch[0] = buf->pitch[0];
+	src.Pitch[1] = buf->pitch[1];
+	src.Pitch[2] = buf->pitch[2];
+	src.Width = buf->width;
+	src.Height = buf->height;
+	src.Nv12 = buf->pix_fmt == DRM_FORMAT_NV12;
+
+	if (buf->frame)
+		sar = buf->frame->sample_aspect_ratio;
+	VideoPicRect(&render->mode, buf->width, buf->height, sar, pic_rect);
+
+	req_width = sample->ReqWidth;
+	req_height = sample->ReqHeight;
+	VideoGrabSize(&src, pic_rect, req_width, req_height, rect, &w, &h);
+	if (w <= 0 || h <= 0 || w * h > VIDEO_SAMPLE_MAX)
+		return;
+
+	// fill the unpublished buffer
+	i = sample->Index ^ 1;
+	if (!sample->Buf[i].Image &&
+		!(sample->Buf[i].Image = malloc(VIDEO_SAMPLE_MAX * 4)))
+		return;
+
+	sync.flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ;
+	ioctl(buf->fd_prime, DMA_BUF_IOCTL_SYNC, &sync);
+	GrabSample(&src, rect[0], rect[1], rect[2], rect[3],
+		sample->Buf[i].Image, w * 4, w, h, GRAB_BGRA);
+	sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ;
+	ioctl(buf->fd_prime, DMA_BUF_IOCTL_SYNC, &sync);
+
+	sample->Buf[i].ReqWidth = req_width;
+	sample->Buf[i].ReqHeight = req_height;
+	sample->Buf[i].Width = w;
+	sample->Buf[i].Height = h;
+	__sync_synchronize();
+	sample->Index = i;
+	sample->Seq++;
+}
+
+///
+///	Get a copy of the sampler image.
+///
+///	Registers the request for the sampler, the first request of a
+///	new size returns NULL.
+///
+///	@param render		video render
+///	@param size[out]	size of allocated image
+///	@param width[in,out]	width of image
+///	@param height[in,out]	height of image
+///
+static uint8_t *VideoSampleGet(VideoRender * render, int *size, int *width,
+	int *height)
+{
+	struct drm_sample *sample = &render->Sample;
+	uint8_t *image = NULL;
+	unsigned seq;
+	int i;
+
+	sample->ReqWidth = *width;
+	sample->ReqHeight = *height;
+	sample->Tick = GetMsTicks();
+
+	do {
+		seq = sample->Seq;
+		__sync_synchronize();
+		i = sample->Index;
+		if (!sample->Buf[i].Image || sample->Buf[i].ReqWidth != *width ||
+			sample->Buf[i].ReqHeight != *height) {
+			free(image);
+			return NULL;
+		}
+		if (!image && !(image = malloc(VIDEO_SAMPLE_MAX * 4)))
+			return NULL;
+		*size = sample->Buf[i].Width * sample->Buf[i].Height * 4;
+		memcpy(image, sample->Buf[i].Image, *size);
+		*width = sample->Buf[i].Width;
+		*height = sample->Buf[i].Height;
+		__sync_synchronize();
+	} while (seq != sample->Seq);
+
+	return image;
+}
+
+///
+///	Grab image service.
+///
+///	Returns the image of the display thread sampler, a new request
+///	grabs the shown video frame without osd directly.
+///
+///	@param size[out]	size of allocated image
+///	@param width[in,out]	width of image
+///	@param height[in,out]	height of image
+///
+///	@returns allocated BGRA image.
+///
+uint8_t *VideoGrabService(int *size, int *width, int *height)
+{
+	VideoRender *render = GrabRender;
+	struct drm_buf buf;
+	GrabSource src;
+	uint8_t *image;
+	uint8_t *map;
+	size_t map_size;
+	uint32_t pic_rect[4];
+	int rect[4];
+	int w;
+	int h;
+
+	if (!render) {
+		Debug(3, "video: no grab service\n");
+		return NULL;
+	}
+	if ((image = VideoSampleGet(render, size, width, height)))
+		return image;
+
+	if (!(map = VideoGrabMap(render, &buf, &src, &map_size, pic_rect)))
+		return NULL;
+
+	VideoGrabSize(&src, pic_rect, *width, *height, rect, &w, &h);
+	if ((image = malloc(w * h * 4))) {
+		GrabSample(&src, rect[0], rect[1], rect[2], rect[3], image, w * 4,
+			w, h, GRAB_BGRA);
+		*size = w * h * 4;
+		*width = w;
+		*height = h;
+	}
+	VideoGrabUnmap(&buf, map, map_size);
+
+	return image;
+}
+
+//----------------------------------------------------------------------------
+//	Display
+//----------------------------------------------------------------------------
+
 ///
 ///	Draw a video frame.
 ///
-static void Frame2Display(VideoRender * render)
+///	@returns 1 if nothing was committed (no page flip event).
+///
+static int Frame2Display(VideoRender * render)
 {
 	struct drm_buf *buf = 0;
-	AVFrame *frame;
-	AVDRMFrameDescriptor *primedata = NULL;
+	AVFrame *frame = NULL;
 	int64_t audio_pts;
 	int64_t video_pts;
-	int i;
 
 	if (render->Closing) {
 closing:
+		// keep the last frame on fast channel switch
+		if (VideoHoldLast(render) && render->act_buf &&
+			render->act_buf != &render->buf_black) {
+			CleanDisplayThread(render);
+			return 1;
+		}
 		// set a black FB
 #ifdef DEBUG
 	fprintf(stderr, "Frame2Display: set a black FB\n");
@@ -729,33 +1976,33 @@ closing:
 		buf = &render->buf_black;
 		goto page_flip;
 	}
+	VideoModeCheck(render);
 
 dequeue:
 	while (!atomic_read(&render->FramesFilled)) {
 		if (render->Closing)
 			goto closing;
+		VideoModeCheck(render);
+		if (render->ReleaseBuffers) {
+			pthread_mutex_lock(&render->GrabMutex);
+			HoldActBuf(render);
+			pthread_mutex_unlock(&render->GrabMutex);
+		}
+		// no new stream, stop holding the last frame
+		if (VideoHoldLast(render) && !render->StartCounter &&
+			!render->EarlyFrame &&
+			render->act_buf && render->act_buf != &render->buf_black &&
+			render->ZapStartTick &&
+			GetMsTicks() - render->ZapStartTick > VIDEO_HOLD_TIMEOUT) {
+			render->Seek = 0;
+			buf = &render->buf_black;
+			goto page_flip;
+		}
 		usleep(10000);
 	}
 
 	frame = render->FramesRb[render->FramesRead];
-	primedata = (AVDRMFrameDescriptor *)frame->data[0];
-
-	// search or made fd / FB combination
-	for (i = 0; i < render->buffers; i++) {
-		if (render->bufs[i].fd_prime == primedata->objects[0].fd) {
-			buf = &render->bufs[i];
-			break;
-		}
-	}
-	if (buf == 0) {
-		buf = &render->bufs[render->buffers];
-		buf->width = (uint32_t)frame->width;
-		buf->height = (uint32_t)frame->height;
-		buf->fd_prime = primedata->objects[0].fd;
-
-		SetupFB(render, buf, primedata);
-		render->buffers++;
-	}
+	buf = GetFrameFB(render, frame);
 
 	render->pts = frame->pts;
 	video_pts = frame->pts * 1000 * av_q2d(*render->timebase);
@@ -763,6 +2010,13 @@ dequeue:
 #ifdef DEBUG
 		fprintf(stderr, "Frame2Display: start PTS %s\n", Timestamp2String(video_pts));
 #endif
+		VideoModeStream(render);
+		// show the first frame of the new stream before a/v sync
+		if (VideoHoldLast(render) && !render->EarlyFrame) {
+			render->EarlyFrame = 1;
+			render->Seek = 0;
+			goto show;
+		}
 avready:
 		if (AudioVideoReady(video_pts)) {
 			usleep(10000);
@@ -770,6 +2024,8 @@ avready:
 				goto closing;
 			goto avready;
 		}
+		if (render->ZapStartTick && !render->ZapSync)
+			render->ZapSync = GetMsTicks() - render->ZapStartTick;
 	}
 
 audioclock:
@@ -826,12 +2082,22 @@ audioclock:
 	if (!render->TrickSpeed)
 		render->StartCounter++;
 
-	if (render->TrickSpeed)
-		usleep(20000 * render->TrickSpeed);
+	// trick speed: constant cadence of speed * 20ms per frame
+	if (render->TrickSpeed) {
+		int wait = render->TrickTick + VIDEO_TRICK_FRAME_MS * render->TrickSpeed -
+			GetMsTicks();
+
+		if (render->TrickTick && wait > 0 &&
+			wait <= VIDEO_TRICK_FRAME_MS * render->TrickSpeed)
+			usleep(wait * 1000);
+		render->TrickTick = GetMsTicks();
+	}
 
+show:
 	buf->frame = frame;
 	render->FramesRead = (render->FramesRead + 1) % VIDEO_SURFACES_MAX;
 	atomic_dec(&render->FramesFilled);
+	render->StillPending = 0;
 
 page_flip:
 	render->act_buf = buf;
@@ -841,22 +2107,27 @@ page_flip:
 	if (!(ModeReq = drmModeAtomicAlloc()))
 		fprintf(stderr, "Frame2Display: cannot allocate atomic request (%d): %m\n", errno);
 
-	uint64_t PicWidth = render->mode.vdisplay * av_q2d(frame->sample_aspect_ratio) *
-		frame->width / frame->height;
-	if (!PicWidth)
-		PicWidth = render->mode.hdisplay;
+	uint32_t PicRect[4];
+	if (frame)
+		VideoPicRect(&render->mode, frame->width, frame->height,
+			frame->sample_aspect_ratio, PicRect);
+	else
+		VideoPicRect(&render->mode, 0, 0, av_make_q(0, 1), PicRect);
 
 	// handle the video plane
 	if (buf->width != (GetPropertyValue(render->fd_drm, render->video_plane,
 		DRM_MODE_OBJECT_PLANE, "SRC_W") >> 16))
 			SetPlaneSrc(render, ModeReq, render->video_plane, 0, 0, buf->width, buf->height);
 
-	if (PicWidth != GetPropertyValue(render->fd_drm, render->video_plane,
-		DRM_MODE_OBJECT_PLANE, "CRTC_W"))
+	if (PicRect[2] != GetPropertyValue(render->fd_drm, render->video_plane,
+		DRM_MODE_OBJECT_PLANE, "CRTC_W") ||
+		PicRect[3] != GetPropertyValue(render->fd_drm, render->video_plane,
+		DRM_MODE_OBJECT_PLANE, "CRTC_H"))
 			SetPlaneCrtc(render, ModeReq, render->video_plane,
-				(render->mode.hdisplay - PicWidth) / 2, 0, PicWidth, render->mode.vdisplay);
+				PicRect[0], PicRect[1], PicRect[2], PicRect[3]);
 
 	SetPlaneFbId(render, ModeReq, render->video_plane, buf->fb_id);
+	flags |= VideoColorSetup(render, ModeReq, frame);
 
 	// handle the osd plane
 	if (render->OsdShown) {
@@ -864,8 +2135,12 @@ page_flip:
 			flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
 			SetChangePlanes(render, ModeReq, 0);
 		} else {
+			// osd buffer can be smaller than the screen, scale it up
 			SetPlane(render, ModeReq, render->osd_plane, render->crtc_id, render->buf_osd.fb_id,
-				 render->buf_osd.draw_x, render->buf_osd.draw_y, render->buf_osd.draw_width, render->buf_osd.draw_height,
+				 (uint64_t)render->buf_osd.draw_x * render->mode.hdisplay / render->buf_osd.width,
+				 (uint64_t)render->buf_osd.draw_y * render->mode.vdisplay / render->buf_osd.height,
+				 (uint64_t)render->buf_osd.draw_width * render->mode.hdisplay / render->buf_osd.width,
+				 (uint64_t)render->buf_osd.draw_height * render->mode.vdisplay / render->buf_osd.height,
 				 0, 0, render->buf_osd.draw_width, render->buf_osd.draw_height);
 		}
 	} else {
@@ -879,11 +2154,24 @@ page_flip:
 		}
 	}
 
-	if (drmModeAtomicCommit(render->fd_drm, ModeReq, flags, NULL) != 0)
+	if (DrmAtomicCommit(render->fd_drm, ModeReq, flags) != 0)
 		fprintf(stderr, "Frame2Display: cannot page flip to FB %i (%d): %m\n",
 			buf->fb_id, errno);
 
 	drmModeAtomicFree(ModeReq);
+
+	// channel switch time
+	if (frame && render->ZapStartTick) {
+		if (!render->ZapFirstFrame)
+			render->ZapFirstFrame = GetMsTicks() - render->ZapStartTick;
+		if (render->ZapSync) {
+			Debug(3, "video: channel switch first frame %dms a/v sync %dms\n",
+				render->ZapFirstFrame, render->ZapSync);
+			render->ZapStartTick = 0;
+		}
+	}
+
+	return 0;
 }
 
 ///
@@ -896,6 +2184,9 @@ static void *DisplayHandlerThread(void * arg)
 	pthread_setcancelstate (PTHREAD_CANCEL_ENABLE, NULL);
 	pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
 
+	SetThreadCpus(VideoDisplayCpus);
+	SetThreadPriority(VideoDisplayPriority);
+
 	while ((atomic_read(&render->FramesFilled)) < 2 ){
 		usleep(10000);
 	}
@@ -904,12 +2195,13 @@ static void *DisplayHandlerThread(void * arg)
 		pthread_testcancel();
 
 		if (render->VideoPaused) {
-			pthread_mutex_lock(&PauseMutex);
-			pthread_cond_wait(&PauseCondition, &PauseMutex);
-			pthread_mutex_unlock(&PauseMutex);
+			pthread_mutex_lock(&render->PauseMutex);
+			pthread_cond_wait(&render->PauseCondition, &render->PauseMutex);
+			pthread_mutex_unlock(&render->PauseMutex);
 		}
 
-		Frame2Display(render);
+		if (Frame2Display(render))
+			continue;
 
 		if (drmHandleEvent(render->fd_drm, &render->ev) != 0)
 			fprintf(stderr, "DisplayHandlerThread: drmHandleEvent failed!\n");
@@ -928,11 +2220,18 @@ static void *DisplayHandlerThread(void * arg)
 		last_tick = tick;
 #endif*/
 
+		pthread_mutex_lock(&render->GrabMutex);
 		if (render->lastframe) {
 			av_frame_free(&render->lastframe);
 		}
 		render->lastframe = render->act_buf->frame;
 
+		if (render->act_buf != &render->buf_hold && render->buf_hold.fb_id)
+			ReleaseHold(render);
+		pthread_mutex_unlock(&render->GrabMutex);
+
+		VideoSample(render);
+
 		if (render->Closing && render->buf_black.fb_id == render->act_buf->fb_id) {
 			CleanDisplayThread(render);
 		}
@@ -941,50 +2240,255 @@ static void *DisplayHandlerThread(void * arg)
 }
 
 //----------------------------------------------------------------------------
-//	OSD
+//	PiP
 //----------------------------------------------------------------------------
 
 ///
-///	Clear the OSD.
-///
+///	Switch the pip plane off.
 ///
-void VideoOsdClear(VideoRender * render)
+static void PipPlaneOff(VideoRender * render)
 {
-	memset((void *)render->buf_osd.plane[0], 0,
-		(size_t)(render->buf_osd.pitch[0] * render->buf_osd.height));
+	drmModeAtomicReqPtr ModeReq;
 
-	render->OsdShown = 0;
+	if (!(ModeReq = drmModeAtomicAlloc())) {
+		fprintf(stderr, "PipPlaneOff: cannot allocate atomic request (%d): %m\n", errno);
+		return;
+	}
+
+	SetPlaneCrtcId(render, ModeReq, render->video_plane, 0);
+	SetPlaneFbId(render, ModeReq, render->video_plane, 0);
+
+	if (DrmAtomicCommit(render->fd_drm, ModeReq, DRM_MODE_ATOMIC_NONBLOCK) != 0)
+		fprintf(stderr, "PipPlaneOff: cannot disable plane %i (%d): %m\n",
+			render->video_plane, errno);
+
+	drmModeAtomicFree(ModeReq);
+
+	render->pip_plane_width = render->pip_plane_height = 0;
+	render->pip_src_width = render->pip_src_height = 0;
 }
 
 ///
-///	Draw an OSD ARGB image.
+///	Draw a pip video frame.
 ///
-///	@param xi	x-coordinate in argb image
-///	@param yi	y-coordinate in argb image
-///	@paran height	height in pixel in argb image
-///	@paran width	width in pixel in argb image
-///	@param pitch	pitch of argb image
-///	@param argb	32bit ARGB image data
-///	@param x	x-coordinate on screen of argb image
-///	@param y	y-coordinate on screen of argb image
+///	The pip has no audio, the frames are paced by their pts against the
+///	monotonic clock. The commit has no page flip event, so it doesn't
+///	steal the events of the main display thread. It is nonblocking and
+///	waits on the pending page flip of the main display.
 ///
-void VideoOsdDrawARGB(VideoRender * render, __attribute__ ((unused)) int xi,
-		__attribute__ ((unused)) int yi, int width, int height, int pitch,
-		const uint8_t * argb, int x, int y)
+static void PipFrame2Display(VideoRender * render)
 {
-	int i;
-
-	if (!render->use_zpos) {
-		render->buf_osd.draw_x = x;
-		render->buf_osd.draw_y = y;
-		render->buf_osd.draw_width = width;
-		render->buf_osd.draw_height = height;
-	}
+	struct drm_buf *buf;
+	AVFrame *frame;
+	drmModeAtomicReqPtr ModeReq;
+	int64_t video_pts;
+	double aspect;
+	uint32_t x, y, width, height;
+	int diff;
 
-	for (i = 0; i < height; ++i) {
-		memcpy(render->buf_osd.plane[0] + (x - render->buf_osd.draw_x) * 4 + (i + y - render->buf_osd.draw_y)
-		   * render->buf_osd.pitch[0], argb + i * pitch, (size_t)pitch);
-	}
+dequeue:
+	while (!atomic_read(&render->FramesFilled)) {
+		if (render->Closing)
+			goto closing;
+		if (render->ReleaseBuffers)
+			HoldActBuf(render);
+		usleep(10000);
+	}
+	if (render->Closing)
+		goto closing;
+
+	frame = render->FramesRb[render->FramesRead];
+	buf = GetFrameFB(render, frame);
+
+	if (frame->pts != AV_NOPTS_VALUE && render->timebase) {
+		video_pts = frame->pts * 1000 * av_q2d(*render->timebase);
+		diff = video_pts - render->pip_start_pts -
+			(int)(GetMsTicks() - render->pip_start_tick);
+
+		// new stream or pts jump, set a new pts base
+		if (!render->StartCounter || abs(diff) > 1000) {
+			render->pip_start_pts = video_pts;
+			render->pip_start_tick = GetMsTicks();
+			diff = 0;
+		}
+		if (diff < -40 && atomic_read(&render->FramesFilled) > 1) {
+			render->FramesDropped++;
+			av_frame_free(&frame);
+			render->FramesRead = (render->FramesRead + 1) % VIDEO_SURFACES_MAX;
+			atomic_dec(&render->FramesFilled);
+			goto dequeue;
+		}
+		if (diff > 0)
+			usleep(diff * 1000);
+	}
+
+	render->StartCounter++;
+	render->pts = frame->pts;
+
+	buf->frame = frame;
+	render->FramesRead = (render->FramesRead + 1) % VIDEO_SURFACES_MAX;
+	atomic_dec(&render->FramesFilled);
+	render->act_buf = buf;
+
+	// the main render switched the screen size, keep the window in place
+	if (render->mode.hdisplay != render->Main->mode.hdisplay ||
+		render->mode.vdisplay != render->Main->mode.vdisplay) {
+		render->pip_x = render->pip_x * render->Main->mode.hdisplay / render->mode.hdisplay;
+		render->pip_y = render->pip_y * render->Main->mode.vdisplay / render->mode.vdisplay;
+		render->pip_width = render->pip_width * render->Main->mode.hdisplay / render->mode.hdisplay;
+		render->pip_height = render->pip_height * render->Main->mode.vdisplay / render->mode.vdisplay;
+		render->mode = render->Main->mode;
+	}
+
+	// fit the picture into the pip window
+	aspect = av_q2d(frame->sample_aspect_ratio) * frame->width / frame->height;
+	if (aspect <= 0)
+		aspect = (double)16 / (double)9;
+	height = render->pip_height;
+	width = height * aspect;
+	if (width > render->pip_width) {
+		width = render->pip_width;
+		height = width / aspect;
+	}
+	x = render->pip_x + (render->pip_width - width) / 2;
+	y = render->pip_y + (render->pip_height - height) / 2;
+
+	if (!(ModeReq = drmModeAtomicAlloc())) {
+		fprintf(stderr, "PipFrame2Display: cannot allocate atomic request (%d): %m\n", errno);
+		return;
+	}
+
+	if (x != render->pip_plane_x || y != render->pip_plane_y ||
+		width != render->pip_plane_width || height != render->pip_plane_height ||
+		buf->width != render->pip_src_width || buf->height != render->pip_src_height) {
+
+		SetPlane(render, ModeReq, render->video_plane, render->crtc_id, buf->fb_id,
+			x, y, width, height, 0, 0, buf->width, buf->height);
+
+		render->pip_plane_x = x;
+		render->pip_plane_y = y;
+		render->pip_plane_width = width;
+		render->pip_plane_height = height;
+		render->pip_src_width = buf->width;
+		render->pip_src_height = buf->height;
+	} else {
+		SetPlaneFbId(render, ModeReq, render->video_plane, buf->fb_id);
+	}
+
+	if (DrmAtomicCommit(render->fd_drm, ModeReq, DRM_MODE_ATOMIC_NONBLOCK) != 0)
+		fprintf(stderr, "PipFrame2Display: cannot page flip to FB %i (%d): %m\n",
+			buf->fb_id, errno);
+
+	drmModeAtomicFree(ModeReq);
+	return;
+
+closing:
+	PipPlaneOff(render);
+	render->act_buf = NULL;
+	CleanDisplayThread(render);
+}
+
+///
+///	Display the pip video frames.
+///
+static void *PipDisplayHandlerThread(void * arg)
+{
+	VideoRender * render = (VideoRender *)arg;
+
+	pthread_setcancelstate (PTHREAD_CANCEL_ENABLE, NULL);
+	pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
+
+	SetThreadCpus(VideoDisplayCpus);
+	SetThreadPriority(VideoDisplayPriority);
+
+	while (1) {
+		pthread_testcancel();
+
+		PipFrame2Display(render);
+
+		if (render->act_buf) {
+			if (render->lastframe) {
+				av_frame_free(&render->lastframe);
+			}
+			render->lastframe = render->act_buf->frame;
+			if (render->act_buf != &render->buf_hold && render->buf_hold.fb_id)
+				ReleaseHold(render);
+		}
+	}
+	pthread_exit((void *)pthread_self());
+}
+
+//----------------------------------------------------------------------------
+//	OSD
+//----------------------------------------------------------------------------
+
+///
+///	Convert a ARGB8888 line into ARGB4444.
+///
+///	@param dst	ARGB4444 output line
+///	@param src	ARGB8888 input line
+///	@param width	pixels in the line
+///
+static void OsdConvertARGB4444(uint16_t * dst, const uint32_t * src, int width)
+{
+	int i;
+
+	for (i = 0; i < width; ++i) {
+		uint32_t c = src[i];
+
+		dst[i] = ((c >> 16) & 0xF000) | ((c >> 12) & 0x0F00) |
+			((c >> 8) & 0x00F0) | ((c >> 4) & 0x000F);
+	}
+}
+
+///
+///	Clear the OSD.
+///
+void VideoOsdClear(VideoRender * render)
+{
+	memset((void *)render->buf_osd.plane[0], 0,
+		(size_t)(render->buf_osd.pitch[0] * render->buf_osd.height));
+
+	render->OsdShown = 0;
+}
+
+///
+///	Draw an OSD ARGB image.
+///
+///	@param xi	x-coordinate in argb image
+///	@param yi	y-coordinate in argb image
+///	@paran height	height in pixel in argb image
+///	@paran width	width in pixel in argb image
+///	@param pitch	pitch of argb image
+///	@param argb	32bit ARGB image data
+///	@param x	x-coordinate on screen of argb image
+///	@param y	y-coordinate on screen of argb image
+///
+void VideoOsdDrawARGB(VideoRender * render, __attribute__ ((unused)) int xi,
+		__attribute__ ((unused)) int yi, int width, int height, int pitch,
+		const uint8_t * argb, int x, int y)
+{
+	int i;
+
+	if (!render->use_zpos) {
+		render->buf_osd.draw_x = x;
+		render->buf_osd.draw_y = y;
+		render->buf_osd.draw_width = width;
+		render->buf_osd.draw_height = height;
+	}
+
+	if (render->buf_osd.pix_fmt == DRM_FORMAT_ARGB4444) {
+		for (i = 0; i < height; ++i) {
+			OsdConvertARGB4444((uint16_t *)(render->buf_osd.plane[0] + (x - render->buf_osd.draw_x) * 2 +
+				(i + y - render->buf_osd.draw_y) * render->buf_osd.pitch[0]),
+				(const uint32_t *)(argb + i * pitch), width);
+		}
+	} else {
+		for (i = 0; i < height; ++i) {
+			memcpy(render->buf_osd.plane[0] + (x - render->buf_osd.draw_x) * 4 + (i + y - render->buf_osd.draw_y)
+			   * render->buf_osd.pitch[0], argb + i * pitch, (size_t)pitch);
+		}
+	}
 
 	render->OsdShown = 1;
 //	fprintf(stderr, "DrmOsdDrawARGB width: %i height: %i pitch: %i x: %i y: %i xi: %i yi: %i diff_y: %i diff_x: %i\n",
@@ -1007,6 +2511,8 @@ static void *DecodeHandlerThread(void *arg)
 	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 	pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
 
+	SetThreadCpus(VideoDecodeCpus);
+
 	for (;;) {
 		pthread_testcancel();
 
@@ -1027,44 +2533,44 @@ static void *DecodeHandlerThread(void *arg)
 ///
 ///	Exit and cleanup video threads.
 ///
-void VideoThreadExit(void)
+void VideoThreadExit(VideoRender * render)
 {
 	void *retval;
 
 	Debug(3, "video: video thread canceled\n");
 
-	if (DecodeThread) {
+	if (!render)
+		return;
+
+	if (render->DecodeThread) {
 #ifdef DEBUG
 		fprintf(stderr, "VideoThreadExit: cancel decode thread\n");
 #endif
 		// FIXME: can't cancel locked
-		if (pthread_cancel(DecodeThread)) {
+		if (pthread_cancel(render->DecodeThread)) {
 			Error(_("video: can't queue cancel video display thread\n"));
 			fprintf(stderr, "VideoThreadExit: can't queue cancel video display thread\n");
 		}
-		if (pthread_join(DecodeThread, &retval) || retval != PTHREAD_CANCELED) {
+		if (pthread_join(render->DecodeThread, &retval) || retval != PTHREAD_CANCELED) {
 			Error(_("video: can't cancel video display thread\n"));
 			fprintf(stderr, "VideoThreadExit: can't cancel video display thread\n");
 		}
-		DecodeThread = 0;
-
-		pthread_cond_destroy(&PauseCondition);
-		pthread_mutex_destroy(&PauseMutex);
+		render->DecodeThread = 0;
 	}
 
-	if (DisplayThread) {
+	if (render->DisplayThread) {
 #ifdef DEBUG
 		fprintf(stderr, "VideoThreadExit: cancel display thread\n");
 #endif
-		if (pthread_cancel(DisplayThread)) {
+		if (pthread_cancel(render->DisplayThread)) {
 			Error(_("video: can't cancel DisplayHandlerThread thread\n"));
 			fprintf(stderr, "VideoThreadExit: can't cancel DisplayHandlerThread thread\n");
 		}
-		if (pthread_join(DisplayThread, &retval) || retval != PTHREAD_CANCELED) {
+		if (pthread_join(render->DisplayThread, &retval) || retval != PTHREAD_CANCELED) {
 			Error(_("video: can't cancel video display thread\n"));
 			fprintf(stderr, "VideoThreadExit: can't cancel video display thread\n");
 		}
-		DisplayThread = 0;
+		render->DisplayThread = 0;
 	}
 }
 
@@ -1078,19 +2584,15 @@ void VideoThreadWakeup(VideoRender * render)
 #ifdef DEBUG
 	fprintf(stderr, "VideoThreadWakeup: VideoThreadWakeup\n");
 #endif
-	if (!DecodeThread) {
-		pthread_cond_init(&PauseCondition,NULL);
-		pthread_mutex_init(&PauseMutex, NULL);
-
-		pthread_cond_init(&WaitCleanCondition,NULL);
-		pthread_mutex_init(&WaitCleanMutex, NULL);
-
-		pthread_create(&DecodeThread, NULL, DecodeHandlerThread, render);
-		pthread_setname_np(DecodeThread, "softhddev video");
+	if (!render->DecodeThread) {
+		pthread_create(&render->DecodeThread, NULL, DecodeHandlerThread, render);
+		pthread_setname_np(render->DecodeThread,
+			render->Main ? "softhddev pip" : "softhddev video");
 	}
 
-	if (!DisplayThread) {
-		pthread_create(&DisplayThread, NULL, DisplayHandlerThread, render);
+	if (!render->DisplayThread) {
+		pthread_create(&render->DisplayThread, NULL, render->Main ?
+			PipDisplayHandlerThread : DisplayHandlerThread, render);
 	}
 }
 
@@ -1120,6 +2622,12 @@ VideoRender *VideoNewRender(VideoStream * stream)
 	render->enqueue_buffer = 0;
 	render->VideoPaused = 0;
 
+	pthread_cond_init(&render->PauseCondition, NULL);
+	pthread_mutex_init(&render->PauseMutex, NULL);
+	pthread_cond_init(&render->WaitCleanCondition, NULL);
+	pthread_mutex_init(&render->WaitCleanMutex, NULL);
+	pthread_mutex_init(&render->GrabMutex, NULL);
+
 	return render;
 }
 
@@ -1131,11 +2639,12 @@ VideoRender *VideoNewRender(VideoStream * stream)
 void VideoDelRender(VideoRender * render)
 {
     if (render) {
-#ifdef DEBUG
-		if (!pthread_equal(pthread_self(), DecodeThread)) {
-			Debug(3, "video: should only be called from inside the thread\n");
-		}
-#endif
+		pthread_cond_destroy(&render->PauseCondition);
+		pthread_mutex_destroy(&render->PauseMutex);
+		pthread_cond_destroy(&render->WaitCleanCondition);
+		pthread_mutex_destroy(&render->WaitCleanMutex);
+		pthread_mutex_destroy(&render->GrabMutex);
+
 		free(render);
 		return;
     }
@@ -1154,6 +2663,8 @@ void VideoDelRender(VideoRender * render)
 enum AVPixelFormat Video_get_format(__attribute__ ((unused))VideoRender * render,
 		AVCodecContext * video_ctx, const enum AVPixelFormat *fmt)
 {
+	const enum AVPixelFormat *fmt_list = fmt;
+
 	while (*fmt != AV_PIX_FMT_NONE) {
 #ifdef CODEC_DEBUG
 		fprintf(stderr, "Video_get_format: PixelFormat %s ctx_fmt %s sw_pix_fmt %s Codecname: %s\n",
@@ -1169,24 +2680,223 @@ enum AVPixelFormat Video_get_format(__attribute__ ((unused))VideoRender * render
 		}
 		fmt++;
 	}
+	// fe. 10 bit software decoder, EnqueueFB or a filter converts it
 	fprintf(stderr, "Video_get_format: No pixel format found! Set default format.\n");
 
-	return avcodec_default_get_format(video_ctx, fmt);
+	return avcodec_default_get_format(video_ctx, fmt_list);
+}
+
+//----------------------------------------------------------------------------
+//	Software frames
+//----------------------------------------------------------------------------
+
+///
+///	The software decoder frames are copied into dumb buffers of a
+///	format the video plane can show. The line functions have no
+///	branches in the loops, so the compiler can vectorize them (NEON,
+///	SSE).
+///
+
+///
+///	Interleave a line of 8 bit chroma.
+///
+static void VideoLineUv8(uint8_t * restrict dst, const uint8_t * restrict u,
+	const uint8_t * restrict v, int n)
+{
+	int x;
+
+	for (x = 0; x < n; x++) {
+		dst[2 * x + 0] = u[x];
+		dst[2 * x + 1] = v[x];
+	}
+}
+
+///
+///	Convert a line of 10 bit luma to P010 or 8 bit.
+///
+static void VideoLineY10(uint8_t * restrict dst, const uint16_t * restrict src,
+	int n, uint32_t pix_fmt)
+{
+	uint16_t *restrict dst16 = (uint16_t *)dst;
+	int x;
+
+	if (pix_fmt == DRM_FORMAT_P010) {
+		for (x = 0; x < n; x++)
+			dst16[x] = src[x] << 6;
+		return;
+	}
+	for (x = 0; x < n; x++)
+		dst[x] = src[x] >> 2;
+}
+
+///
+///	Interleave a line of 10 bit chroma to P010 or 8 bit.
+///
+static void VideoLineUv10(uint8_t * restrict dst, const uint16_t * restrict u,
+	const uint16_t * restrict v, int n, uint32_t pix_fmt)
+{
+	uint16_t *restrict dst16 = (uint16_t *)dst;
+	int x;
+
+	if (pix_fmt == DRM_FORMAT_P010) {
+		for (x = 0; x < n; x++) {
+			dst16[2 * x + 0] = u[x] << 6;
+			dst16[2 * x + 1] = v[x] << 6;
+		}
+		return;
+	}
+	for (x = 0; x < n; x++) {
+		dst[2 * x + 0] = u[x] >> 2;
+		dst[2 * x + 1] = v[x] >> 2;
+	}
+}
+
+#ifdef DRM_FORMAT_NV15
+
+///
+///	Pack four 10 bit samples into five bytes.
+///
+static inline void VideoPack10(uint8_t * dst, unsigned a, unsigned b,
+	unsigned c, unsigned d)
+{
+	dst[0] = a;
+	dst[1] = a >> 8 | b << 2;
+	dst[2] = b >> 6 | c << 4;
+	dst[3] = c >> 4 | d << 6;
+	dst[4] = d >> 2;
+}
+
+///
+///	Pack a line of 10 bit luma to NV15.
+///
+static void VideoLineY15(uint8_t * restrict dst, const uint16_t * restrict src,
+	int n)
+{
+	int x;
+
+	for (x = 0; x < n / 4; x++)
+		VideoPack10(dst + 5 * x, src[4 * x], src[4 * x + 1], src[4 * x + 2],
+			src[4 * x + 3]);
+	if (n & 3)
+		VideoPack10(dst + 5 * x, src[4 * x], (n & 3) > 1 ? src[4 * x + 1] : 0,
+			(n & 3) > 2 ? src[4 * x + 2] : 0, 0);
+}
+
+///
+///	Interleave and pack a line of 10 bit chroma to NV15.
+///
+static void VideoLineUv15(uint8_t * restrict dst, const uint16_t * restrict u,
+	const uint16_t * restrict v, int n)
+{
+	int x;
+
+	for (x = 0; x < n / 2; x++)
+		VideoPack10(dst + 5 * x, u[2 * x], v[2 * x], u[2 * x + 1],
+			v[2 * x + 1]);
+	if (n & 1)
+		VideoPack10(dst + 5 * x, u[2 * x], v[2 * x], 0, 0);
+}
+
+#endif
+
+///
+///	Get the dumb buffer format of a software frame.
+///
+///	@param render	video render
+///	@param format	ffmpeg pixel format of the frame
+///
+///	@returns drm format, 0 if the frame needs a conversion filter.
+///
+static uint32_t VideoSoftFormat(const VideoRender * render, int format)
+{
+	switch (format) {
+		case AV_PIX_FMT_NV12:
+		case AV_PIX_FMT_YUV420P:
+		case AV_PIX_FMT_YUVJ420P:
+			return DRM_FORMAT_NV12;
+		case AV_PIX_FMT_YUV420P10:
+			return render->Format10;
+		default:
+			return 0;
+	}
+}
+
+///
+///	Copy a software frame into a dumb buffer.
+///
+///	@param buf	dumb buffer of VideoSoftFormat()
+///	@param frame	NV12, YUV420P or YUV420P10 frame
+///
+static void VideoSoftCopy(struct drm_buf *buf, const AVFrame * frame)
+{
+	int w = frame->width;
+	int h = frame->height;
+	int i;
+
+	for (i = 0; i < h; i++) {
+		uint8_t *dst = buf->plane[0] + i * buf->pitch[0];
+		const uint8_t *src = frame->data[0] + i * frame->linesize[0];
+
+		if (frame->format != AV_PIX_FMT_YUV420P10)
+			memcpy(dst, src, w);
+#ifdef DRM_FORMAT_NV15
+		else if (buf->pix_fmt == DRM_FORMAT_NV15)
+			VideoLineY15(dst, (const uint16_t *)src, w);
+#endif
+		else
+			VideoLineY10(dst, (const uint16_t *)src, w, buf->pix_fmt);
+	}
+	for (i = 0; i < h / 2; i++) {
+		uint8_t *dst = buf->plane[1] + i * buf->pitch[1];
+		const uint8_t *u = frame->data[1] + i * frame->linesize[1];
+		const uint8_t *v = frame->data[2] + i * frame->linesize[2];
+
+		if (frame->format == AV_PIX_FMT_NV12)
+			memcpy(dst, u, w);
+		else if (frame->format != AV_PIX_FMT_YUV420P10)
+			VideoLineUv8(dst, u, v, w / 2);
+#ifdef DRM_FORMAT_NV15
+		else if (buf->pix_fmt == DRM_FORMAT_NV15)
+			VideoLineUv15(dst, (const uint16_t *)u, (const uint16_t *)v, w / 2);
+#endif
+		else
+			VideoLineUv10(dst, (const uint16_t *)u, (const uint16_t *)v, w / 2,
+				buf->pix_fmt);
+	}
 }
 
+///
+///	Copy a software frame into a dumb buffer and queue it.
+///
+///	@param render	video render
+///	@param inframe	software frame of a VideoSoftFormat()
+///
 void EnqueueFB(VideoRender * render, AVFrame *inframe)
 {
 	struct drm_buf *buf = 0;
 	AVDRMFrameDescriptor * primedata;
 	AVFrame *frame;
-	int i;
+	uint32_t pix_fmt = VideoSoftFormat(render, inframe->format);
+
+	// let the display thread free the buffers of the old size
+	while (render->buffers && (!render->bufs[0].plane[0] ||
+		render->bufs[0].width != (uint32_t)inframe->width ||
+		render->bufs[0].height != (uint32_t)inframe->height ||
+		render->bufs[0].pix_fmt != pix_fmt)) {
+		if (render->Closing) {
+			av_frame_free(&inframe);
+			return;
+		}
+		render->ReleaseBuffers = 1;
+		usleep(10000);
+	}
 
 	if (!render->buffers) {
 		for (int i = 0; i < VIDEO_SURFACES_MAX + 2; i++) {
 			buf = &render->bufs[i];
 			buf->width = (uint32_t)inframe->width;
 			buf->height = (uint32_t)inframe->height;
-			buf->pix_fmt = DRM_FORMAT_NV12;
+			buf->pix_fmt = pix_fmt;
 
 			if (SetupFB(render, buf, NULL))
 				fprintf(stderr, "EnqueueFB: SetupFB FB %i x %i failed\n",
@@ -1200,26 +2910,20 @@ void EnqueueFB(VideoRender * render, AVFrame *inframe)
 				fprintf(stderr, "EnqueueFB: Failed to retrieve the Prime FD (%d): %m\n",
 					errno);
 		}
+		Info(_("video: software frames %s as %4.4s %dx%d\n"),
+			av_get_pix_fmt_name(inframe->format), (char *)&pix_fmt,
+			inframe->width, inframe->height);
 	}
 
 	buf = &render->bufs[render->enqueue_buffer];
+	VideoSoftCopy(buf, inframe);
 
-	for (i = 0; i < inframe->height; ++i) {
-		memcpy(buf->plane[0] + i * inframe->width,
-			inframe->data[0] + i * inframe->linesize[0], inframe->width);
-	}
-	for (i = 0; i < inframe->height / 2; ++i) {
-		memcpy(buf->plane[1] + i * inframe->width,
-			inframe->data[1] + i * inframe->linesize[1], inframe->width);
-	}
-
+	// keeps pts, aspect, colorimetry and hdr side data
 	frame = av_frame_alloc();
-	frame->pts = inframe->pts;
+	av_frame_copy_props(frame, inframe);
 	frame->width = inframe->width;
 	frame->height = inframe->height;
 	frame->format = AV_PIX_FMT_DRM_PRIME;
-	frame->sample_aspect_ratio.num = inframe->sample_aspect_ratio.num;
-	frame->sample_aspect_ratio.den = inframe->sample_aspect_ratio.den;
 
 	primedata = av_mallocz(sizeof(AVDRMFrameDescriptor));
 	primedata->objects[0].fd = buf->fd_prime;
@@ -1238,6 +2942,378 @@ void EnqueueFB(VideoRender * render, AVFrame *inframe)
 	else render->enqueue_buffer++;
 }
 
+//----------------------------------------------------------------------------
+//	Deinterlacer
+//----------------------------------------------------------------------------
+
+///
+///	Software deinterlacer tiers, from the best to the cheapest.
+///
+///	The cost of each tier is measured once at start for SD and HD. A
+///	stream gets the best tier, which fits into the cpu budget, and steps
+///	down a tier, if the filter can't keep up with the stream.
+///
+static const struct
+{
+    const char *Name;			///< name for the log
+    const char *Filter;			///< filter graph description
+} VideoDeintTiers[VIDEO_DEINT_TIERS] = {
+	{ "bwdif", "bwdif=1:-1:0" },
+	{ "yadif", "yadif=1:-1:0" },
+	{ "yadif frame rate", "yadif=0:-1:0" },
+	{ "bob", "separatefields" },	// half height, the plane scales it
+	{ "weave", "null" },
+};
+
+static int VideoDeintAvail[VIDEO_DEINT_TIERS];	///< filter of the tier is available
+static int VideoDeintCost[VIDEO_DEINT_TIERS][2];	///< us per SD and HD frame (0 = unknown)
+
+///
+///	Bind the calling thread to the filter cpus.
+///
+///	Threads created by the calling thread inherit the affinity, so the
+///	slice threads of a graph configured here run on the same cpus.
+///
+///	@param saved[out]	affinity before, NULL if not needed
+///
+///	@retval 0	affinity changed
+///	@retval -1	no filter cpus configured or failed
+///
+static int VideoFilterAffinity(cpu_set_t * saved)
+{
+	if (!VideoFilterCpus)
+		return -1;
+	if (saved && pthread_getaffinity_np(pthread_self(), sizeof(*saved), saved))
+		return -1;
+
+	return SetThreadCpus(VideoFilterCpus);
+}
+
+///
+///	Create a filter graph.
+///
+///	@param graph[out]	filter graph
+///	@param src[out]		buffer source of the graph
+///	@param sink[out]	buffer sink of the graph
+///	@param descr		filter graph description
+///	@param frame		first input frame
+///	@param time_base	time base of the input frames
+///
+///	@retval 0	graph configured
+///	@retval -1	graph failed, nothing allocated
+///
+static int VideoFilterGraph(AVFilterGraph ** graph, AVFilterContext ** src,
+    AVFilterContext ** sink, const char *descr, const AVFrame * frame,
+    AVRational time_base)
+{
+	char args[512];
+	const AVFilter *buffersrc  = avfilter_get_by_name("buffer");
+	const AVFilter *buffersink = avfilter_get_by_name("buffersink");
+	AVFilterInOut *outputs = avfilter_inout_alloc();
+	AVFilterInOut *inputs  = avfilter_inout_alloc();
+	AVBufferSrcParameters *par;
+	cpu_set_t saved;
+	int restore;
+	int ret;
+
+	*graph = avfilter_graph_alloc();
+	// slice threads, must be set before any filter is added
+	(*graph)->thread_type = AVFILTER_THREAD_SLICE;
+	(*graph)->nb_threads = VideoFilterThreads;
+
+	snprintf(args, sizeof(args),
+		"video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
+		frame->width, frame->height, frame->format,
+		time_base.num, time_base.den,
+		frame->sample_aspect_ratio.num, frame->sample_aspect_ratio.den);
+
+	if (avfilter_graph_create_filter(src, buffersrc, "src",
+		args, NULL, *graph) < 0) {
+		fprintf(stderr, "VideoFilterGraph: Cannot create buffer source\n");
+		goto fail;
+	}
+
+	par = av_buffersrc_parameters_alloc();
+	par->format = AV_PIX_FMT_NONE;
+	par->hw_frames_ctx = frame->hw_frames_ctx;
+	if (av_buffersrc_parameters_set(*src, par) < 0)
+		fprintf(stderr, "VideoFilterGraph: Cannot av_buffersrc_parameters_set\n");
+	av_free(par);
+
+	if (avfilter_graph_create_filter(sink, buffersink, "out",
+		NULL, NULL, *graph) < 0) {
+		fprintf(stderr, "VideoFilterGraph: Cannot create buffer sink\n");
+		goto fail;
+	}
+
+	// the formats EnqueueFB copies, the negotiation picks the closest
+	if (frame->format != AV_PIX_FMT_DRM_PRIME) {
+		enum AVPixelFormat pix_fmts[] = { AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P,
+			AV_PIX_FMT_YUV420P10, AV_PIX_FMT_NONE };
+		if (av_opt_set_int_list(*sink, "pix_fmts", pix_fmts,
+				AV_PIX_FMT_NONE, AV_OPT_SEARCH_CHILDREN) < 0) {
+			fprintf(stderr, "VideoFilterGraph: Cannot set output pixel format\n");
+			goto fail;
+		}
+	}
+
+	outputs->name       = av_strdup("in");
+	outputs->filter_ctx = *src;
+	outputs->pad_idx    = 0;
+	outputs->next       = NULL;
+
+	inputs->name       = av_strdup("out");
+	inputs->filter_ctx = *sink;
+	inputs->pad_idx    = 0;
+	inputs->next       = NULL;
+
+	if ((avfilter_graph_parse_ptr(*graph, descr,
+		&inputs, &outputs, NULL)) < 0) {
+
+		fprintf(stderr, "VideoFilterGraph: avfilter_graph_parse_ptr %s failed\n",
+			descr);
+		goto fail;
+	}
+
+	// the slice threads are created by the config
+	restore = !VideoFilterAffinity(&saved);
+	ret = avfilter_graph_config(*graph, NULL);
+	if (restore)
+		pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+	if (ret < 0) {
+		fprintf(stderr, "VideoFilterGraph: avfilter_graph_config %s failed\n",
+			descr);
+		goto fail;
+	}
+
+	avfilter_inout_free(&inputs);
+	avfilter_inout_free(&outputs);
+
+	return 0;
+
+fail:
+	avfilter_inout_free(&inputs);
+	avfilter_inout_free(&outputs);
+	avfilter_graph_free(graph);
+
+	return -1;
+}
+
+///
+///	Probe which software deinterlacers the ffmpeg build has.
+///
+static void VideoDeintProbe(void)
+{
+	int tier;
+
+#if LIBAVFILTER_VERSION_INT < AV_VERSION_INT(7,16,100)
+	avfilter_register_all();
+#endif
+
+	for (tier = 0; tier < VIDEO_DEINT_TIERS; tier++) {
+		char name[32];
+		size_t len = strcspn(VideoDeintTiers[tier].Filter, "=");
+
+		if (len >= sizeof(name))
+			len = sizeof(name) - 1;
+		memcpy(name, VideoDeintTiers[tier].Filter, len);
+		name[len] = '\0';
+
+		VideoDeintAvail[tier] = avfilter_get_by_name(name) != NULL;
+		if (!VideoDeintAvail[tier])
+			Info(_("video: deinterlacer %s not available\n"),
+				VideoDeintTiers[tier].Name);
+	}
+}
+
+///
+///	Measure the cost of the software deinterlacers.
+///
+///	Runs once in the background at start. Some gray frames of SD and HD
+///	size are sent through each available tier.
+///
+static void *VideoDeintBenchThread(__attribute__ ((unused)) void *arg)
+{
+	static const int sizes[2][2] = { { 720, 576 }, { 1920, 1080 } };
+	int tier;
+	int hd;
+
+	for (hd = 0; hd < 2; hd++) {
+		for (tier = 0; tier < VIDEO_DEINT_TIERS; tier++) {
+			AVFilterGraph *graph;
+			AVFilterContext *src;
+			AVFilterContext *sink;
+			AVFrame *frame;
+			AVFrame *out;
+			uint64_t start;
+			int frames;
+			int i;
+
+			if (!VideoDeintAvail[tier])
+				continue;
+
+			frame = av_frame_alloc();
+			out = av_frame_alloc();
+			frame->width = sizes[hd][0];
+			frame->height = sizes[hd][1];
+			frame->format = AV_PIX_FMT_YUV420P;
+			frame->interlaced_frame = 1;
+			frame->top_field_first = 1;
+			if (av_frame_get_buffer(frame, 0) < 0 ||
+				VideoFilterGraph(&graph, &src, &sink,
+				VideoDeintTiers[tier].Filter, frame, av_make_q(1, 25))) {
+				av_frame_free(&frame);
+				av_frame_free(&out);
+				continue;
+			}
+			memset(frame->data[0], 0x80, frame->linesize[0] * frame->height);
+			memset(frame->data[1], 0x80, frame->linesize[1] * frame->height / 2);
+			memset(frame->data[2], 0x80, frame->linesize[2] * frame->height / 2);
+
+			start = GetUsTicks();
+			for (frames = 0; frames < VIDEO_DEINT_BENCH_FRAMES; frames++) {
+				frame->pts = frames;
+				if (av_buffersrc_add_frame_flags(src, frame,
+					AV_BUFFERSRC_FLAG_KEEP_REF) < 0)
+					break;
+				while (av_buffersink_get_frame(sink, out) >= 0)
+					av_frame_unref(out);
+			}
+			i = frames ? (GetUsTicks() - start) / frames : 0;
+			VideoDeintCost[tier][hd] = i > 0 ? i : 1;
+
+			Info(_("video: deinterlacer %s %dx%d %d us/frame\n"),
+				VideoDeintTiers[tier].Name, frame->width, frame->height, i);
+
+			avfilter_graph_free(&graph);
+			av_frame_free(&frame);
+			av_frame_free(&out);
+			// leave the cpu to the start of the first stream
+			usleep(VIDEO_DEINT_BENCH_PAUSE * 1000);
+		}
+	}
+	return NULL;
+}
+
+///
+///	Select the software deinterlacer of a stream.
+///
+///	@param height	picture height
+///	@param period	us per input frame
+///
+///	@returns the best available tier up to the configured one, which
+///	fits into the cpu budget. Tiers not yet measured are taken.
+///
+static int VideoDeintSelect(int height, int period)
+{
+	int budget = period * VIDEO_DEINT_LOAD / 100;
+	int tier;
+
+	for (tier = VideoDeinterlacer; tier < VIDEO_DEINT_TIERS - 1; tier++) {
+		if (VideoDeintAvail[tier] &&
+			VideoDeintCost[tier][height > 576] <= budget)
+			return tier;
+	}
+	return VIDEO_DEINT_TIERS - 1;
+}
+
+///
+///	Open the filter graph of the render.
+///
+///	A software deinterlacer, which fails to configure, is replaced by
+///	the next tier.
+///
+///	@param render	video render
+///	@param frame	first input frame
+///
+///	@retval 0	filter opened
+///	@retval -1	no filter
+///
+static int VideoFilterOpen(VideoRender * render, const AVFrame * frame)
+{
+	const char *filter_descr;
+
+	render->FilterHeight = frame->height;
+
+	for (;;) {
+		if (frame->format == AV_PIX_FMT_DRM_PRIME)
+			filter_descr = "deinterlace_v4l2m2m";
+		else if (render->DeintTier >= 0)
+			filter_descr = VideoDeintTiers[render->DeintTier].Filter;
+		else
+			filter_descr = "scale";
+#ifdef DEBUG
+		fprintf(stderr, "VideoFilterOpen: filter %s\n", filter_descr);
+#endif
+		if (!VideoFilterGraph(&render->filter_graph, &render->buffersrc_ctx,
+			&render->buffersink_ctx, filter_descr, frame,
+			render->FilterTimeBase)) {
+			char chain[256];
+			size_t len = 0;
+			unsigned i;
+
+			// the graph has the filters the format negotiation added
+			chain[0] = '\0';
+			for (i = 0; i < render->filter_graph->nb_filters &&
+				len < sizeof(chain); i++) {
+				len += snprintf(chain + len, sizeof(chain) - len, "%s%s",
+					i ? " " : "",
+					render->filter_graph->filters[i]->filter->name);
+			}
+			render->FilterName = render->DeintTier >= 0 ?
+				VideoDeintTiers[render->DeintTier].Name : filter_descr;
+			render->FilterThreads = render->filter_graph->nb_threads;
+			render->FilterAvg = 0;
+			Info(_("video: filter %s, %d threads\n"), chain,
+				render->FilterThreads);
+			return 0;
+		}
+
+		if (render->DeintTier < 0 || render->DeintTier >= VIDEO_DEINT_TIERS - 1)
+			break;
+		render->DeintTier++;
+	}
+	return -1;
+}
+
+///
+///	Check the time the filter needs.
+///
+///	The average is kept for the statistics. A software deinterlacer
+///	steps down a tier, if it takes more than its share of the frame
+///	period or frames get dropped while it is over budget. The graph is
+///	rebuilt with the next input frame.
+///
+///	@param render	video render
+///
+static void VideoFilterCheck(VideoRender * render)
+{
+	int avg;
+	int dropped;
+
+	if (++render->DeintFrames < VIDEO_DEINT_CHECK)
+		return;
+
+	avg = render->DeintTime / render->DeintFrames;
+	dropped = render->FramesDropped - render->DeintDropped;
+	render->FilterAvg = avg;
+
+	if (render->DeintTier >= 0 && render->DeintTier < VIDEO_DEINT_TIERS - 1 &&
+		(avg > render->DeintPeriod * VIDEO_DEINT_OVERLOAD / 100 ||
+		(dropped > VIDEO_DEINT_CHECK / 10 &&
+		avg > render->DeintPeriod * VIDEO_DEINT_LOAD / 100))) {
+
+		Info(_("video: deinterlacer %s needs %d of %d us, %d dropped, step down\n"),
+			VideoDeintTiers[render->DeintTier].Name, avg,
+			render->DeintPeriod, dropped);
+		render->DeintTier++;
+		render->DeintSwitch = 1;
+	}
+	render->DeintTime = 0;
+	render->DeintFrames = 0;
+	render->DeintDropped = render->FramesDropped;
+}
+
 /**
 **	Filter thread.
 */
@@ -1245,8 +3321,11 @@ static void *FilterHandlerThread(void * arg)
 {
 	VideoRender * render = (VideoRender *)arg;
 	AVFrame *frame = 0;
+	uint64_t tick;
 	int ret = 0;
 
+	VideoFilterAffinity(NULL);
+
 	while (1) {
 		while (!atomic_read(&render->FramesDeintFilled) && !render->Filter_Close) {
 			usleep(10000);
@@ -1274,17 +3353,35 @@ getinframe:
 			frame = NULL;
 		}
 
+		// the frames still in the old graph are lost, like on a seek
+		if (render->DeintSwitch && frame) {
+			render->DeintSwitch = 0;
+			avfilter_graph_free(&render->filter_graph);
+			if (VideoFilterOpen(render, frame))
+				render->DeintSwitch = 1;
+		}
+		if (!render->filter_graph) {
+			av_frame_free(&frame);
+			if (render->Filter_Close)
+				goto closing;
+			continue;
+		}
+
+		tick = GetUsTicks();
 		if (av_buffersrc_add_frame_flags(render->buffersrc_ctx,
 			frame, AV_BUFFERSRC_FLAG_KEEP_REF) < 0) {
 			fprintf(stderr, "FilterHandlerThread: can't add_frame.\n");
 		} else {
 			av_frame_free(&frame);
 		}
+		render->DeintTime += GetUsTicks() - tick;
 
 		while (1) {
 			AVFrame *filt_frame = av_frame_alloc();
 getoutframe:
+			tick = GetUsTicks();
 			ret = av_buffersink_get_frame(render->buffersink_ctx, filt_frame);
+			render->DeintTime += GetUsTicks() - tick;
 
 			if (ret == AVERROR(EAGAIN)) {
 				av_frame_free(&filt_frame);
@@ -1314,8 +3411,23 @@ fillframe:
 				break;
 			}
 			if (atomic_read(&render->FramesFilled) < VIDEO_SURFACES_MAX) {
-				if (filt_frame->format == AV_PIX_FMT_NV12) {
-					filt_frame->pts = filt_frame->pts / 2;	// ffmpeg bug
+				// field rate output has a finer time base
+				AVRational tb = av_buffersink_get_time_base(render->buffersink_ctx);
+
+				if (filt_frame->pts != AV_NOPTS_VALUE && tb.num > 0 &&
+					render->FilterTimeBase.num > 0)
+					filt_frame->pts = av_rescale_q(filt_frame->pts, tb,
+						render->FilterTimeBase);
+				// single fields keep the picture aspect
+				if (filt_frame->height != render->FilterHeight) {
+					AVRational sar = filt_frame->sample_aspect_ratio;
+
+					if (!sar.num || !sar.den)
+						sar = av_make_q(1, 1);
+					filt_frame->sample_aspect_ratio = av_mul_q(sar,
+						av_make_q(filt_frame->height, render->FilterHeight));
+				}
+				if (filt_frame->format != AV_PIX_FMT_DRM_PRIME) {
 					EnqueueFB(render, filt_frame);
 				} else {
 					render->FramesRb[render->FramesWrite] = filt_frame;
@@ -1327,6 +3439,7 @@ fillframe:
 				goto fillframe;
 			}
 		}
+		VideoFilterCheck(render);
 	}
 closing:
 	avfilter_graph_free(&render->filter_graph);
@@ -1348,101 +3461,172 @@ closing:
 int VideoFilterInit(VideoRender * render, const AVCodecContext * video_ctx,
 		AVFrame * frame)
 {
-	char args[512];
-	const char *filter_descr = NULL;
-	const AVFilter *buffersrc  = avfilter_get_by_name("buffer");
-	const AVFilter *buffersink = avfilter_get_by_name("buffersink");
-	AVFilterInOut *outputs = avfilter_inout_alloc();
-	AVFilterInOut *inputs  = avfilter_inout_alloc();
-	render->filter_graph = avfilter_graph_alloc();
-
-	if (frame->interlaced_frame) {
-		if (frame->format == AV_PIX_FMT_DRM_PRIME)
-			filter_descr = "deinterlace_v4l2m2m";
-		else if (frame->format == AV_PIX_FMT_YUV420P)
-			filter_descr = "bwdif=1:-1:0";
-	} else if (frame->format == AV_PIX_FMT_YUV420P)
-		filter_descr = "scale";
+	render->FilterTimeBase = video_ctx->time_base;
+	render->DeintTier = -1;
+	render->DeintSwitch = 0;
+	render->DeintTime = 0;
+	render->DeintFrames = 0;
+	render->DeintDropped = render->FramesDropped;
+	render->DeintPeriod = video_ctx->framerate.num > 0 &&
+		video_ctx->framerate.den > 0 ?
+		av_rescale(1000000, video_ctx->framerate.den,
+		video_ctx->framerate.num) : 40000;
+
+	if (frame->interlaced_frame && frame->format != AV_PIX_FMT_DRM_PRIME)
+		render->DeintTier = VideoDeintSelect(frame->height,
+			render->DeintPeriod);
+
+	if (VideoFilterOpen(render, frame)) {
+		if (frame->format == AV_PIX_FMT_DRM_PRIME && !render->NoHwDeint) {
 #ifdef DEBUG
-	fprintf(stderr, "VideoFilterInit: filter %s\n",
-		filter_descr);
-#endif
-
-#if LIBAVFILTER_VERSION_INT < AV_VERSION_INT(7,16,100)
-	avfilter_register_all();
+			fprintf(stderr, "VideoFilterInit: can't config HW Deinterlacer!\n");
 #endif
+			render->NoHwDeint = 1;
+		}
+		return -1;
+	}
 
-	snprintf(args, sizeof(args),
-		"video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
-		video_ctx->width, video_ctx->height, frame->format,
-		video_ctx->time_base.num, video_ctx->time_base.den,
-		video_ctx->sample_aspect_ratio.num, video_ctx->sample_aspect_ratio.den);
+	if (render->DeintTier >= 0)
+		Info(_("video: deinterlacer %s for %dx%d, %d of %d us\n"),
+			VideoDeintTiers[render->DeintTier].Name, frame->width,
+			frame->height,
+			VideoDeintCost[render->DeintTier][frame->height > 576],
+			render->DeintPeriod);
 
-	if (avfilter_graph_create_filter(&render->buffersrc_ctx, buffersrc, "src",
-		args, NULL, render->filter_graph) < 0)
-			fprintf(stderr, "VideoFilterInit: Cannot create buffer source\n");
+	return 0;
+}
 
-	AVBufferSrcParameters *par = av_buffersrc_parameters_alloc();
-	par->format = AV_PIX_FMT_NONE;
-	par->hw_frames_ctx = frame->hw_frames_ctx;
-	if (av_buffersrc_parameters_set(render->buffersrc_ctx, par) < 0)
-		fprintf(stderr, "VideoFilterInit: Cannot av_buffersrc_parameters_set\n");
-	av_free(par);
+///
+///	Queue a frame for the display thread.
+///
+///	@param render	video render
+///	@param video_ctx	ffmpeg video codec context
+///	@param frame		frame to display
+///
+static void VideoQueueFrame(VideoRender * render,
+    AVCodecContext * video_ctx, AVFrame * frame)
+{
+	// software frames without a dumb buffer format are converted
+	if ((frame->format != AV_PIX_FMT_DRM_PRIME &&
+		(frame->interlaced_frame || !VideoSoftFormat(render, frame->format))) ||
+		(frame->interlaced_frame && frame->format == AV_PIX_FMT_DRM_PRIME &&
+		!render->NoHwDeint)) {
 
-	if (avfilter_graph_create_filter(&render->buffersink_ctx, buffersink, "out",
-		NULL, NULL, render->filter_graph) < 0)
-			fprintf(stderr, "VideoFilterInit: Cannot create buffer sink\n");
+		if (!render->FilterThread) {
+			if (VideoFilterInit(render, video_ctx, frame)) {
+				av_frame_free(&frame);
+				return;
+			} else {
+				pthread_create(&render->FilterThread, NULL, FilterHandlerThread, render);
+				pthread_setname_np(render->FilterThread, "softhddev deint");
+			}
+		}
 
-	if (frame->format != AV_PIX_FMT_DRM_PRIME) {
-		enum AVPixelFormat pix_fmts[] = { AV_PIX_FMT_NV12, AV_PIX_FMT_NONE };
-		if (av_opt_set_int_list(render->buffersink_ctx, "pix_fmts", pix_fmts,
-				AV_PIX_FMT_NONE, AV_OPT_SEARCH_CHILDREN) < 0) {
-			fprintf(stderr, "VideoFilterInit: Cannot set output pixel format\n");
-			goto fail;
+		render->FramesDeintRb[render->FramesDeintWrite] = frame;
+		render->FramesDeintWrite = (render->FramesDeintWrite + 1) % VIDEO_SURFACES_MAX;
+		atomic_inc(&render->FramesDeintFilled);
+	} else {
+		if (frame->format == AV_PIX_FMT_DRM_PRIME) {
+			render->FramesRb[render->FramesWrite] = frame;
+			render->FramesWrite = (render->FramesWrite + 1) % VIDEO_SURFACES_MAX;
+			atomic_inc(&render->FramesFilled);
+		} else {
+			EnqueueFB(render, frame);
 		}
 	}
+}
 
-	outputs->name       = av_strdup("in");
-	outputs->filter_ctx = render->buffersrc_ctx;
-	outputs->pad_idx    = 0;
-	outputs->next       = NULL;
+//----------------------------------------------------------------------------
+//	Reverse
+//----------------------------------------------------------------------------
 
-	inputs->name       = av_strdup("out");
-	inputs->filter_ctx = render->buffersink_ctx;
-	inputs->pad_idx    = 0;
-	inputs->next       = NULL;
+///
+///	Free the frames of the reverse buffer.
+///
+static void VideoReverseClear(VideoRender * render)
+{
+	while (render->ReverseFilled) {
+		av_frame_free(&render->ReverseRb[render->ReverseFirst]);
+		render->ReverseFirst = (render->ReverseFirst + 1) % VIDEO_REVERSE_MAX;
+		render->ReverseFilled--;
+	}
+	render->ReverseFirst = 0;
+}
 
-	if ((avfilter_graph_parse_ptr(render->filter_graph, filter_descr,
-		&inputs, &outputs, NULL)) < 0) {
+///
+///	Put a decoded frame of a reverse gop into the reverse buffer.
+///
+///	If the buffer is full (see VideoReverseLimit), the oldest frame is
+///	dropped, the newest frames are shown first.
+///
+///	@param render	video render
+///	@param video_ctx	ffmpeg video codec context
+///	@param frame		decoded frame
+///
+static void VideoReversePush(VideoRender * render,
+    AVCodecContext * video_ctx, AVFrame * frame)
+{
+	int max;
 
-		fprintf(stderr, "VideoFilterInit: avfilter_graph_parse_ptr failed\n");
-		goto fail;
+	max = VideoReverseLimit(frame);
+	while (render->ReverseFilled >= max) {
+		av_frame_free(&render->ReverseRb[render->ReverseFirst]);
+		render->ReverseFirst = (render->ReverseFirst + 1) % VIDEO_REVERSE_MAX;
+		render->ReverseFilled--;
+		render->FramesDropped++;
 	}
 
-	if ((avfilter_graph_config(render->filter_graph, NULL)) < 0) {
-		fprintf(stderr, "VideoFilterInit: avfilter_graph_config failed\n");
-		goto fail;
-	}
+	// the deinterlacer can't handle fields in reverse order
+	frame->interlaced_frame = 0;
 
-	avfilter_inout_free(&inputs);
-	avfilter_inout_free(&outputs);
+	render->ReverseRb[(render->ReverseFirst + render->ReverseFilled) %
+		VIDEO_REVERSE_MAX] = frame;
+	render->ReverseFilled++;
+	render->ReverseCtx = video_ctx;
+}
 
-	return 0;
+///
+///	Queue the newest frame of the reverse buffer.
+///
+///	Called by the decoder instead of decoding the next gop.
+///
+///	@param render	video render
+///
+///	@returns 1 if a buffered frame was used, 0 if the buffer is empty.
+///
+int VideoReverseOutput(VideoRender * render)
+{
+	AVFrame *frame;
+	int i;
 
-fail:
-	avfilter_inout_free(&inputs);
-	avfilter_inout_free(&outputs);
+	if (!render->ReverseFilled)
+		return 0;
 
-	if (!render->NoHwDeint) {
-#ifdef DEBUG
-		fprintf(stderr, "VideoFilterInit: can't config HW Deinterlacer!\n");
-#endif
-		render->NoHwDeint = 1;
-	}
+	render->ReverseFilled--;
+	i = (render->ReverseFirst + render->ReverseFilled) % VIDEO_REVERSE_MAX;
+	frame = render->ReverseRb[i];
+	render->ReverseRb[i] = NULL;
 
-	avfilter_graph_free(&render->filter_graph);
+	if (render->Closing) {
+		av_frame_free(&frame);
+		return 1;
+	}
+	VideoQueueFrame(render, render->ReverseCtx, frame);
+	return 1;
+}
 
-	return -1;
+///
+///	Set reverse playback.
+///
+///	Must be called from the decoder thread.
+///
+///	@param render	video render
+///	@param on	1 = buffer the decoded frames of a gop
+///
+void VideoSetReverse(VideoRender * render, int on)
+{
+	VideoReverseClear(render);
+	render->Reverse = on;
 }
 
 ///
@@ -1457,6 +3641,13 @@ void VideoRenderFrame(VideoRender * render,
 {
 	if (!render->StartCounter) {
 		render->timebase = &video_ctx->pkt_timebase;
+		// the deinterlacer outputs a frame per field
+		render->StreamRate = video_ctx->framerate.num > 0 &&
+			video_ctx->framerate.den > 0 ?
+			av_rescale(1000, video_ctx->framerate.num,
+			video_ctx->framerate.den) << !!frame->interlaced_frame : 0;
+		render->StreamWidth = frame->width;
+		render->StreamHeight = frame->height;
 	}
 
 	if (frame->decode_error_flags || frame->flags & AV_FRAME_FLAG_CORRUPT) {
@@ -1465,34 +3656,14 @@ void VideoRenderFrame(VideoRender * render,
 
 	if (render->Closing) {
 		av_frame_free(&frame);
-		return;
-	}
-
-	if (frame->format == AV_PIX_FMT_YUV420P || (frame->interlaced_frame &&
-		frame->format == AV_PIX_FMT_DRM_PRIME && !render->NoHwDeint)) {
-
-		if (!FilterThread) {
-			if (VideoFilterInit(render, video_ctx, frame)) {
-				av_frame_free(&frame);
-				return;
-			} else {
-				pthread_create(&FilterThread, NULL, FilterHandlerThread, render);
-				pthread_setname_np(FilterThread, "softhddev deint");
-			}
-		}
-
-		render->FramesDeintRb[render->FramesDeintWrite] = frame;
-		render->FramesDeintWrite = (render->FramesDeintWrite + 1) % VIDEO_SURFACES_MAX;
-		atomic_inc(&render->FramesDeintFilled);
-	} else {
-		if (frame->format == AV_PIX_FMT_DRM_PRIME) {
-			render->FramesRb[render->FramesWrite] = frame;
-			render->FramesWrite = (render->FramesWrite + 1) % VIDEO_SURFACES_MAX;
-			atomic_inc(&render->FramesFilled);
-		} else {
-			EnqueueFB(render, frame);
-		}
+		return;
+	}
+
+	if (render->Reverse) {
+		VideoReversePush(render, video_ctx, frame);
+		return;
 	}
+	VideoQueueFrame(render, video_ctx, frame);
 }
 
 ///
@@ -1508,6 +3679,16 @@ int64_t VideoGetClock(const VideoRender * render)
 	return render->pts;
 }
 
+///
+///	Get the video stream of a render.
+///
+///	@param render	video render
+///
+VideoStream *VideoGetStream(const VideoRender * render)
+{
+	return render->Stream;
+}
+
 ///
 ///	send start condition to video thread.
 ///
@@ -1521,7 +3702,7 @@ void StartVideo(VideoRender * render)
 	fprintf(stderr, "StartVideo: reset PauseCondition StartCounter %d Closing %d TrickSpeed %d\n",
 		render->StartCounter, render->Closing, render->TrickSpeed);
 #endif
-	pthread_cond_signal(&PauseCondition);
+	pthread_cond_signal(&render->PauseCondition);
 }
 
 ///
@@ -1539,7 +3720,7 @@ void VideoSetClosing(VideoRender * render)
 	if (render->buffers){
 		render->Closing = 1;
 
-		if (FilterThread)
+		if (render->FilterThread)
 			render->Filter_Close = 1;
 
 		if (render->VideoPaused) {
@@ -1547,19 +3728,36 @@ void VideoSetClosing(VideoRender * render)
 		}
 
 
-		pthread_mutex_lock(&WaitCleanMutex);
+		pthread_mutex_lock(&render->WaitCleanMutex);
 #ifdef DEBUG
 		fprintf(stderr, "VideoSetClosing: pthread_cond_wait\n");
 #endif
-		pthread_cond_wait(&WaitCleanCondition, &WaitCleanMutex);
-		pthread_mutex_unlock(&WaitCleanMutex);
+		pthread_cond_wait(&render->WaitCleanCondition, &render->WaitCleanMutex);
+		pthread_mutex_unlock(&render->WaitCleanMutex);
 #ifdef DEBUG
 		fprintf(stderr, "VideoSetClosing: NACH pthread_cond_wait\n");
 #endif
 	}
 	render->StartCounter = 0;
+	render->EarlyFrame = 0;
 	render->FramesDuped = 0;
 	render->FramesDropped = 0;
+
+	render->ZapFirstFrame = 0;
+	render->ZapSync = 0;
+	render->ZapStartTick = GetMsTicks();
+}
+
+///
+///	Set seek flag for the next closing.
+///
+///	@param render	video render
+///	@param on	1 = hold the last frame and show the first frame at
+///			the seek target before a/v sync
+///
+void VideoSetSeek(VideoRender * render, int on)
+{
+	render->Seek = on;
 }
 
 /**
@@ -1573,6 +3771,27 @@ void VideoPause(VideoRender * render)
 	render->VideoPaused = 1;
 }
 
+///
+///	Wait for the frame of a still picture.
+///
+///	@param render	video render
+///	@param on	1 = the next shown frame is the still picture
+///
+void VideoSetStill(VideoRender * render, int on)
+{
+	render->StillPending = on;
+}
+
+///
+///	Check if the frame of a still picture isn't shown yet.
+///
+///	@param render	video render
+///
+int VideoIsStillPending(const VideoRender * render)
+{
+	return render->StillPending;
+}
+
 ///
 ///	Set trick play speed.
 ///
@@ -1585,6 +3804,7 @@ void VideoSetTrickSpeed(VideoRender * render, int speed)
 	fprintf(stderr, "VideoSetTrickSpeed: set trick speed %d\n", speed);
 #endif
 	render->TrickSpeed = speed;
+	render->TrickTick = 0;
 	if (speed) {
 		render->Closing = 0;	// ???
 	}
@@ -1610,55 +3830,183 @@ void VideoPlay(VideoRender * render)
 }
 
 ///
-///	Grab full screen image.
+///	Get render statistics.
 ///
-///	@param size[out]	size of allocated image
-///	@param width[in,out]	width of image
-///	@param height[in,out]	height of image
+///	@param hw_render	video hardware render
+///	@param[out] duped	duped frames
+///	@param[out] dropped	dropped frames
+///	@param[out] count	number of decoded frames
 ///
-uint8_t *VideoGrab(int *size, int *width, int *height, int write_header)
+void VideoGetStats(VideoRender * render, int *duped,
+    int *dropped, int *counter)
+{
+    *duped = render->FramesDuped;
+    *dropped = render->FramesDropped;
+    *counter = render->StartCounter;
+}
+
+///
+///	Get the time of the last channel switch.
+///
+///	@param render		video render
+///	@param[out] first_frame	ms until the first frame was shown
+///	@param[out] sync	ms until audio and video were in sync
+///
+void VideoGetZapTime(VideoRender * render, int *first_frame, int *sync)
 {
-    Debug(3, "video: no grab service\n");
+    *first_frame = render->ZapFirstFrame;
+    *sync = render->ZapSync;
+}
 
-    (void)write_header;
-    (void)size;
-    (void)width;
-    (void)height;
-    return NULL;
+///
+///	Get the statistics of the filter.
+///
+///	@param render		video render
+///	@param[out] name	filter of the stream, NULL without filter
+///	@param[out] threads	slice threads of the filter
+///	@param[out] us		average us per input frame
+///	@param[out] load	% of the frame period the filter needs
+///
+void VideoGetFilterStats(VideoRender * render, const char **name,
+    int *threads, int *us, int *load)
+{
+    *name = render->FilterThread ? render->FilterName : NULL;
+    *threads = render->FilterThreads;
+    *us = render->FilterAvg;
+    *load = render->DeintPeriod > 0 ?
+	render->FilterAvg * 100 / render->DeintPeriod : 0;
 }
 
 ///
-///	Grab image service.
+///	Setup a pip render.
 ///
-///	@param size[out]	size of allocated image
-///	@param width[in,out]	width of image
-///	@param height[in,out]	height of image
+///	The pip render shares the drm device, crtc and mode with the main
+///	render and shows its frames on a free overlay plane.
 ///
-uint8_t *VideoGrabService(int *size, int *width, int *height)
+///	@param render		pip video render
+///	@param main_render	main video render
+///
+///	@retval 0	pip render ready
+///	@retval -1	no free plane for the pip
+///
+int VideoPipInit(VideoRender * render, VideoRender * main_render)
 {
-    Debug(3, "video: no grab service\n");
-	Warning(_("softhddev: grab unsupported\n"));
+	drmModeRes *resources;
+	drmModePlaneRes *plane_res;
+	drmModePlane *plane;
+	int crtc_index = -1;
+	uint32_t j;
+	int i;
+
+	render->Main = main_render;
+	render->fd_drm = main_render->fd_drm;
+	render->crtc_id = main_render->crtc_id;
+	render->connector_id = main_render->connector_id;
+	memcpy(&render->mode, &main_render->mode, sizeof(drmModeModeInfo));
+	render->CodecMode = main_render->CodecMode;
+	render->NoHwDeint = main_render->NoHwDeint;
+	render->video_plane = 0;
+
+	if ((resources = drmModeGetResources(render->fd_drm)) == NULL) {
+		fprintf(stderr, "VideoPipInit: cannot retrieve DRM resources (%d): %m\n", errno);
+		return -1;
+	}
+	for (i = 0; i < resources->count_crtcs; i++) {
+		if (resources->crtcs[i] == render->crtc_id)
+			crtc_index = i;
+	}
+	drmModeFreeResources(resources);
+
+	if (crtc_index < 0 || (plane_res = drmModeGetPlaneResources(render->fd_drm)) == NULL)
+		return -1;
+
+	for (j = 0; j < plane_res->count_planes && !render->video_plane; j++) {
+		uint32_t plane_id = plane_res->planes[j];
+
+		if (plane_id == main_render->video_plane || plane_id == main_render->osd_plane)
+			continue;
+		if ((plane = drmModeGetPlane(render->fd_drm, plane_id)) == NULL)
+			continue;
+
+		// free overlay plane of our crtc, which can show the decoder frames
+		if (plane->possible_crtcs & (1 << crtc_index) &&
+			(!plane->crtc_id || plane->crtc_id == render->crtc_id) &&
+			GetPropertyValue(render->fd_drm, plane_id, DRM_MODE_OBJECT_PLANE,
+				"type") == DRM_PLANE_TYPE_OVERLAY &&
+			PlaneHasFormat(render->fd_drm, plane_id, DRM_FORMAT_NV12))
+			render->video_plane = plane_id;
+
+		drmModeFreePlane(plane);
+	}
+	drmModeFreePlaneResources(plane_res);
+
+	if (!render->video_plane) {
+		Warning(_("video: no free plane for pip\n"));
+		return -1;
+	}
 
-    (void)size;
-    (void)width;
-    (void)height;
-    return NULL;
+	// default: lower right corner
+	VideoSetPipPosition(render, render->mode.hdisplay * 65 / 100,
+		render->mode.vdisplay * 65 / 100, render->mode.hdisplay * 30 / 100,
+		render->mode.vdisplay * 30 / 100);
+
+	Info(_("video: pip on plane %d\n"), render->video_plane);
+
+	return 0;
 }
 
 ///
-///	Get render statistics.
+///	Release the plane and buffers of a pip render.
 ///
-///	@param hw_render	video hardware render
-///	@param[out] duped	duped frames
-///	@param[out] dropped	dropped frames
-///	@param[out] count	number of decoded frames
+///	@param render	pip video render
 ///
-void VideoGetStats(VideoRender * render, int *duped,
-    int *dropped, int *counter)
+///	@note the pip threads must be stopped.
+///
+void VideoPipExit(VideoRender * render)
 {
-    *duped = render->FramesDuped;
-    *dropped = render->FramesDropped;
-    *counter = render->StartCounter;
+	pthread_t filter_thread = render->FilterThread;
+
+	if (!render->Main || !render->video_plane)
+		return;
+
+	if (filter_thread) {
+		render->Filter_Close = 1;
+		pthread_join(filter_thread, NULL);
+	}
+
+	PipPlaneOff(render);
+	render->act_buf = NULL;
+	CleanDisplayThread(render);
+	render->video_plane = 0;
+}
+
+///
+///	Set pip window position.
+///
+///	@param render	pip video render
+///	@param x	x-coordinate on screen
+///	@param y	y-coordinate on screen
+///	@param width	width of the pip window
+///	@param height	height of the pip window
+///
+void VideoSetPipPosition(VideoRender * render, int x, int y, int width, int height)
+{
+	if (x < 0)
+		x = 0;
+	if (y < 0)
+		y = 0;
+	if (x + width > render->mode.hdisplay)
+		width = render->mode.hdisplay - x;
+	if (y + height > render->mode.vdisplay)
+		height = render->mode.vdisplay - y;
+
+	if (width < 16 || height < 16)
+		return;
+
+	render->pip_x = x;
+	render->pip_y = y;
+	render->pip_width = width;
+	render->pip_height = height;
 }
 
 //----------------------------------------------------------------------------
@@ -1691,6 +4039,257 @@ void VideoSetAudioDelay(int ms)
 	VideoAudioDelay = ms;
 }
 
+///
+///	Get osd size.
+///
+///	The osd size can differ from the screen size, the display controller
+///	scales the osd plane.
+///
+///	@param[out] width	osd width
+///	@param[out] height	osd height
+///	@param[out] pixel_aspect	osd aspect
+///
+void VideoGetOsdSize(VideoRender * render, int *width, int *height,
+		double *pixel_aspect)
+{
+	if (render->buf_osd.width && render->buf_osd.height) {
+		*width = render->buf_osd.width;
+		*height = render->buf_osd.height;
+	} else if (VideoOsdWidth > 0 && VideoOsdHeight > 0) {
+		*width = VideoOsdWidth;
+		*height = VideoOsdHeight;
+	} else {
+		*width = render->mode.hdisplay;
+		*height = render->mode.vdisplay;
+	}
+	*pixel_aspect = (double)16 / (double)9;
+}
+
+///
+///	Set osd size.
+///
+///	@param width	osd width (0 = screen width)
+///	@param height	osd height (0 = screen height)
+///
+///	@note only used at video init.
+///
+void VideoSetOsdSize(int width, int height)
+{
+	VideoOsdWidth = width;
+	VideoOsdHeight = height;
+}
+
+///
+///	Set osd pixel format.
+///
+///	@param format	0 = ARGB8888, 1 = ARGB4444 if supported by the plane
+///
+///	@note only used at video init.
+///
+void VideoSetOsdFormat(int format)
+{
+	VideoOsdFormat = format;
+}
+
+///
+///	Set fast channel switch.
+///
+///	@param onoff	1 = hold the last frame and show the first frame of
+///			the new stream before a/v sync
+///
+void VideoSetFastSwitch(int onoff)
+{
+	VideoFastSwitch = onoff;
+}
+
+///
+///	Set automatic refresh rate.
+///
+///	@param onoff	1 = switch to the display mode matching the frame
+///			rate of the stream
+///
+void VideoSetAutoRefresh(int onoff)
+{
+	VideoAutoRefresh = onoff;
+}
+
+///
+///	Set display mode policy.
+///
+///	@param mode	0 = fixed 1920x1080 or 1280x720, 1 = native mode of
+///			the panel, 2 = mode size follows the video
+///
+///	@note only used at video init.
+///
+void VideoSetDisplayMode(int mode)
+{
+	VideoDisplayMode = mode;
+}
+
+///
+///	Set best software deinterlacer.
+///
+///	@param tier	0 = bwdif, 1 = yadif, 2 = yadif frame rate, 3 = bob,
+///			4 = weave. Slower tiers are skipped, if the cpu is too
+///			slow for the stream.
+///
+///	@note used at the next stream start.
+///
+void VideoSetDeinterlacer(int tier)
+{
+	if (tier < 0 || tier >= VIDEO_DEINT_TIERS)
+		tier = 0;
+	VideoDeinterlacer = tier;
+}
+
+///
+///	Set slice threads of the filter.
+///
+///	@param threads	threads per filter graph, 0 = one per cpu
+///
+///	@note used at the next stream start.
+///
+void VideoSetFilterThreads(int threads)
+{
+	VideoFilterThreads = threads < 0 ? 0 : threads;
+}
+
+///
+///	Set the cpus of the filter thread and its slice threads.
+///
+///	@param mask	bit n set = cpu n, 0 = any cpu
+///
+///	@note used at the next stream start.
+///
+void VideoSetFilterCpus(int mask)
+{
+	VideoFilterCpus = mask & 0x7FFFFFFF;
+}
+
+///
+///	Set the cpus of the decode thread.
+///
+///	@param mask	bit n set = cpu n, 0 = any cpu
+///
+///	@note used when the thread starts.
+///
+void VideoSetDecodeCpus(int mask)
+{
+	VideoDecodeCpus = mask & 0x7FFFFFFF;
+}
+
+///
+///	Set the cpus of the display thread.
+///
+///	@param mask	bit n set = cpu n, 0 = any cpu
+///
+///	@note used when the thread starts.
+///
+void VideoSetDisplayCpus(int mask)
+{
+	VideoDisplayCpus = mask & 0x7FFFFFFF;
+}
+
+///
+///	Set the realtime priority of the display thread.
+///
+///	@param prio	1 .. 99 = SCHED_FIFO, -1 .. -99 = SCHED_RR priority,
+///			0 = normal scheduling
+///
+///	@note used when the thread starts.
+///
+void VideoSetDisplayPriority(int prio)
+{
+	VideoDisplayPriority = prio;
+}
+
+///
+///	Setup the OSD framebuffer.
+///
+///	The OSD can be smaller than the screen, the display controller scales
+///	it up to the full screen. ARGB4444 halves the memory bandwidth again.
+///
+///	@param render	video render
+///	@param reduced	use the configured size and format, otherwise a
+///			full screen ARGB8888 osd
+///
+static void OsdSetupFB(VideoRender * render, int reduced)
+{
+	render->buf_osd.pix_fmt = DRM_FORMAT_ARGB8888;
+	render->buf_osd.width = render->mode.hdisplay;
+	render->buf_osd.height = render->mode.vdisplay;
+
+	if (reduced) {
+		if (VideoOsdWidth > 0 && VideoOsdHeight > 0) {
+			render->buf_osd.width = VideoOsdWidth;
+			render->buf_osd.height = VideoOsdHeight;
+		}
+		if (VideoOsdFormat == 1) {
+			if (PlaneHasFormat(render->fd_drm, render->osd_plane, DRM_FORMAT_ARGB4444))
+				render->buf_osd.pix_fmt = DRM_FORMAT_ARGB4444;
+			else
+				Warning(_("video: osd plane doesn't support ARGB4444\n"));
+		}
+	}
+
+	if (SetupFB(render, &render->buf_osd, NULL)){
+		fprintf(stderr, "VideoOsdInit: SetupFB FB OSD failed\n");
+		Fatal(_("VideoOsdInit: SetupFB FB OSD failed!\n"));
+	}
+
+	Info(_("video: osd %dx%d %4.4s on screen %dx%d\n"), render->buf_osd.width,
+		render->buf_osd.height, (char *)&render->buf_osd.pix_fmt,
+		render->mode.hdisplay, render->mode.vdisplay);
+}
+
+///
+///	Check if the osd is smaller than the screen or has a reduced format.
+///
+static int OsdIsReduced(const VideoRender * render)
+{
+	return render->buf_osd.width != render->mode.hdisplay ||
+		render->buf_osd.height != render->mode.vdisplay ||
+		render->buf_osd.pix_fmt != DRM_FORMAT_ARGB8888;
+}
+
+///
+///	Replace a reduced osd, which the osd plane can't display, with a
+///	full screen ARGB8888 osd.
+///
+static void OsdFallbackFB(VideoRender * render)
+{
+	Warning(_("video: osd plane can't scale %dx%d %4.4s, use full screen osd\n"),
+		render->buf_osd.width, render->buf_osd.height,
+		(char *)&render->buf_osd.pix_fmt);
+
+	DestroyFB(render->fd_drm, &render->buf_osd);
+	OsdSetupFB(render, 0);
+}
+
+///
+///	Test if the osd plane can show the osd buffer at full screen.
+///
+///	@retval 0	osd plane can display the osd buffer
+///
+static int OsdPlaneTest(VideoRender * render)
+{
+	drmModeAtomicReqPtr ModeReq;
+	int ret;
+
+	if (!(ModeReq = drmModeAtomicAlloc()))
+		return -1;
+
+	SetPlane(render, ModeReq, render->osd_plane, render->crtc_id, render->buf_osd.fb_id,
+		0, 0, render->mode.hdisplay, render->mode.vdisplay,
+		0, 0, render->buf_osd.width, render->buf_osd.height);
+
+	ret = DrmAtomicCommit(render->fd_drm, ModeReq,
+		DRM_MODE_ATOMIC_TEST_ONLY | DRM_MODE_ATOMIC_ALLOW_MODESET);
+	drmModeAtomicFree(ModeReq);
+
+	return ret;
+}
+
 ///
 ///	Initialize video output module.
 ///
@@ -1701,21 +4300,27 @@ void VideoInit(VideoRender * render)
 	if (FindDevice(render)){
 		fprintf(stderr, "VideoInit: FindDevice() failed\n");
 	}
+	GrabRender = render;
 
 	ReadHWPlatform(render);
 
+	// the software deinterlacers are measured once in the background
+	if (!VideoDeintAvail[VIDEO_DEINT_TIERS - 1]) {
+		pthread_t thread;
+
+		VideoDeintProbe();
+		if (!pthread_create(&thread, NULL, VideoDeintBenchThread, NULL)) {
+			pthread_setname_np(thread, "softhddev bench");
+			pthread_detach(thread);
+		}
+	}
+
 	render->bufs[0].width = render->bufs[1].width = 0;
 	render->bufs[0].height = render->bufs[1].height = 0;
 	render->bufs[0].pix_fmt = render->bufs[1].pix_fmt = DRM_FORMAT_NV12;
 
 	// osd FB
-	render->buf_osd.pix_fmt = DRM_FORMAT_ARGB8888;
-	render->buf_osd.width = render->mode.hdisplay;
-	render->buf_osd.height = render->mode.vdisplay;
-	if (SetupFB(render, &render->buf_osd, NULL)){
-		fprintf(stderr, "VideoOsdInit: SetupFB FB OSD failed\n");
-		Fatal(_("VideoOsdInit: SetupFB FB OSD failed!\n"));
-	}
+	OsdSetupFB(render, 1);
 
 	// black fb
 	render->buf_black.pix_fmt = DRM_FORMAT_NV12;
@@ -1750,6 +4355,7 @@ void VideoInit(VideoRender * render)
 
 	if (drmModeCreatePropertyBlob(render->fd_drm, &render->mode, sizeof(render->mode), &modeID) != 0)
 		fprintf(stderr, "Failed to create mode property blob.\n");
+modeset:
 	if (!(ModeReq = drmModeAtomicAlloc()))
 		fprintf(stderr, "cannot allocate atomic request (%d): %m\n", errno);
 
@@ -1760,6 +4366,10 @@ void VideoInit(VideoRender * render)
 	SetPropertyRequest(ModeReq, render->fd_drm, render->crtc_id,
 						DRM_MODE_OBJECT_CRTC, "ACTIVE", 1);
 	SetPlaneCrtc(render, ModeReq, prime_plane, 0, 0, render->mode.hdisplay, render->mode.vdisplay);
+	// start in sdr, the first frame sets its colorimetry
+	if (render->HdrSupport)
+		SetPropertyRequest(ModeReq, render->fd_drm, render->connector_id,
+			DRM_MODE_OBJECT_CONNECTOR, "HDR_OUTPUT_METADATA", 0);
 
 	if (render->use_zpos) {
 		// Primary plane
@@ -1772,12 +4382,26 @@ void VideoInit(VideoRender * render)
 		SetPlaneFbId(render, ModeReq, overlay_plane, render->buf_black.fb_id);
 	}
 
-	if (drmModeAtomicCommit(render->fd_drm, ModeReq, flags, NULL) != 0)
+	// primary plane can't scale the reduced osd, use a full screen osd
+	if (render->use_zpos && OsdIsReduced(render) &&
+		DrmAtomicCommit(render->fd_drm, ModeReq, flags | DRM_MODE_ATOMIC_TEST_ONLY)) {
+		drmModeAtomicFree(ModeReq);
+		OsdFallbackFB(render);
+		goto modeset;
+	}
+
+	if (DrmAtomicCommit(render->fd_drm, ModeReq, flags) != 0)
 		fprintf(stderr, "cannot set atomic mode (%d): %m\n", errno);
 
 	drmModeAtomicFree(ModeReq);
 
+	if (!render->use_zpos && OsdIsReduced(render) && OsdPlaneTest(render))
+		OsdFallbackFB(render);
+
 	render->OsdShown = 0;
+	render->Colorspace = -1;
+	render->ColorEncoding = -1;
+	render->ColorRange = -1;
 
 	// init variables page flip
 //    if (render->ev.page_flip_handler != Drm_page_flip_event) {
@@ -1793,18 +4417,28 @@ void VideoInit(VideoRender * render)
 ///
 void VideoExit(VideoRender * render)
 {
-	VideoThreadExit();
+	VideoThreadExit(render);
 
 	if (render) {
 		// restore saved CRTC configuration
 		if (render->saved_crtc){
+			pthread_mutex_lock(&VideoCommitMutex);
 			drmModeSetCrtc(render->fd_drm, render->saved_crtc->crtc_id, render->saved_crtc->buffer_id,
 				render->saved_crtc->x, render->saved_crtc->y, &render->connector_id, 1, &render->saved_crtc->mode);
+			pthread_mutex_unlock(&VideoCommitMutex);
 			drmModeFreeCrtc(render->saved_crtc);
 		}
 
+		if (GrabRender == render)
+			GrabRender = NULL;
+		free(render->Sample.Buf[0].Image);
+		free(render->Sample.Buf[1].Image);
+		ReleaseHold(render);
+		VideoReverseClear(render);
 		DestroyFB(render->fd_drm, &render->buf_black);
 		DestroyFB(render->fd_drm, &render->buf_osd);
+		if (render->HdrBlob)
+			drmModeDestroyPropertyBlob(render->fd_drm, render->HdrBlob);
 		close(render->fd_drm);
 	}
 }
@@ -723,7 +723,7 @@ static void *DisplayHandlerThread(void *arg)
 ///
 ///	Exit and cleanup video threads.
 ///
-void VideoThreadExit(void)
+void VideoThreadExit( __attribute__ ((unused)) VideoRender * render)
 {
     if (VideoThread) {
 		void *retval;
@@ -784,6 +784,41 @@ VideoRender *VideoNewRender(VideoStream * stream)
 	return render;
 }
 
+///
+///	Setup a pip render.
+///
+///	@note pip isn't supported by mmal.
+///
+int VideoPipInit( __attribute__ ((unused)) VideoRender * render,
+		__attribute__ ((unused)) VideoRender * main_render)
+{
+	return -1;
+}
+
+///
+///	Release a pip render.
+///
+void VideoPipExit( __attribute__ ((unused)) VideoRender * render)
+{
+}
+
+///
+///	Set pip window position.
+///
+void VideoSetPipPosition( __attribute__ ((unused)) VideoRender * render,
+		__attribute__ ((unused)) int x, __attribute__ ((unused)) int y,
+		__attribute__ ((unused)) int width, __attribute__ ((unused)) int height)
+{
+}
+
+///
+///	Get the video stream of a render.
+///
+VideoStream *VideoGetStream(const VideoRender * render)
+{
+	return render->Stream;
+}
+
 ///
 ///	Destroy a video hw render.
 ///
@@ -920,6 +955,14 @@ void VideoSetClosing(VideoRender * render)
 	render->FramesDropped = 0;
 }
 
+/**
+**	Set seek flag (mmal shows black on every closing).
+*/
+void VideoSetSeek(__attribute__ ((unused)) VideoRender * render,
+	__attribute__ ((unused)) int on)
+{
+}
+
 /**
 **	Pause video.
 */
@@ -946,6 +989,39 @@ void VideoSetTrickSpeed(VideoRender * render, int speed)
 	}
 }
 
+/**
+**	Wait for the frame of a still picture (not tracked by mmal).
+*/
+void VideoSetStill(__attribute__ ((unused)) VideoRender * render,
+	__attribute__ ((unused)) int on)
+{
+}
+
+/**
+**	Check if the frame of a still picture isn't shown yet (not tracked
+**	by mmal, it is shown when it is decoded).
+*/
+int VideoIsStillPending(__attribute__ ((unused)) const VideoRender * render)
+{
+	return 0;
+}
+
+/**
+**	Set reverse playback (not supported by mmal).
+*/
+void VideoSetReverse(__attribute__ ((unused)) VideoRender * render,
+	__attribute__ ((unused)) int on)
+{
+}
+
+/**
+**	Queue the newest frame of a reverse gop (not supported by mmal).
+*/
+int VideoReverseOutput(__attribute__ ((unused)) VideoRender * render)
+{
+	return 0;
+}
+
 /**
 **	Play video.
 */
@@ -1013,6 +1089,22 @@ void VideoGetStats(VideoRender * render, int *duped,
     *counter = render->StartCounter;
 }
 
+void VideoGetZapTime( __attribute__ ((unused)) VideoRender * render,
+    int *first_frame, int *sync)
+{
+    *first_frame = 0;
+    *sync = 0;
+}
+
+void VideoGetFilterStats( __attribute__ ((unused)) VideoRender * render,
+    const char **name, int *threads, int *us, int *load)
+{
+    *name = NULL;
+    *threads = 0;
+    *us = 0;
+    *load = 0;
+}
+
 ///
 ///	Get screen size.
 ///
@@ -1029,6 +1121,17 @@ void VideoGetScreenSize(__attribute__ ((unused)) VideoRender * render,
 	*pixel_aspect = (double)16 / (double)9;
 }
 
+///
+///	Get osd size.
+///
+///	@note mmal osd is always screen sized.
+///
+void VideoGetOsdSize(VideoRender * render, int *width, int *height,
+		double *pixel_aspect)
+{
+	VideoGetScreenSize(render, width, height, pixel_aspect);
+}
+
 //----------------------------------------------------------------------------
 //	Setup
 //----------------------------------------------------------------------------
@@ -1043,6 +1146,61 @@ void VideoSetAudioDelay(int ms)
     VideoAudioDelay = ms;
 }
 
+///
+///	Set osd size.
+///
+///	@note not supported by mmal.
+///
+void VideoSetOsdSize( __attribute__ ((unused)) int width,
+		__attribute__ ((unused)) int height)
+{
+}
+
+///
+///	Set osd pixel format.
+///
+///	@note not supported by mmal.
+///
+void VideoSetOsdFormat( __attribute__ ((unused)) int format)
+{
+}
+
+void VideoSetFastSwitch( __attribute__ ((unused)) int onoff)
+{
+}
+
+void VideoSetAutoRefresh( __attribute__ ((unused)) int onoff)
+{
+}
+
+void VideoSetDisplayMode( __attribute__ ((unused)) int mode)
+{
+}
+
+void VideoSetDeinterlacer( __attribute__ ((unused)) int tier)
+{
+}
+
+void VideoSetFilterThreads( __attribute__ ((unused)) int threads)
+{
+}
+
+void VideoSetFilterCpus( __attribute__ ((unused)) int mask)
+{
+}
+
+void VideoSetDecodeCpus( __attribute__ ((unused)) int mask)
+{
+}
+
+void VideoSetDisplayCpus( __attribute__ ((unused)) int mask)
+{
+}
+
+void VideoSetDisplayPriority( __attribute__ ((unused)) int prio)
+{
+}
+
 ///
 ///	Initialize video output module.
 ///
@@ -1066,7 +1224,7 @@ void VideoInit(VideoRender * render)
 ///
 void VideoExit(VideoRender * render)
 {
-	VideoThreadExit();
+	VideoThreadExit(render);
 
 	if(vc_dispmanx_vsync_callback(render->display, NULL, NULL))
 		fprintf(stderr, "Error: cannot close dispmanx vsync callback\n");
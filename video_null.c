@@ -0,0 +1,1134 @@
+///
+///	@file video_null.c	@brief Null video module
+///
+///	Copyright (c) 2009 - 2015 by Johns.  All Rights Reserved.
+///	Copyright (c) 2018 -2019 by zille.  All Rights Reserved.
+///
+///	Contributor(s):
+///
+///	License: AGPLv3
+///
+///	This program is free software: you can redistribute it and/or modify
+///	it under the terms of the GNU Affero General Public License as
+///	published by the Free Software Foundation, either version 3 of the
+///	License.
+///
+///	This program is distributed in the hope that it will be useful,
+///	but WITHOUT ANY WARRANTY; without even the implied warranty of
+///	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+///	GNU Affero General Public License for more details.
+///
+///	$Id$
+//////////////////////////////////////////////////////////////////////////////
+
+///
+///	@defgroup Video The video module.
+///
+///	This module renders into nothing. The software decoded frames are
+///	shown on a simulated vblank clock, synced to the audio clock like
+///	the drm display. It records the shown, dropped and duped frames,
+///	the missed vblanks, the queue depth and the a/v difference, so the
+///	pipeline can be run and measured on a host without a display.
+///
+///	Environment:
+///		VIDEO_NULL_HZ	simulated refresh rate, 0 = free run without
+///				a/v sync (default 50)
+///		VIDEO_NULL_LOG	file for a line per vblank event
+///
+
+#ifndef __USE_GNU
+#define __USE_GNU
+#endif
+
+#include <inttypes.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <libintl.h>
+#define _(str) gettext(str)		///< gettext shortcut
+#define _N(str) str			///< gettext_noop shortcut
+
+#include <pthread.h>
+
+#include <libavcodec/avcodec.h>
+#include <libavutil/pixdesc.h>
+
+#include "iatomic.h"			// portable atomic_t
+#include "misc.h"
+#include "video.h"
+#include "audio.h"
+#include "grab.h"
+#include "softhddev.h"
+
+//----------------------------------------------------------------------------
+//	Defines
+//----------------------------------------------------------------------------
+
+#define VIDEO_NULL_WIDTH 1920		///< simulated screen width
+#define VIDEO_NULL_HEIGHT 1080		///< simulated screen height
+#define VIDEO_NULL_HZ 50		///< default simulated refresh rate
+#define VIDEO_TRICK_FRAME_MS 20		///< ms of a trick speed 1 frame
+
+//----------------------------------------------------------------------------
+//	Variables
+//----------------------------------------------------------------------------
+int VideoAudioDelay;
+
+static int VideoDecodeCpus;		///< config cpu mask of the decode thread
+static int VideoDisplayCpus;		///< config cpu mask of the display thread
+static int VideoDisplayPriority;	///< config realtime priority of the display
+static int VideoNullHz = VIDEO_NULL_HZ;	///< simulated refresh rate (0 = free run)
+static FILE *VideoNullLog;		///< vblank event log
+static VideoRender *GrabRender;		///< main render for the screen grab
+
+    /// hook called for every queued, shown, dropped or duped frame
+void (*VideoNullHook)(int, int64_t);
+
+//----------------------------------------------------------------------------
+//	Null render
+//----------------------------------------------------------------------------
+
+struct _Null_Render_
+{
+	AVFrame *FramesRb[VIDEO_SURFACES_MAX];
+	int FramesWrite;		///< write pointer
+	int FramesRead;			///< read pointer
+	atomic_t FramesFilled;		///< how many of the buffer is used
+
+	VideoStream *Stream;		///< video stream
+	int TrickSpeed;			///< current trick speed
+	uint32_t TrickTick;		///< ms ticks of the last trick frame
+	volatile int StillPending;	///< still picture not yet shown
+	int VideoPaused;
+	int Closing;			///< flag about closing current stream
+
+	int Reverse;			///< reverse playback, buffer gop frames
+	AVFrame *ReverseRb[VIDEO_REVERSE_MAX];	///< decoded frames of a reverse gop
+	int ReverseFirst;		///< oldest frame of the reverse buffer
+	int ReverseFilled;		///< frames in the reverse buffer
+
+	int StartCounter;		///< counter for video start
+	int FramesDuped;		///< number of frames duplicated
+	int FramesDropped;		///< number of frames dropped
+	AVRational *timebase;		///< pointer to AVCodecContext pkts_timebase
+	int64_t pts;
+
+	AVFrame *ShownFrame;		///< frame on the simulated screen
+	uint8_t *Osd;			///< screen sized ARGB osd
+	int OsdShown;
+
+	uint64_t VblankTick;		///< us ticks of the last simulated vblank
+	int Vblanks;			///< vblanks of the stream
+	int VblanksMissed;		///< vblanks the display thread was late
+	int Underruns;			///< vblanks without a new frame
+	int QueueSum;			///< sum of the queue depth at the vblanks
+	int QueueMax;			///< max queue depth at a vblank
+	int64_t SyncSum;		///< sum of the a/v difference of shown frames
+	int SyncMax;			///< max a/v difference of a shown frame
+
+	uint32_t ZapStartTick;		///< ms ticks of the channel switch start
+	int ZapFirstFrame;		///< ms until the first frame was shown
+	int ZapSync;			///< ms until a/v sync
+
+	pthread_t DecodeThread;		///< video decode thread
+	pthread_t DisplayThread;	///< video display thread
+	pthread_cond_t PauseCondition;
+	pthread_mutex_t PauseMutex;
+	pthread_cond_t WaitCleanCondition;
+	pthread_mutex_t WaitCleanMutex;
+	pthread_mutex_t GrabMutex;	///< shown frame lock for the grab
+};
+
+//----------------------------------------------------------------------------
+//	Helper functions
+//----------------------------------------------------------------------------
+
+///
+///	Log a vblank event.
+///
+///	@param render	video render
+///	@param event	show, drop, dupe, miss or empty
+///	@param video	ms pts of the frame
+///	@param audio	ms audio clock
+///
+static void NullLog(const VideoRender * render, const char *event,
+	int64_t video, int64_t audio)
+{
+	if (!VideoNullLog)
+		return;
+
+	fprintf(VideoNullLog, "%" PRIu64 " %s %" PRId64 " %" PRId64 " %d %d\n",
+		GetUsTicks(), event, video, audio,
+		video != (int64_t)AV_NOPTS_VALUE && audio != (int64_t)AV_NOPTS_VALUE ?
+		(int)(video - audio - VideoAudioDelay) : 0,
+		atomic_read(&render->FramesFilled));
+}
+
+///
+///	Log the statistics of a stream.
+///
+static void NullStats(const VideoRender * render)
+{
+	if (!render->Vblanks)
+		return;
+
+	Info(_("video/null: %d frames %d dropped %d duped, %d vblanks %d missed "
+		"%d empty, queue avg %d.%02d max %d, a/v diff avg %dms max %dms\n"),
+		render->StartCounter, render->FramesDropped, render->FramesDuped,
+		render->Vblanks, render->VblanksMissed, render->Underruns,
+		render->QueueSum / render->Vblanks,
+		render->QueueSum * 100 / render->Vblanks % 100, render->QueueMax,
+		render->StartCounter ? (int)(render->SyncSum / render->StartCounter) : 0,
+		render->SyncMax);
+}
+
+///
+///	Free the queued and the shown frames, end the closing.
+///
+static void NullClean(VideoRender * render)
+{
+	AVFrame *frame;
+
+	while (atomic_read(&render->FramesFilled)) {
+		frame = render->FramesRb[render->FramesRead];
+		render->FramesRead = (render->FramesRead + 1) % VIDEO_SURFACES_MAX;
+		atomic_dec(&render->FramesFilled);
+		av_frame_free(&frame);
+	}
+
+	pthread_mutex_lock(&render->GrabMutex);
+	av_frame_free(&render->ShownFrame);
+	pthread_mutex_unlock(&render->GrabMutex);
+
+	NullStats(render);
+	render->Vblanks = 0;
+	render->VblanksMissed = 0;
+	render->Underruns = 0;
+	render->QueueSum = 0;
+	render->QueueMax = 0;
+	render->SyncSum = 0;
+	render->SyncMax = 0;
+
+	render->Closing = 0;
+	pthread_cond_signal(&render->WaitCleanCondition);
+}
+
+///
+///	Wait for the next simulated vblank.
+///
+///	A late display thread misses vblanks, the clock restarts from now.
+///
+static void NullVblank(VideoRender * render)
+{
+	uint64_t period;
+	uint64_t now;
+	int filled;
+
+	if (VideoNullHz > 0) {
+		period = 1000000 / VideoNullHz;
+		now = GetUsTicks();
+		if (!render->VblankTick || now > render->VblankTick + 2 * period) {
+			if (render->VblankTick && render->StartCounter) {
+				render->VblanksMissed += (now - render->VblankTick) / period - 1;
+				NullLog(render, "miss", AV_NOPTS_VALUE, AV_NOPTS_VALUE);
+			}
+			render->VblankTick = now;
+		} else {
+			render->VblankTick += period;
+			if (render->VblankTick > now)
+				usleep(render->VblankTick - now);
+		}
+	}
+
+	filled = atomic_read(&render->FramesFilled);
+	render->Vblanks++;
+	render->QueueSum += filled;
+	if (filled > render->QueueMax)
+		render->QueueMax = filled;
+}
+
+///
+///	Show the next frame at a simulated vblank.
+///
+///	Same a/v sync as the drm display: frames more than 5ms late are
+///	dropped, frames more than 35ms early repeat the shown frame.
+///
+static void NullFrame2Display(VideoRender * render)
+{
+	AVFrame *frame;
+	int64_t audio_pts = AV_NOPTS_VALUE;
+	int64_t video_pts;
+	int diff = 0;
+
+dequeue:
+	if (render->Closing) {
+		NullClean(render);
+		return;
+	}
+	if (!atomic_read(&render->FramesFilled)) {
+		if (render->StartCounter) {
+			render->Underruns++;
+			NullLog(render, "empty", AV_NOPTS_VALUE, AV_NOPTS_VALUE);
+		}
+		return;
+	}
+
+	frame = render->FramesRb[render->FramesRead];
+	render->pts = frame->pts;
+	video_pts = frame->pts * 1000 * av_q2d(*render->timebase);
+
+	if (!render->StartCounter && !render->TrickSpeed) {
+		if (VideoNullHz <= 0) {
+			AudioVideoReady(video_pts);
+		} else if (AudioVideoReady(video_pts)) {
+			return;
+		}
+		if (render->ZapStartTick && !render->ZapSync)
+			render->ZapSync = GetMsTicks() - render->ZapStartTick;
+	}
+
+	if (VideoNullHz > 0 && !render->TrickSpeed) {
+		audio_pts = AudioGetClock();
+		if (audio_pts == (int64_t)AV_NOPTS_VALUE)
+			return;
+
+		diff = video_pts - audio_pts - VideoAudioDelay;
+		if (diff < -5 && abs(diff) <= 5000) {
+			render->FramesDropped++;
+			NullLog(render, "drop", video_pts, audio_pts);
+			if (VideoNullHook)
+				VideoNullHook(VIDEO_NULL_DROPPED, frame->pts);
+			av_frame_free(&frame);
+			render->FramesRead = (render->FramesRead + 1) % VIDEO_SURFACES_MAX;
+			atomic_dec(&render->FramesFilled);
+			if (!render->StartCounter)
+				render->StartCounter++;
+			goto dequeue;
+		}
+		if (diff > 35 && abs(diff) <= 5000) {
+			render->FramesDuped++;
+			NullLog(render, "dupe", video_pts, audio_pts);
+			if (VideoNullHook)
+				VideoNullHook(VIDEO_NULL_DUPED, frame->pts);
+			return;
+		}
+	}
+
+	// trick speed: constant cadence of speed * 20ms per frame
+	if (render->TrickSpeed) {
+		if (render->TrickTick && GetMsTicks() - render->TrickTick <
+			(uint32_t)VIDEO_TRICK_FRAME_MS * render->TrickSpeed)
+			return;
+		render->TrickTick = GetMsTicks();
+	} else {
+		render->StartCounter++;
+		render->SyncSum += abs(diff);
+		if (abs(diff) > render->SyncMax)
+			render->SyncMax = abs(diff);
+	}
+
+	render->FramesRead = (render->FramesRead + 1) % VIDEO_SURFACES_MAX;
+	atomic_dec(&render->FramesFilled);
+	render->StillPending = 0;
+
+	pthread_mutex_lock(&render->GrabMutex);
+	av_frame_free(&render->ShownFrame);
+	render->ShownFrame = frame;
+	pthread_mutex_unlock(&render->GrabMutex);
+
+	NullLog(render, "show", video_pts, audio_pts);
+	if (VideoNullHook)
+		VideoNullHook(VIDEO_NULL_SHOWN, frame->pts);
+
+	// channel switch time
+	if (render->ZapStartTick) {
+		if (!render->ZapFirstFrame)
+			render->ZapFirstFrame = GetMsTicks() - render->ZapStartTick;
+		if (render->ZapSync)
+			render->ZapStartTick = 0;
+	}
+}
+
+//----------------------------------------------------------------------------
+//	OSD
+//----------------------------------------------------------------------------
+
+///
+///	Clear the OSD.
+///
+void VideoOsdClear(VideoRender * render)
+{
+	if (render->Osd)
+		memset(render->Osd, 0, VIDEO_NULL_WIDTH * VIDEO_NULL_HEIGHT * 4);
+	render->OsdShown = 0;
+}
+
+///
+///	Draw an OSD ARGB image.
+///
+///	@param xi	x-coordinate in argb image
+///	@param yi	y-coordinate in argb image
+///	@paran height	height in pixel in argb image
+///	@paran width	width in pixel in argb image
+///	@param pitch	pitch of argb image
+///	@param argb	32bit ARGB image data
+///	@param x	x-coordinate on screen of argb image
+///	@param y	y-coordinate on screen of argb image
+///
+void VideoOsdDrawARGB(VideoRender * render, int xi, int yi, int width,
+		int height, int pitch, const uint8_t * argb, int x, int y)
+{
+	int i;
+
+	if (!render->Osd)
+		return;
+	if (x + width > VIDEO_NULL_WIDTH)
+		width = VIDEO_NULL_WIDTH - x;
+	if (y + height > VIDEO_NULL_HEIGHT)
+		height = VIDEO_NULL_HEIGHT - y;
+	if (x < 0 || y < 0 || width <= 0)
+		return;
+
+	for (i = 0; i < height; ++i) {
+		memcpy(render->Osd + ((y + i) * VIDEO_NULL_WIDTH + x) * 4,
+			argb + (yi + i) * pitch + xi * 4, width * 4);
+	}
+	render->OsdShown = 1;
+}
+
+//----------------------------------------------------------------------------
+//	Thread
+//----------------------------------------------------------------------------
+
+///
+///	Video decode thread.
+///
+static void *DecodeHandlerThread(void *arg)
+{
+	VideoRender * render = (VideoRender *)arg;
+
+	Debug(3, "video/null: decode thread started\n");
+
+	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+	pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
+
+	SetThreadCpus(VideoDecodeCpus);
+
+	for (;;) {
+		pthread_testcancel();
+
+		if (atomic_read(&render->FramesFilled) < VIDEO_SURFACES_MAX) {
+			if (VideoDecodeInput(render->Stream))
+				usleep(10000);
+		} else {
+			usleep(10000);
+		}
+	}
+	pthread_exit((void *)pthread_self());
+}
+
+///
+///	Simulated display thread.
+///
+static void *DisplayHandlerThread(void *arg)
+{
+	VideoRender * render = (VideoRender *)arg;
+
+	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+	pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
+
+	SetThreadCpus(VideoDisplayCpus);
+	SetThreadPriority(VideoDisplayPriority);
+
+	for (;;) {
+		pthread_testcancel();
+
+		if (render->VideoPaused) {
+			pthread_mutex_lock(&render->PauseMutex);
+			pthread_cond_wait(&render->PauseCondition, &render->PauseMutex);
+			pthread_mutex_unlock(&render->PauseMutex);
+		}
+
+		NullVblank(render);
+		NullFrame2Display(render);
+
+		// free run without frames, don't spin
+		if (VideoNullHz <= 0 && !atomic_read(&render->FramesFilled))
+			usleep(1000);
+	}
+	pthread_exit((void *)pthread_self());
+}
+
+///
+///	Exit and cleanup video threads.
+///
+void VideoThreadExit(VideoRender * render)
+{
+	void *retval;
+
+	if (!render)
+		return;
+
+	if (render->DecodeThread) {
+		if (pthread_cancel(render->DecodeThread)) {
+			Error(_("video: can't queue cancel video display thread\n"));
+		}
+		if (pthread_join(render->DecodeThread, &retval) || retval != PTHREAD_CANCELED) {
+			Error(_("video: can't cancel video display thread\n"));
+		}
+		render->DecodeThread = 0;
+	}
+
+	if (render->DisplayThread) {
+		if (pthread_cancel(render->DisplayThread)) {
+			Error(_("video: can't cancel DisplayHandlerThread thread\n"));
+		}
+		if (pthread_join(render->DisplayThread, &retval) || retval != PTHREAD_CANCELED) {
+			Error(_("video: can't cancel video display thread\n"));
+		}
+		render->DisplayThread = 0;
+	}
+}
+
+///
+///	Video display wakeup.
+///
+///	New video arrived, wakeup video thread.
+///
+void VideoThreadWakeup(VideoRender * render)
+{
+	if (!render->DecodeThread) {
+		pthread_create(&render->DecodeThread, NULL, DecodeHandlerThread, render);
+		pthread_setname_np(render->DecodeThread, "softhddev video");
+	}
+
+	if (!render->DisplayThread) {
+		pthread_create(&render->DisplayThread, NULL, DisplayHandlerThread, render);
+		pthread_setname_np(render->DisplayThread, "softhddev vblank");
+	}
+}
+
+//----------------------------------------------------------------------------
+//	Video API
+//----------------------------------------------------------------------------
+
+///
+///	Allocate new video render.
+///
+///	@param stream	video stream
+///
+///	@returns a new initialized video render.
+///
+VideoRender *VideoNewRender(VideoStream * stream)
+{
+	VideoRender *render;
+
+	if (!(render = calloc(1, sizeof(*render)))) {
+		Error(_("video/null: out of memory\n"));
+		return NULL;
+	}
+	atomic_set(&render->FramesFilled, 0);
+	render->Stream = stream;
+
+	pthread_cond_init(&render->PauseCondition, NULL);
+	pthread_mutex_init(&render->PauseMutex, NULL);
+	pthread_cond_init(&render->WaitCleanCondition, NULL);
+	pthread_mutex_init(&render->WaitCleanMutex, NULL);
+	pthread_mutex_init(&render->GrabMutex, NULL);
+
+	return render;
+}
+
+///
+///	Destroy a video render.
+///
+///	@param render	video render
+///
+void VideoDelRender(VideoRender * render)
+{
+	if (render) {
+		pthread_cond_destroy(&render->PauseCondition);
+		pthread_mutex_destroy(&render->PauseMutex);
+		pthread_cond_destroy(&render->WaitCleanCondition);
+		pthread_mutex_destroy(&render->WaitCleanMutex);
+		pthread_mutex_destroy(&render->GrabMutex);
+
+		free(render);
+	}
+}
+
+///
+///	Setup a pip render.
+///
+///	@note pip isn't supported by the null render.
+///
+int VideoPipInit( __attribute__ ((unused)) VideoRender * render,
+		__attribute__ ((unused)) VideoRender * main_render)
+{
+	return -1;
+}
+
+///
+///	Release a pip render.
+///
+void VideoPipExit( __attribute__ ((unused)) VideoRender * render)
+{
+}
+
+///
+///	Set pip window position.
+///
+void VideoSetPipPosition( __attribute__ ((unused)) VideoRender * render,
+		__attribute__ ((unused)) int x, __attribute__ ((unused)) int y,
+		__attribute__ ((unused)) int width, __attribute__ ((unused)) int height)
+{
+}
+
+///
+///	Get the video stream of a render.
+///
+VideoStream *VideoGetStream(const VideoRender * render)
+{
+	return render->Stream;
+}
+
+///
+///	Callback to negotiate the PixelFormat.
+///
+///	The null render shows software frames only, the first format
+///	without hw acceleration is taken.
+///
+///	@param render		video render
+///	@param video_ctx	ffmpeg video codec context
+///	@param fmt		is the list of formats which are supported by
+///				the codec, it is terminated by -1 as 0 is a
+///				valid format, the formats are ordered by
+///				quality.
+///
+enum AVPixelFormat Video_get_format(__attribute__ ((unused)) VideoRender * render,
+		__attribute__ ((unused)) AVCodecContext * video_ctx,
+		const enum AVPixelFormat *fmt)
+{
+	while (*fmt != AV_PIX_FMT_NONE) {
+		const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(*fmt);
+
+		if (desc && !(desc->flags & AV_PIX_FMT_FLAG_HWACCEL))
+			return *fmt;
+		fmt++;
+	}
+	fprintf(stderr, "Video_get_format: no software pixel format offered\n");
+	return AV_PIX_FMT_NONE;
+}
+
+///
+///	Queue a frame for the display thread.
+///
+static void NullQueueFrame(VideoRender * render, AVFrame * frame)
+{
+	if (VideoNullHook)
+		VideoNullHook(VIDEO_NULL_QUEUED, frame->pts);
+
+	render->FramesRb[render->FramesWrite] = frame;
+	render->FramesWrite = (render->FramesWrite + 1) % VIDEO_SURFACES_MAX;
+	atomic_inc(&render->FramesFilled);
+}
+
+///
+///	Free the frames of the reverse buffer.
+///
+static void NullReverseClear(VideoRender * render)
+{
+	while (render->ReverseFilled) {
+		av_frame_free(&render->ReverseRb[render->ReverseFirst]);
+		render->ReverseFirst = (render->ReverseFirst + 1) % VIDEO_REVERSE_MAX;
+		render->ReverseFilled--;
+	}
+	render->ReverseFirst = 0;
+}
+
+///
+///	Put a decoded frame of a reverse gop into the reverse buffer.
+///
+///	Same limit as the drm render (see VideoReverseLimit), the oldest
+///	frame is dropped.
+///
+static void NullReversePush(VideoRender * render, AVFrame * frame)
+{
+	int max;
+
+	max = VideoReverseLimit(frame);
+	while (render->ReverseFilled >= max) {
+		av_frame_free(&render->ReverseRb[render->ReverseFirst]);
+		render->ReverseFirst = (render->ReverseFirst + 1) % VIDEO_REVERSE_MAX;
+		render->ReverseFilled--;
+		render->FramesDropped++;
+	}
+
+	render->ReverseRb[(render->ReverseFirst + render->ReverseFilled) %
+		VIDEO_REVERSE_MAX] = frame;
+	render->ReverseFilled++;
+}
+
+///
+///	Display a ffmpeg frame
+///
+///	@param render		video render
+///	@param video_ctx	ffmpeg video codec context
+///	@param frame		frame to display
+///
+void VideoRenderFrame(VideoRender * render,
+		AVCodecContext * video_ctx, AVFrame * frame)
+{
+	if (!render->StartCounter)
+		render->timebase = &video_ctx->pkt_timebase;
+
+	if (render->Closing) {
+		av_frame_free(&frame);
+		return;
+	}
+
+	if (render->Reverse) {
+		NullReversePush(render, frame);
+		return;
+	}
+	NullQueueFrame(render, frame);
+}
+
+///
+///	Get video clock.
+///
+///	@param render	video render
+///
+///	@note this isn't monoton, decoding reorders frames, setter keeps it
+///	monotonic
+///
+int64_t VideoGetClock(const VideoRender * render)
+{
+	return render->pts;
+}
+
+///
+///	Send start condition to video thread.
+///
+static void StartVideo(VideoRender * render)
+{
+	render->VideoPaused = 0;
+	render->StartCounter = 0;
+	pthread_cond_signal(&render->PauseCondition);
+}
+
+///
+///	Set closing stream flag.
+///
+///	Waits until the display thread freed the frames of the stream.
+///
+///	@param render	video render
+///
+void VideoSetClosing(VideoRender * render)
+{
+	if (render->DisplayThread) {
+		pthread_mutex_lock(&render->WaitCleanMutex);
+		render->Closing = 1;
+		if (render->VideoPaused)
+			StartVideo(render);
+		while (render->Closing)
+			pthread_cond_wait(&render->WaitCleanCondition, &render->WaitCleanMutex);
+		pthread_mutex_unlock(&render->WaitCleanMutex);
+	}
+	render->StartCounter = 0;
+	render->FramesDuped = 0;
+	render->FramesDropped = 0;
+	render->VblankTick = 0;
+
+	render->ZapFirstFrame = 0;
+	render->ZapSync = 0;
+	render->ZapStartTick = GetMsTicks();
+}
+
+///
+///	Set seek flag (the null render has nothing to hold).
+///
+void VideoSetSeek(__attribute__ ((unused)) VideoRender * render,
+	__attribute__ ((unused)) int on)
+{
+}
+
+///
+///	Pause video.
+///
+void VideoPause(VideoRender * render)
+{
+	render->VideoPaused = 1;
+}
+
+///
+///	Set trick play speed.
+///
+///	@param render	video render
+///	@param speed	trick speed (0 = normal)
+///
+void VideoSetTrickSpeed(VideoRender * render, int speed)
+{
+	render->TrickSpeed = speed;
+	render->TrickTick = 0;
+
+	if (render->VideoPaused)
+		StartVideo(render);
+}
+
+///
+///	Wait for the frame of a still picture.
+///
+///	@param render	video render
+///	@param on	1 = the next shown frame is the still picture
+///
+void VideoSetStill(VideoRender * render, int on)
+{
+	render->StillPending = on;
+}
+
+///
+///	Check if the frame of a still picture isn't shown yet.
+///
+///	@param render	video render
+///
+int VideoIsStillPending(const VideoRender * render)
+{
+	return render->StillPending;
+}
+
+///
+///	Set reverse playback.
+///
+///	Must be called from the decoder thread.
+///
+///	@param render	video render
+///	@param on	1 = buffer the decoded frames of a gop
+///
+void VideoSetReverse(VideoRender * render, int on)
+{
+	NullReverseClear(render);
+	render->Reverse = on;
+}
+
+///
+///	Queue the newest frame of the reverse buffer.
+///
+///	@param render	video render
+///
+///	@returns 1 if a buffered frame was used, 0 if the buffer is empty.
+///
+int VideoReverseOutput(VideoRender * render)
+{
+	AVFrame *frame;
+	int i;
+
+	if (!render->ReverseFilled)
+		return 0;
+
+	render->ReverseFilled--;
+	i = (render->ReverseFirst + render->ReverseFilled) % VIDEO_REVERSE_MAX;
+	frame = render->ReverseRb[i];
+	render->ReverseRb[i] = NULL;
+
+	if (render->Closing) {
+		av_frame_free(&frame);
+		return 1;
+	}
+	NullQueueFrame(render, frame);
+	return 1;
+}
+
+///
+///	Play video.
+///
+void VideoPlay(VideoRender * render)
+{
+	render->TrickSpeed = 0;
+
+	StartVideo(render);
+}
+
+///
+///	Grab full screen image.
+///
+///	The shown frame is scaled to the simulated screen, the osd is
+///	blended over it.
+///
+///	@param size[out]	size of allocated image
+///	@param width[in,out]	width of image
+///	@param height[in,out]	height of image
+///	@param write_header	write a ppm header
+///
+uint8_t *VideoGrab(int *size, int *width, int *height, int write_header)
+{
+	VideoRender *render = GrabRender;
+	uint8_t *image;
+	uint8_t *rgb;
+	int w = VIDEO_NULL_WIDTH;
+	int h = VIDEO_NULL_HEIGHT;
+	int n;
+
+	if (!render) {
+		Debug(3, "video: no grab service\n");
+		return NULL;
+	}
+
+	if (*width > 0 && *width < w)
+		w = *width;
+	if (*height > 0 && *height < h)
+		h = *height;
+
+	n = write_header ? snprintf(NULL, 0, "P6\n%d\n%d\n255\n", w, h) : 0;
+	if (!(image = malloc(n + 1 + w * h * 3))) {
+		Error(_("video: out of memory\n"));
+		return NULL;
+	}
+	if (write_header)
+		snprintf((char *)image, n + 1, "P6\n%d\n%d\n255\n", w, h);
+	rgb = image + n;
+	memset(rgb, 0, w * h * 3);
+
+	pthread_mutex_lock(&render->GrabMutex);
+	if (render->ShownFrame && (render->ShownFrame->format == AV_PIX_FMT_YUV420P ||
+		render->ShownFrame->format == AV_PIX_FMT_YUVJ420P ||
+		render->ShownFrame->format == AV_PIX_FMT_NV12)) {
+		const AVFrame *frame = render->ShownFrame;
+		GrabSource src;
+
+		src.Plane[0] = frame->data[0];
+		src.Plane[1] = frame->data[1];
+		src.Plane[2] = frame->data[2];
+		src.Pitch[0] = frame->linesize[0];
+		src.Pitch[1] = frame->linesize[1];
+		src.Pitch[2] = frame->linesize[2];
+		src.Width = frame->width;
+		src.Height = frame->height;
+		src.Nv12 = frame->format == AV_PIX_FMT_NV12;
+		GrabConvert(&src, 0, 0, src.Width, src.Height, rgb, w * 3, w, h,
+			GRAB_RGB24);
+	}
+	pthread_mutex_unlock(&render->GrabMutex);
+
+	if (render->OsdShown)
+		GrabBlendOsd(rgb, w * 3, w, h, GRAB_RGB24, render->Osd,
+			VIDEO_NULL_WIDTH * 4, VIDEO_NULL_WIDTH, VIDEO_NULL_HEIGHT, 0);
+
+	*size = n + w * h * 3;
+	*width = w;
+	*height = h;
+	return image;
+}
+
+///
+///	Grab image service.
+///
+///	@param size[out]	size of allocated image
+///	@param width[in,out]	width of image
+///	@param height[in,out]	height of image
+///
+uint8_t *VideoGrabService(int *size, int *width, int *height)
+{
+	Debug(3, "video: no grab service\n");
+	Warning(_("softhddev: grab unsupported\n"));
+
+	(void)size;
+	(void)width;
+	(void)height;
+	return NULL;
+}
+
+///
+///	Get render statistics.
+///
+///	@param render		video render
+///	@param[out] duped	duped frames
+///	@param[out] dropped	dropped frames
+///	@param[out] count	number of decoded frames
+///
+void VideoGetStats(VideoRender * render, int *duped,
+    int *dropped, int *counter)
+{
+    *duped = render->FramesDuped;
+    *dropped = render->FramesDropped;
+    *counter = render->StartCounter;
+}
+
+///
+///	Get the time of the last channel switch.
+///
+///	@param render		video render
+///	@param[out] first_frame	ms until the first frame was shown
+///	@param[out] sync	ms until audio and video were in sync
+///
+void VideoGetZapTime(VideoRender * render, int *first_frame, int *sync)
+{
+    *first_frame = render->ZapFirstFrame;
+    *sync = render->ZapSync;
+}
+
+void VideoGetFilterStats( __attribute__ ((unused)) VideoRender * render,
+    const char **name, int *threads, int *us, int *load)
+{
+    *name = NULL;
+    *threads = 0;
+    *us = 0;
+    *load = 0;
+}
+
+///
+///	Get screen size.
+///
+///	@param render		video render
+///	@param[out] width	simulated screen width
+///	@param[out] height	simulated screen height
+///	@param[out] pixel_aspect	screen aspect
+///
+void VideoGetScreenSize(__attribute__ ((unused)) VideoRender * render,
+		int *width, int *height, double *pixel_aspect)
+{
+	*width = VIDEO_NULL_WIDTH;
+	*height = VIDEO_NULL_HEIGHT;
+	*pixel_aspect = (double)16 / (double)9;
+}
+
+///
+///	Get osd size.
+///
+///	@note the null osd is always screen sized.
+///
+void VideoGetOsdSize(VideoRender * render, int *width, int *height,
+		double *pixel_aspect)
+{
+	VideoGetScreenSize(render, width, height, pixel_aspect);
+}
+
+//----------------------------------------------------------------------------
+//	Setup
+//----------------------------------------------------------------------------
+
+///
+///	Set audio delay.
+///
+///	@param ms	delay in ms
+///
+void VideoSetAudioDelay(int ms)
+{
+    VideoAudioDelay = ms;
+}
+
+void VideoSetOsdSize( __attribute__ ((unused)) int width,
+		__attribute__ ((unused)) int height)
+{
+}
+
+void VideoSetOsdFormat( __attribute__ ((unused)) int format)
+{
+}
+
+void VideoSetFastSwitch( __attribute__ ((unused)) int onoff)
+{
+}
+
+void VideoSetAutoRefresh( __attribute__ ((unused)) int onoff)
+{
+}
+
+void VideoSetDisplayMode( __attribute__ ((unused)) int mode)
+{
+}
+
+void VideoSetDeinterlacer( __attribute__ ((unused)) int tier)
+{
+}
+
+void VideoSetFilterThreads( __attribute__ ((unused)) int threads)
+{
+}
+
+void VideoSetFilterCpus( __attribute__ ((unused)) int mask)
+{
+}
+
+///
+///	Set the cpus of the decode thread.
+///
+void VideoSetDecodeCpus(int mask)
+{
+	VideoDecodeCpus = mask & 0x7FFFFFFF;
+}
+
+///
+///	Set the cpus of the display thread.
+///
+void VideoSetDisplayCpus(int mask)
+{
+	VideoDisplayCpus = mask & 0x7FFFFFFF;
+}
+
+///
+///	Set the realtime priority of the display thread.
+///
+void VideoSetDisplayPriority(int prio)
+{
+	VideoDisplayPriority = prio;
+}
+
+///
+///	Initialize video output module.
+///
+void VideoInit(VideoRender * render)
+{
+	const char *env;
+
+	if ((env = getenv("VIDEO_NULL_HZ")))
+		VideoNullHz = atoi(env);
+	if ((env = getenv("VIDEO_NULL_LOG")) && !VideoNullLog &&
+		!(VideoNullLog = fopen(env, "w")))
+		Error(_("video/null: can't open log %s: %m\n"), env);
+
+	if (!(render->Osd = calloc(VIDEO_NULL_WIDTH * VIDEO_NULL_HEIGHT, 4)))
+		Error(_("video/null: out of memory\n"));
+	GrabRender = render;
+
+	Info(_("video/null: %dx%d %dHz%s\n"), VIDEO_NULL_WIDTH,
+		VIDEO_NULL_HEIGHT, VideoNullHz, VideoNullHz > 0 ? "" : " free run");
+}
+
+///
+///	Cleanup video output module.
+///
+void VideoExit(VideoRender * render)
+{
+	VideoThreadExit(render);
+	NullClean(render);
+	NullReverseClear(render);
+
+	if (GrabRender == render)
+		GrabRender = NULL;
+	free(render->Osd);
+	render->Osd = NULL;
+
+	if (VideoNullLog) {
+		fclose(VideoNullLog);
+		VideoNullLog = NULL;
+	}
+}
+
+const char *VideoGetDecoderName(const char *codec_name)
+{
+	return codec_name;
+}
+
+///
+///	Get the codec mode.
+///
+///	The ffmpeg decoders are used, Video_get_format picks a software
+///	format even if a hw device is offered.
+///
+int VideoCodecMode( __attribute__ ((unused)) VideoRender * render)
+{
+	return 0;
+}